@@ -0,0 +1,1242 @@
+#include <pthread.h>
+
+#include "aot.h"
+#include "interp.h"
+#include "resolve.h"
+#include "fold.h"
+#include "types.h"
+
+// --emit-c writes every top level expression as a C function returning its
+// value, each lamda as a C function taking its args and the frame it was
+// defined in, and each let value as a thunk forced on first use. Expressions
+// are resolved and folded first, so frames, slots and tail calls are the
+// ones the interpreter uses. Operands are evaluated into temporaries one at
+// a time, in the order the tree walker evaluates them, and builtins call the
+// same number.h and vector.c functions, so a translated program prints what
+// cilisp --batch prints for the same input, warnings included.
+//
+// Lamda calls nest on the C stack. A call in tail position of a lamda to
+// the lamda itself loops instead, other tail calls are left to the C
+// compiler.
+
+// Native stack of the thread a translated program runs on, only what deep
+// recursion touches is ever mapped in
+#define AOT_STACK_SIZE ((size_t) 1 << 30)
+
+#define TYPE_CONSTANT(value, name) #value,
+
+// C names of the types a symbol can be cast to
+static const char *typeConstants[] = {
+    TYPE_LIST(TYPE_CONSTANT)
+};
+
+typedef enum {
+    AOT_UNARY,          // extra operands are silently ignored
+    AOT_UNARY_STRICT,   // extra operands are ignored with a warning
+    AOT_BINARY,
+    AOT_FOLD,           // any number of operands, combined left to right
+    AOT_ARRAY,          // any number of operands, passed as an array
+    AOT_NULLARY,
+    AOT_COMPARE,
+    AOT_RANGE_LOOP
+} AOT_KIND;
+
+typedef struct {
+    AOT_KIND kind;
+    // C expression of the call, %s stands for its operands (two for a
+    // binary builtin, an array and its length for AOT_ARRAY)
+    const char *call;
+    // warning and result when no operands are given, a builtin without a
+    // warning runs with none
+    const char *noOperands;
+    const char *empty;
+    // AOT_FOLD with a single operand
+    const char *single;
+    // operands AOT_ARRAY takes before the rest are ignored, 0 for any number
+    size_t maxOperands;
+} AOT_BUILTIN;
+
+// Indexed by FUNC_TYPE, the messages match the eval*FuncNode functions in cilisp.c
+static const AOT_BUILTIN builtins[] = {
+    [NEG_FUNC] = {AOT_UNARY, "numNeg(interp, %s)", "No operands passed into neg", "NAN_RET_VAL"},
+    [ABS_FUNC] = {AOT_UNARY, "numAbs(interp, %s)", "No operands passed into abs", "NAN_RET_VAL"},
+    [ADD_FUNC] = {AOT_FOLD, "numAdd(interp, %s)", "No operands passed into add!", "ZERO_RET_VAL"},
+    [SUB_FUNC] = {AOT_BINARY, "numSub(interp, %s)", "No operands passed into sub!", "NAN_RET_VAL"},
+    [MULT_FUNC] = {AOT_FOLD, "numMult(interp, %s)", "No operands passed into mult!", "INT_RET_VAL(1)"},
+    [DIV_FUNC] = {AOT_BINARY, "numDiv(interp, %s)", "No operands passed into div!", "NAN_RET_VAL"},
+    [REM_FUNC] = {AOT_BINARY, "numRem(interp, %s)", "No operands passed into remainder!", "NAN_RET_VAL"},
+    [EXP_FUNC] = {AOT_UNARY_STRICT, "aotExp(interp, %s)", "No operands passed into exp!", "NAN_RET_VAL"},
+    [EXP2_FUNC] = {AOT_UNARY_STRICT, "aotExp2(interp, %s)", "No operands passed into exp2!", "NAN_RET_VAL"},
+    [POW_FUNC] = {AOT_BINARY, "aotPow(interp, %s)", "No operands passed into pow!", "NAN_RET_VAL"},
+    [LOG_FUNC] = {AOT_UNARY_STRICT, "aotLog(interp, %s)", "No operands passed into log!", "NAN_RET_VAL"},
+    [SQRT_FUNC] = {AOT_UNARY_STRICT, "aotSqrt(interp, %s)", "No operands passed into sqrt!", "NAN_RET_VAL"},
+    [CBRT_FUNC] = {AOT_UNARY_STRICT, "aotCbrt(interp, %s)", "No operands passed into cbrt!", "NAN_RET_VAL"},
+    [HYPOT_FUNC] = {AOT_ARRAY, "aotHypot(interp, %s)", "No operands passed into hypot!", "ZERO_RET_VAL"},
+    [MAX_FUNC] = {AOT_FOLD, "numMax(interp, %s)", "No operands passed into max!", "NAN_RET_VAL", "vecReduce(interp, VEC_MAX, %s)"},
+    [MIN_FUNC] = {AOT_FOLD, "numMin(interp, %s)", "No operands passed into min!", "NAN_RET_VAL", "vecReduce(interp, VEC_MIN, %s)"},
+    [RAND_FUNC] = {AOT_NULLARY, "DOUBLE_RET_VAL((double) rand() / (double) RAND_MAX)"},
+    [READ_FUNC] = {AOT_NULLARY, "readRetVal(interp)"},
+    [MEMSTATS_FUNC] = {AOT_NULLARY, "memStatsRetVal(interp)"},
+    [EQUAL_FUNC] = {AOT_COMPARE, "!numEqual(%s)", "No operands passed into equal!", "ZERO_RET_VAL"},
+    [LESS_FUNC] = {AOT_COMPARE, "numLessEqual(%s)", "No operands passed into equal!", "ZERO_RET_VAL"},
+    [GREATER_FUNC] = {AOT_COMPARE, "numLessEqual(%s)", "No operands passed into equal!", "ZERO_RET_VAL"},
+    [PRINT_FUNC] = {AOT_UNARY_STRICT, "aotPrint(interp, %s)", "No operands passed into print", "NAN_RET_VAL"},
+    [VECTOR_FUNC] = {AOT_ARRAY, "vecConcat(interp, %s)", NULL, "VECTOR_RET_VAL(createVector(interp, 0))"},
+    [RANGE_FUNC] = {AOT_ARRAY, "vecRange(interp, %s)", "No operands passed into range!", "NAN_RET_VAL", NULL, 3},
+    [SUM_FUNC] = {AOT_UNARY_STRICT, "vecReduce(interp, VEC_ADD, %s)", "No operands passed into sum!", "ZERO_RET_VAL"},
+    [DOT_FUNC] = {AOT_BINARY, "numDot(interp, %s)", "No operands passed into dot!", "NAN_RET_VAL"},
+    [LEN_FUNC] = {AOT_UNARY_STRICT, "numLen(%s)", "No operands passed into len!", "ZERO_RET_VAL"},
+    [SUM_RANGE_FUNC] = {AOT_RANGE_LOOP},
+    [PROD_RANGE_FUNC] = {AOT_RANGE_LOOP},
+    [COUNT_RANGE_FUNC] = {AOT_RANGE_LOOP},
+    [FOLD_RANGE_FUNC] = {AOT_RANGE_LOOP}
+};
+
+// The kernel of number.h an arithmetic builtin has for operands of type, NULL
+// when there is none
+static const char *kernelCall(FUNC_TYPE func, NUM_TYPE type)
+{
+    static const char *const kernels[][2] = {
+        [ADD_FUNC] = {"intAdd(interp, %s)", "doubleAdd(interp, %s)"},
+        [SUB_FUNC] = {"intSub(interp, %s)", "doubleSub(interp, %s)"},
+        [MULT_FUNC] = {"intMult(interp, %s)", "doubleMult(interp, %s)"},
+        [DIV_FUNC] = {"intDiv(interp, %s)", "doubleDiv(interp, %s)"}
+    };
+
+    if (type == NO_TYPE || func > DIV_FUNC)
+    {
+        return NULL;
+    }
+    return kernels[func][type == DOUBLE_TYPE];
+}
+
+// Translation of one function of a top level expression
+typedef struct {
+    INTERP *interp;
+    // statements of the function being written
+    OUTPUT *body;
+    // number of the top level expression, its functions are named after it
+    size_t expr;
+    // lamda being written, NULL for a let value or the top level
+    SYMBOL_TABLE_NODE *lamda;
+    // symbols are read or lamdas called, so the function needs its frame
+    bool usesFrame;
+    int temps;
+    int indent;
+    // lamdas and let values referenced by what was written so far, only
+    // those get written, so the C compiler has no unused functions to warn about
+    bool *lamdas;
+    bool *vars;
+} AOT_WRITER;
+
+static int writeNode(AOT_WRITER *w, AST_NODE *node);
+
+static int countArgs(SYMBOL_TABLE_NODE *lamda)
+{
+    int count = 0;
+
+    for (SYMBOL_TABLE_NODE *arg = lamda->arg_list; arg != NULL; arg = arg->next)
+    {
+        count++;
+    }
+
+    return count;
+}
+
+// Appends text as a C string literal, as a printf format if format is set
+static void writeString(OUTPUT *out, const char *text, size_t len, bool format)
+{
+    char escape[8];
+
+    outputText(out, "\"", 1);
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char c = (unsigned char) text[i];
+
+        switch (c)
+        {
+        case '\\':
+        case '"':
+        // never the start of a trigraph
+        case '?':
+            escape[0] = '\\';
+            escape[1] = (char) c;
+            outputText(out, escape, 2);
+            break;
+        case '\n':
+            outputText(out, "\\n", 2);
+            break;
+        case '%':
+            outputText(out, "%%", format ? 2 : 1);
+            break;
+        default:
+            if (c < ' ' || c >= 0x7f)
+            {
+                outputText(out, escape, snprintf(escape, sizeof(escape), "\\%03o", c));
+            }
+            else
+            {
+                outputText(out, text + i, 1);
+            }
+        }
+    }
+    outputText(out, "\"", 1);
+}
+
+static void writeIndent(AOT_WRITER *w)
+{
+    for (int i = 0; i < w->indent; i++)
+    {
+        outputText(w->body, "    ", 4);
+    }
+}
+
+static void writeLine(AOT_WRITER *w, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    char line[len + 1];
+    va_start(args, format);
+    vsnprintf(line, len + 1, format, args);
+    va_end(args);
+
+    writeIndent(w);
+    outputText(w->body, line, len);
+    outputText(w->body, "\n", 1);
+}
+
+// Declares a new temporary holding a C expression and returns its number
+static int writeValue(AOT_WRITER *w, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    char value[len + 1];
+    va_start(args, format);
+    vsnprintf(value, len + 1, format, args);
+    va_end(args);
+
+    int temp = w->temps++;
+    writeLine(w, "RET_VAL t%d = %s;", temp, value);
+    return temp;
+}
+
+// A warning printed every time the statement runs
+static void writeWarning(AOT_WRITER *w, const char *format, ...)
+{
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+
+    writeIndent(w);
+    outputString(w->body, "warning(interp, ");
+    writeString(w->body, message, strlen(message), true);
+    outputString(w->body, ");\n");
+}
+
+// The frame depth lamda frames up from the current one, as a C expression
+static const char *frameAt(AOT_WRITER *w, int depth, char *buffer, size_t size)
+{
+    w->usesFrame = true;
+
+    if (depth == 0)
+    {
+        return "frame";
+    }
+
+    snprintf(buffer, size, "aotFrame(frame, %d)", depth);
+    return buffer;
+}
+
+static void writeLamdaName(OUTPUT *out, size_t expr, SYMBOL_TABLE_NODE *lamda)
+{
+    outputFormat(out, "e%zu_f%d", expr, lamda->index);
+}
+
+// Records that the function of a lamda or let value is referenced
+static void reach(AOT_WRITER *w, SYMBOL_TABLE_NODE *symbol)
+{
+    if (symbol->symbolType == LAMBDA_TYPE)
+    {
+        w->lamdas[symbol->index] = true;
+    }
+    else
+    {
+        w->vars[symbol->index] = true;
+    }
+}
+
+static bool isReached(AOT_WRITER *w, SYMBOL_TABLE_NODE *symbol)
+{
+    return symbol->symbolType == LAMBDA_TYPE ? w->lamdas[symbol->index] : w->vars[symbol->index];
+}
+
+static void writeNumber(AOT_WRITER *w, int temp, RET_VAL number)
+{
+    switch (number.type)
+    {
+    case INT_TYPE:
+        if (number.integer == INT64_MIN)
+        {
+            writeLine(w, "RET_VAL t%d = INT_RET_VAL(INT64_MIN);", temp);
+        }
+        else
+        {
+            writeLine(w, "RET_VAL t%d = INT_RET_VAL(%lld);", temp, (long long) number.integer);
+        }
+        break;
+    case DOUBLE_TYPE:
+        if (isnan(number.value))
+        {
+            writeLine(w, "RET_VAL t%d = DOUBLE_RET_VAL(%sNAN);", temp, signbit(number.value) ? "-" : "");
+        }
+        else if (isinf(number.value))
+        {
+            writeLine(w, "RET_VAL t%d = DOUBLE_RET_VAL(%sINFINITY);", temp, number.value < 0 ? "-" : "");
+        }
+        else
+        {
+            // 17 digits read back as the same double, kept a double
+            // literal so -0.0 stays negative
+            char digits[32];
+            snprintf(digits, sizeof(digits), "%.17g", number.value);
+            writeLine(w, "RET_VAL t%d = DOUBLE_RET_VAL(%s%s);", temp, digits, strpbrk(digits, ".e") ? "" : ".0");
+        }
+        break;
+    default:
+        // folding leaves vectors alone under --emit-c, see fold.c
+        yyerror("Vector constant passed into writeNumber!");
+    }
+}
+
+static int writeSymbol(AOT_WRITER *w, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *symbol = node->data.symbol.binding;
+    char buffer[32];
+
+    // undefined symbols were reported by resolveSymbols
+    if (symbol == NULL)
+    {
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    const char *frame = frameAt(w, node->data.symbol.depth, buffer, sizeof(buffer));
+
+    if (symbol->symbolType == ARG_TYPE)
+    {
+        return writeValue(w, "%s->slots[%d]", frame, symbol->slot);
+    }
+
+    reach(w, symbol);
+    return writeValue(w, "aotLet(interp, %s, %d, e%zu_v%d, \"%s\")", frame, symbol->slot, w->expr, symbol->index, symbol->id);
+}
+
+// Evaluates the args of a lamda call into temporaries, false when there are
+// too few of them
+static bool writeLamdaArgs(AOT_WRITER *w, AST_NODE *node, SYMBOL_TABLE_NODE *lamda, int *args)
+{
+    AST_NODE *op = node->data.function.opList;
+    int nargs = countArgs(lamda);
+
+    for (int i = 0; i < nargs; i++, op = op->next)
+    {
+        if (op == NULL)
+        {
+            // the args are still evaluated, for their warnings
+            for (int j = 0; j < i; j++)
+            {
+                writeLine(w, "(void) t%d;", args[j]);
+            }
+            writeWarning(w, "Not enough arguments passed into lamda: %s", lamda->id);
+            return false;
+        }
+        args[i] = writeNode(w, op);
+    }
+
+    if (op != NULL)
+    {
+        writeWarning(w, "lamda: %s called with extra (ignored) arguments!!", lamda->id);
+    }
+
+    return true;
+}
+
+// Writes a statement ending in the call of a lamda on args in temporaries,
+// what comes before the call is a printf format
+static void writeLamdaCall(AOT_WRITER *w, SYMBOL_TABLE_NODE *lamda, int depth, const int *args, const char *format, ...)
+{
+    char buffer[32];
+    va_list list;
+
+    writeIndent(w);
+    va_start(list, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, list);
+    va_end(list);
+    outputText(w->body, buffer, len);
+
+    reach(w, lamda);
+    writeLamdaName(w->body, w->expr, lamda);
+    outputFormat(w->body, "(interp, %s", frameAt(w, depth, buffer, sizeof(buffer)));
+    for (int i = 0; i < countArgs(lamda); i++)
+    {
+        outputFormat(w->body, ", t%d", args[i]);
+    }
+    outputString(w->body, ");\n");
+}
+
+static int writeCall(AOT_WRITER *w, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *lamda = node->data.function.binding;
+
+    // undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL)
+    {
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    int args[countArgs(lamda) + 1];
+
+    if (!writeLamdaArgs(w, node, lamda, args))
+    {
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    int temp = w->temps++;
+    writeLamdaCall(w, lamda, node->data.function.depth, args, "RET_VAL t%d = ", temp);
+
+    return temp;
+}
+
+// sum_range, prod_range, count_range and fold_range, checked the same way
+// evalRangeLoopFuncNode does
+static int writeRangeLoop(AOT_WRITER *w, AST_NODE *node)
+{
+    FUNC_TYPE func = node->data.function.func;
+    const char *name = nameOfFunc(func);
+    AST_NODE *current = node->data.function.opList;
+    size_t needed = func == FOLD_RANGE_FUNC ? 5 : 3;
+    size_t count = countOperands(current);
+
+    if (count == 0)
+    {
+        writeWarning(w, "No operands passed into %s!", name);
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    if (count < needed)
+    {
+        writeWarning(w, "Not enough operands passed into %s!", name);
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    if (count > needed)
+    {
+        writeWarning(w, "%s called with extra (ignored) operands!!", name);
+    }
+
+    AST_NODE *fold = NULL;
+    if (func == FOLD_RANGE_FUNC)
+    {
+        fold = current;
+        current = current->next;
+    }
+    AST_NODE *body = current;
+    current = current->next;
+
+    SYMBOL_TABLE_NODE *lamda = rangeLoopLamda(body);
+    SYMBOL_TABLE_NODE *op = rangeLoopLamda(fold);
+
+    // bad and undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL || (fold != NULL && op == NULL))
+    {
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    if (countArgs(lamda) != 1)
+    {
+        writeWarning(w, "%s needs a lamda of one argument, %s isn't!", name, lamda->id);
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    if (op != NULL && countArgs(op) != 2)
+    {
+        writeWarning(w, "%s needs a lamda of two arguments, %s isn't!", name, op->id);
+        return writeValue(w, "NAN_RET_VAL");
+    }
+
+    int acc;
+    if (func == FOLD_RANGE_FUNC)
+    {
+        acc = writeValue(w, "t%d", writeNode(w, current));
+        current = current->next;
+    }
+    else
+    {
+        acc = writeValue(w, func == PROD_RANGE_FUNC ? "INT_RET_VAL(1)" : "ZERO_RET_VAL");
+    }
+
+    int lo = writeNode(w, current);
+    int hi = writeNode(w, current->next);
+    int result = w->temps++;
+    int i = w->temps++;
+
+    writeLine(w, "RET_VAL t%d;", result);
+    writeLine(w, "if (t%d.type != INT_TYPE || t%d.type != INT_TYPE)", lo, hi);
+    writeLine(w, "{");
+    w->indent++;
+    writeWarning(w, "%s bounds must be integers!", name);
+    writeLine(w, "t%d = NAN_RET_VAL;", result);
+    w->indent--;
+    writeLine(w, "}");
+    writeLine(w, "else");
+    writeLine(w, "{");
+    w->indent++;
+    writeLine(w, "for (int64_t t%d = t%d.integer; t%d < t%d.integer; t%d++)", i, lo, i, hi, i);
+    writeLine(w, "{");
+    w->indent++;
+
+    // the loop variable is the lamda's arg
+    int args[2] = {writeValue(w, "INT_RET_VAL(t%d)", i), w->temps++};
+    writeLamdaCall(w, lamda, body->data.symbol.depth, args, "RET_VAL t%d = ", args[1]);
+
+    switch (func)
+    {
+    case SUM_RANGE_FUNC:
+        writeLine(w, "t%d = numAdd(interp, t%d, t%d);", acc, acc, args[1]);
+        break;
+    case PROD_RANGE_FUNC:
+        writeLine(w, "t%d = numMult(interp, t%d, t%d);", acc, acc, args[1]);
+        break;
+    case COUNT_RANGE_FUNC:
+        writeLine(w, "t%d.integer += numIsTrue(t%d);", acc, args[1]);
+        break;
+    default:
+        // the fold lamda takes the accumulator, then the value
+        args[0] = acc;
+        writeLamdaCall(w, op, fold->data.symbol.depth, args, "t%d = ", acc);
+    }
+
+    w->indent--;
+    writeLine(w, "}");
+    writeLine(w, "t%d = t%d;", result, acc);
+    w->indent--;
+    writeLine(w, "}");
+
+    return result;
+}
+
+// The short circuiting chain of equal, less and greater, every operand is
+// compared to the first one
+static int writeCompare(AOT_WRITER *w, FUNC_TYPE func, const AOT_BUILTIN *builtin, AST_NODE *current)
+{
+    int first = writeNode(w, current);
+    int result = writeValue(w, "INT_RET_VAL(1)");
+
+    if (current->next == NULL)
+    {
+        writeLine(w, "(void) t%d;", first);
+        return result;
+    }
+
+    writeLine(w, "do");
+    writeLine(w, "{");
+    w->indent++;
+
+    for (current = current->next; current != NULL; current = current->next)
+    {
+        int value = writeNode(w, current);
+        char operands[32];
+
+        if (func == GREATER_FUNC)
+        {
+            snprintf(operands, sizeof(operands), "t%d, t%d", first, value);
+        }
+        else
+        {
+            snprintf(operands, sizeof(operands), "t%d, t%d", value, first);
+        }
+
+        writeIndent(w);
+        outputString(w->body, "if (");
+        outputFormat(w->body, builtin->call, operands);
+        outputString(w->body, ")\n");
+        writeLine(w, "{");
+        w->indent++;
+        writeLine(w, "t%d = ZERO_RET_VAL;", result);
+        writeLine(w, "break;");
+        w->indent--;
+        writeLine(w, "}");
+    }
+
+    w->indent--;
+    writeLine(w, "} while (0);");
+
+    return result;
+}
+
+static int writeBuiltin(AOT_WRITER *w, AST_NODE *node)
+{
+    FUNC_TYPE func = node->data.function.func;
+
+    if (func < NEG_FUNC || func >= CUSTOM_FUNC)
+    {
+        yyerror("Invalid function type passed into writeBuiltin!");
+        return 0;
+    }
+
+    const AOT_BUILTIN *builtin = &builtins[func];
+    const char *name = nameOfFunc(func);
+    AST_NODE *opList = node->data.function.opList;
+    size_t count = countOperands(opList);
+    char operands[48];
+
+    if (builtin->kind == AOT_RANGE_LOOP)
+    {
+        return writeRangeLoop(w, node);
+    }
+
+    // two operands of one known type go to an int or double kernel
+    const char *kernel = count == 2 ? kernelCall(func, kernelType(opList->types, opList->next->types)) : NULL;
+
+    if (kernel != NULL)
+    {
+        int left = writeNode(w, opList);
+        int right = writeNode(w, opList->next);
+        snprintf(operands, sizeof(operands), "t%d, t%d", left, right);
+        return writeValue(w, kernel, operands);
+    }
+
+    if (builtin->kind == AOT_NULLARY)
+    {
+        if (count > 0)
+        {
+            writeWarning(w, "%s called with extra (ignored) operands!!", name);
+        }
+        return writeValue(w, "%s", builtin->call);
+    }
+
+    if (count == 0)
+    {
+        if (builtin->noOperands != NULL)
+        {
+            writeWarning(w, "%s", builtin->noOperands);
+        }
+        return writeValue(w, "%s", builtin->empty);
+    }
+
+    switch (builtin->kind)
+    {
+    case AOT_UNARY_STRICT:
+        if (count > 1)
+        {
+            writeWarning(w, "%s called with extra (ignored) operands!!", name);
+        }
+        // fall through
+    case AOT_UNARY:
+        snprintf(operands, sizeof(operands), "t%d", writeNode(w, opList));
+        return writeValue(w, builtin->call, operands);
+    case AOT_BINARY:
+    {
+        if (count == 1)
+        {
+            writeWarning(w, "Only one operand passed into %s!", name);
+            return writeValue(w, "NAN_RET_VAL");
+        }
+        if (count > 2)
+        {
+            writeWarning(w, "%s called with extra (ignored) operands!!", name);
+        }
+        int left = writeNode(w, opList);
+        int right = writeNode(w, opList->next);
+        snprintf(operands, sizeof(operands), "t%d, t%d", left, right);
+        return writeValue(w, builtin->call, operands);
+    }
+    case AOT_FOLD:
+    {
+        int first = writeNode(w, opList);
+        int result;
+
+        if (count == 1 && builtin->single != NULL)
+        {
+            snprintf(operands, sizeof(operands), "t%d", first);
+            return writeValue(w, builtin->single, operands);
+        }
+
+        // each operand is combined as soon as it is evaluated, like the tree
+        // walker and the VM do, so warnings come out in the same order
+        result = writeValue(w, "t%d", first);
+        for (AST_NODE *op = opList->next; op != NULL; op = op->next)
+        {
+            int value = writeNode(w, op);
+            snprintf(operands, sizeof(operands), "t%d, t%d", result, value);
+            writeIndent(w);
+            outputFormat(w->body, "t%d = ", result);
+            outputFormat(w->body, builtin->call, operands);
+            outputText(w->body, ";\n", 2);
+        }
+        return result;
+    }
+    case AOT_ARRAY:
+    {
+        if (builtin->maxOperands > 0 && count > builtin->maxOperands)
+        {
+            writeWarning(w, "%s called with extra (ignored) operands!!", name);
+            count = builtin->maxOperands;
+        }
+
+        int values[count];
+        AST_NODE *op = opList;
+        for (size_t i = 0; i < count; i++, op = op->next)
+        {
+            values[i] = writeNode(w, op);
+        }
+
+        int array = w->temps++;
+        writeIndent(w);
+        outputFormat(w->body, "RET_VAL t%d[] = {", array);
+        for (size_t i = 0; i < count; i++)
+        {
+            outputFormat(w->body, i > 0 ? ", t%d" : "t%d", values[i]);
+        }
+        outputString(w->body, "};\n");
+
+        snprintf(operands, sizeof(operands), "t%d, %zu", array, count);
+        return writeValue(w, builtin->call, operands);
+    }
+    case AOT_COMPARE:
+        return writeCompare(w, func, builtin, opList);
+    default:
+        yyerror("Invalid builtin kind in writeBuiltin!");
+        return 0;
+    }
+}
+
+static int writeCond(AOT_WRITER *w, AST_NODE *node)
+{
+    int condition = writeNode(w, node->data.cond.contiditonal);
+    int result = w->temps++;
+
+    writeLine(w, "RET_VAL t%d;", result);
+    writeLine(w, "if (numIsTrue(t%d))", condition);
+    writeLine(w, "{");
+    w->indent++;
+    writeLine(w, "t%d = t%d;", result, writeNode(w, node->data.cond.true_node));
+    w->indent--;
+    writeLine(w, "}");
+    writeLine(w, "else");
+    writeLine(w, "{");
+    w->indent++;
+    writeLine(w, "t%d = t%d;", result, writeNode(w, node->data.cond.false_node));
+    w->indent--;
+    writeLine(w, "}");
+
+    return result;
+}
+
+// Writes the statements evaluating a node, returns the temporary holding its value
+static int writeNode(AOT_WRITER *w, AST_NODE *node)
+{
+    if (!node)
+    {
+        yyerror("NULL ast node passed into writeNode!");
+        return 0;
+    }
+
+    switch (node->type)
+    {
+    case NUM_NODE_TYPE:
+    {
+        int temp = w->temps++;
+        writeNumber(w, temp, node->data.number);
+        return temp;
+    }
+    case FUNC_NODE_TYPE:
+        if (node->data.function.func == CUSTOM_FUNC)
+        {
+            return writeCall(w, node);
+        }
+        return writeBuiltin(w, node);
+    case SYM_NODE_TYPE:
+        return writeSymbol(w, node);
+    case SCOPE_NODE_TYPE:
+        // the let section is written as functions of its own
+        return writeNode(w, node->data.scope.child);
+    case COND_NODE_TYPE:
+        return writeCond(w, node);
+    default:
+        yyerror("Incorrect ast node passed into writeNode!");
+        return 0;
+    }
+}
+
+static void writeReturn(AOT_WRITER *w, int temp)
+{
+    if (w->lamda != NULL && w->lamda->type != NO_TYPE)
+    {
+        writeLine(w, "return castRetVal(interp, t%d, %s);", temp, typeConstants[w->lamda->type]);
+    }
+    else
+    {
+        writeLine(w, "return t%d;", temp);
+    }
+}
+
+// A tail call marked by resolveSymbols. The callee's cast is the caller's
+// (or the caller has none), so its result is returned as is. A call of the
+// lamda itself refills the frame and runs the body again.
+static void writeTailCall(AOT_WRITER *w, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *callee = node->data.function.binding;
+    int nargs = countArgs(callee);
+    int args[nargs + 1];
+
+    // resolveSymbols only marks calls with enough args
+    writeLamdaArgs(w, node, callee, args);
+
+    if (callee != w->lamda)
+    {
+        writeLamdaCall(w, callee, node->data.function.depth, args, "return ");
+        return;
+    }
+
+    w->usesFrame = true;
+    for (int i = 0; i < nargs; i++)
+    {
+        writeLine(w, "frame->slots[%d] = t%d;", i, args[i]);
+    }
+    for (int i = nargs; i < callee->frameSize; i++)
+    {
+        writeLine(w, "frame->slots[%d] = UNFORCED_SLOT;", i);
+    }
+    writeLine(w, "continue;");
+}
+
+// Writes a lamda body so every path returns, following its tail position
+// through scopes and cond branches like callLamda does
+static void writeTail(AOT_WRITER *w, AST_NODE *node)
+{
+    switch (node->type)
+    {
+    case SCOPE_NODE_TYPE:
+        writeTail(w, node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        writeLine(w, "if (numIsTrue(t%d))", writeNode(w, node->data.cond.contiditonal));
+        writeLine(w, "{");
+        w->indent++;
+        writeTail(w, node->data.cond.true_node);
+        w->indent--;
+        writeLine(w, "}");
+        writeLine(w, "else");
+        writeLine(w, "{");
+        w->indent++;
+        writeTail(w, node->data.cond.false_node);
+        w->indent--;
+        writeLine(w, "}");
+        break;
+    case FUNC_NODE_TYPE:
+        if (node->data.function.func == CUSTOM_FUNC && node->data.function.tail)
+        {
+            writeTailCall(w, node);
+            break;
+        }
+        // fall through
+    default:
+        writeReturn(w, writeNode(w, node));
+    }
+}
+
+// Whether a lamda body calls the lamda itself in tail position
+static bool hasSelfTailCall(SYMBOL_TABLE_NODE *lamda, AST_NODE *node)
+{
+    switch (node->type)
+    {
+    case SCOPE_NODE_TYPE:
+        return hasSelfTailCall(lamda, node->data.scope.child);
+    case COND_NODE_TYPE:
+        return hasSelfTailCall(lamda, node->data.cond.true_node) || hasSelfTailCall(lamda, node->data.cond.false_node);
+    case FUNC_NODE_TYPE:
+        return node->data.function.func == CUSTOM_FUNC && node->data.function.tail
+            && node->data.function.binding == lamda;
+    default:
+        return false;
+    }
+}
+
+static void writeSignature(OUTPUT *out, size_t expr, SYMBOL_TABLE_NODE *symbol)
+{
+    if (symbol->symbolType != LAMBDA_TYPE)
+    {
+        outputFormat(out, "static RET_VAL e%zu_v%d(INTERP *interp, AOT_FRAME *frame)", expr, symbol->index);
+        return;
+    }
+
+    outputString(out, "static RET_VAL ");
+    writeLamdaName(out, expr, symbol);
+    outputString(out, "(INTERP *interp, AOT_FRAME *link");
+    for (int i = 0; i < countArgs(symbol); i++)
+    {
+        outputFormat(out, ", RET_VAL a%d", i);
+    }
+    outputText(out, ")", 1);
+}
+
+// Lists the lamdas and let values defined in an expression, nested ones too
+static void collectSymbols(AST_NODE *node, SYMBOL_TABLE_NODE **symbols, int *count)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            collectSymbols(op, symbols, count);
+        }
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            symbols[(*count)++] = symbol;
+            collectSymbols(symbol->value, symbols, count);
+        }
+        collectSymbols(node->data.scope.child, symbols, count);
+        break;
+    case COND_NODE_TYPE:
+        collectSymbols(node->data.cond.contiditonal, symbols, count);
+        collectSymbols(node->data.cond.true_node, symbols, count);
+        collectSymbols(node->data.cond.false_node, symbols, count);
+        break;
+    default:
+        break;
+    }
+}
+
+// Writes a function around the statements in w->body. Its frame holds the
+// args, then unforced let slots, and is only set up when the body uses it.
+static void writeFunction(AOT_WRITER *w, OUTPUT *out, SYMBOL_TABLE_NODE *symbol, int frameSize, bool loops)
+{
+    int nargs = symbol != NULL && symbol->symbolType == LAMBDA_TYPE ? countArgs(symbol) : 0;
+    bool thunk = symbol != NULL && symbol->symbolType != LAMBDA_TYPE;
+
+    if (symbol != NULL)
+    {
+        outputFormat(out, "\n// %s %s\n", thunk ? "let" : "lamda", symbol->id);
+        writeSignature(out, w->expr, symbol);
+        outputString(out, "\n{\n");
+    }
+    else
+    {
+        outputFormat(out, "\nstatic RET_VAL e%zu(INTERP *interp)\n{\n", w->expr);
+    }
+
+    // a let value runs in the frame of the lamda (or top level) owning its slot
+    if (w->usesFrame && !thunk)
+    {
+        if (frameSize > 0)
+        {
+            outputFormat(out, "    RET_VAL slots[%d] = {", frameSize);
+            for (int i = 0; i < frameSize; i++)
+            {
+                outputString(out, i > 0 ? ", " : "");
+                if (i < nargs)
+                {
+                    outputFormat(out, "a%d", i);
+                }
+                else
+                {
+                    outputString(out, "UNFORCED_SLOT");
+                }
+            }
+            outputString(out, "};\n");
+        }
+        outputFormat(out, "    AOT_FRAME here = {%s, %s};\n", frameSize > 0 ? "slots" : "NULL", symbol != NULL ? "link" : "NULL");
+        outputString(out, "    AOT_FRAME *frame = &here;\n");
+    }
+
+    if (loops)
+    {
+        outputString(out, "    for (;;)\n    {\n");
+    }
+    outputText(out, w->body->data, w->body->len);
+    if (loops)
+    {
+        outputString(out, "    }\n");
+    }
+    outputString(out, "}\n");
+    w->body->len = 0;
+}
+
+// Writes the function of a lamda or let value
+static void writeSymbolFunction(AOT_WRITER *w, OUTPUT *out, SYMBOL_TABLE_NODE *symbol)
+{
+    AOT_WRITER function = {w->interp, w->body, w->expr, NULL, false, 0, 1, w->lamdas, w->vars};
+
+    if (symbol->symbolType == LAMBDA_TYPE)
+    {
+        bool loops = hasSelfTailCall(symbol, symbol->value);
+        function.lamda = symbol;
+        function.indent += loops;
+        writeTail(&function, symbol->value);
+        writeFunction(&function, out, symbol, symbol->frameSize, loops);
+    }
+    else if (symbol->type != NO_TYPE)
+    {
+        // a typed let is cast once, when forced
+        int temp = writeNode(&function, symbol->value);
+        writeLine(&function, "return castRetVal(interp, t%d, %s);", temp, typeConstants[symbol->type]);
+        writeFunction(&function, out, symbol, 0, false);
+    }
+    else
+    {
+        writeLine(&function, "return t%d;", writeNode(&function, symbol->value));
+        writeFunction(&function, out, symbol, 0, false);
+    }
+}
+
+// Moves what the interpreter printed since the last expression into the C
+// program, showing it on stderr too if it holds a warning
+static void takeAotOutput(INTERP *interp)
+{
+    if (interp->warningCount != interp->aot.warnings)
+    {
+        fwrite(interp->out.data, 1, interp->out.len, stderr);
+        interp->aot.warnings = interp->warningCount;
+    }
+
+    // without a stream the text is dropped
+    flushOutput(&interp->out);
+}
+
+void startAot(INTERP *interp)
+{
+    AOT_STATE *aot = &interp->aot;
+
+    aot->code.stream = stdout;
+    // the echo and warnings are kept for the program, see takeAotOutput
+    interp->out.stream = NULL;
+
+    outputString(&aot->code,
+        "// Translated by cilisp --emit-c. Build it against the interpreter's\n"
+        "// runtime, libcilisp.a (make runtime in the cilisp sources):\n"
+        "//     gcc -O2 -I<cilisp> prog.c <cilisp>/libcilisp.a -o prog -lm -lpthread\n"
+        "// ./prog [read input] prints what cilisp --batch prints for the program.\n"
+        "#include \"aot.h\"\n");
+}
+
+void aotTopLevel(INTERP *interp, AST_NODE *node)
+{
+    AOT_STATE *aot = &interp->aot;
+    RESOLVE_INFO info;
+
+    resolveSymbols(interp, node, &info);
+    foldConstants(interp, node);
+    inferTypes(interp, node, &info);
+
+    OUTPUT body = {0};
+    OUTPUT top = {0};
+    OUTPUT functions = {0};
+    bool lamdas[info.lamdas + 1];
+    bool vars[info.vars + 1];
+    bool written[info.lamdas + info.vars + 1];
+    SYMBOL_TABLE_NODE *symbols[info.lamdas + info.vars + 1];
+    int count = 0;
+    AOT_WRITER w = {interp, &body, ++aot->exprs, NULL, false, 0, 1, lamdas, vars};
+
+    memset(lamdas, 0, sizeof(lamdas));
+    memset(vars, 0, sizeof(vars));
+    memset(written, 0, sizeof(written));
+    collectSymbols(node, symbols, &count);
+
+    writeLine(&w, "return t%d;", writeNode(&w, node));
+    writeFunction(&w, &top, NULL, info.frameSize, false);
+
+    // writing a function can reference more of them
+    for (bool more = true; more; )
+    {
+        more = false;
+        for (int i = 0; i < count; i++)
+        {
+            if (!written[i] && isReached(&w, symbols[i]))
+            {
+                writeSymbolFunction(&w, &functions, symbols[i]);
+                written[i] = more = true;
+            }
+        }
+    }
+
+    // prototypes first, the functions call and read each other in any order
+    for (int i = 0; i < count; i++)
+    {
+        if (written[i])
+        {
+            writeSignature(&body, w.expr, symbols[i]);
+            outputText(&body, ";\n", 2);
+        }
+    }
+    if (body.len > 0)
+    {
+        outputText(&aot->code, "\n", 1);
+        outputText(&aot->code, body.data, body.len);
+    }
+    outputText(&aot->code, functions.data, functions.len);
+    outputText(&aot->code, top.data, top.len);
+    freeOutput(&body);
+    freeOutput(&top);
+    freeOutput(&functions);
+
+    // the echo and warnings printed so far belong in front of the result
+    OUTPUT *out = &interp->out;
+    outputString(&aot->table, "    {");
+    writeString(&aot->table, out->data, out->len, false);
+    outputFormat(&aot->table, ", e%zu},\n", w.expr);
+    takeAotOutput(interp);
+}
+
+void finishAot(INTERP *interp)
+{
+    AOT_STATE *aot = &interp->aot;
+    OUTPUT *out = &interp->out;
+
+    if (aot->exprs == 0)
+    {
+        outputString(&aot->code, "\nstatic const AOT_PROGRAM program = {NULL, 0, ");
+    }
+    else
+    {
+        outputString(&aot->code, "\nstatic const AOT_EXPR exprs[] = {\n");
+        outputText(&aot->code, aot->table.data, aot->table.len);
+        outputFormat(&aot->code, "};\n\nstatic const AOT_PROGRAM program = {exprs, %zu, ", aot->exprs);
+    }
+
+    // the echo of EOF or quit
+    writeString(&aot->code, out->data, out->len, false);
+    takeAotOutput(interp);
+
+    outputString(&aot->code,
+        "};\n"
+        "\n"
+        "int main(int argc, char **argv)\n"
+        "{\n"
+        "    return runAot(argc, argv, &program);\n"
+        "}\n");
+
+    flushOutput(&aot->code);
+    freeOutput(&aot->code);
+    freeOutput(&aot->table);
+}
+
+RET_VAL aotExp(INTERP *interp, RET_VAL a)
+{
+    return numExp(interp, a);
+}
+
+RET_VAL aotExp2(INTERP *interp, RET_VAL a)
+{
+    return numExp2(interp, a);
+}
+
+RET_VAL aotLog(INTERP *interp, RET_VAL a)
+{
+    return numLog(interp, a);
+}
+
+RET_VAL aotSqrt(INTERP *interp, RET_VAL a)
+{
+    return numSqrt(interp, a);
+}
+
+RET_VAL aotCbrt(INTERP *interp, RET_VAL a)
+{
+    return numCbrt(interp, a);
+}
+
+RET_VAL aotPow(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    return numPow(interp, a, b);
+}
+
+RET_VAL aotHypot(INTERP *interp, const RET_VAL *args, size_t n)
+{
+    return numHypot(interp, args, n);
+}
+
+RET_VAL forceAotLet(INTERP *interp, AOT_FRAME *frame, int slot, AOT_THUNK thunk, const char *id)
+{
+    if (frame->slots[slot].integer != 0)
+    {
+        warning(interp, "Recursive definition of symbol: %s", id);
+        return NAN_RET_VAL;
+    }
+
+    frame->slots[slot] = FORCING_SLOT;
+    RET_VAL value = thunk(interp, frame);
+    frame->slots[slot] = value;
+
+    return value;
+}
+
+typedef struct {
+    INTERP *interp;
+    const AOT_PROGRAM *program;
+} AOT_RUN;
+
+// Evaluates and prints the expressions of a translated program the way
+// runBatch and handleTopLevel do
+static void *runAotExprs(void *arg)
+{
+    AOT_RUN *run = arg;
+    INTERP *interp = run->interp;
+
+    for (size_t i = 0; i < run->program->count; i++)
+    {
+        outputString(&interp->out, run->program->exprs[i].echo);
+        printRetVal(interp, run->program->exprs[i].eval(interp));
+        resetParseArena(interp);
+        flushOutput(&interp->out);
+    }
+
+    outputString(&interp->out, run->program->trailer);
+    flushOutput(&interp->out);
+
+    return NULL;
+}
+
+int runAot(int argc, char **argv, const AOT_PROGRAM *program)
+{
+    INTERP *interp = createInterp();
+    AOT_RUN run = {interp, program};
+    pthread_attr_t attr;
+    pthread_t thread;
+
+    if (argc > 1 && (interp->readTarget = fopen(argv[1], "r")) == NULL)
+    {
+        yyerror("Could not open %s", argv[1]);
+    }
+
+    // lamda calls nest on the native stack, so the program gets a big one
+    pthread_attr_init(&attr);
+    if (pthread_attr_setstacksize(&attr, AOT_STACK_SIZE) == 0 && pthread_create(&thread, &attr, runAotExprs, &run) == 0)
+    {
+        pthread_join(thread, NULL);
+    }
+    else
+    {
+        runAotExprs(&run);
+    }
+    pthread_attr_destroy(&attr);
+
+    freeInterp(interp);
+
+    return EXIT_SUCCESS;
+}
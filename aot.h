@@ -0,0 +1,105 @@
+#ifndef __aot_h_
+#define __aot_h_
+
+#include "cilisp.h"
+#include "output.h"
+#include "number.h"
+#include "vector.h"
+
+// --emit-c translates a program into C instead of running it, see aot.c.
+// The C program includes this header and links against the interpreter
+// without its scanner and parser (make runtime builds libcilisp.a), so the
+// builtins, their promotion rules and their warnings are the ones of number.h
+// and vector.c.
+
+// --emit-c state of the translating interpreter
+typedef struct {
+    bool enabled;
+    // functions of the expressions translated so far, written to stdout
+    OUTPUT code;
+    // entries of the program table, written once the input is done
+    OUTPUT table;
+    size_t exprs;
+    // warnings counted up to the last expression, see takeAotOutput
+    size_t warnings;
+} AOT_STATE;
+
+// A lamda call or top level expression in a translated program. Let values
+// and the args of enclosing lamdas are reached by following link, the way
+// the tree walker follows EVAL_FRAME links.
+typedef struct aot_frame {
+    RET_VAL *slots;
+    struct aot_frame *link;
+} AOT_FRAME;
+
+// Translated let value, evaluated in the frame owning its slot
+typedef RET_VAL (*AOT_THUNK)(INTERP *interp, AOT_FRAME *frame);
+
+// One top level expression of a translated program
+typedef struct {
+    // what the interpreter prints before evaluating it: the --batch echo
+    // and any warnings from parsing and resolving it
+    const char *echo;
+    RET_VAL (*eval)(INTERP *interp);
+} AOT_EXPR;
+
+typedef struct {
+    const AOT_EXPR *exprs;
+    size_t count;
+    // printed after the last expression, the echo of EOF or quit
+    const char *trailer;
+} AOT_PROGRAM;
+
+// Sends the C program to stdout and what the interpreter prints to the program
+void startAot(INTERP *interp);
+// Writes a resolved and folded top level expression as C functions
+void aotTopLevel(INTERP *interp, AST_NODE *node);
+// Writes the program table and main once the whole input is translated
+void finishAot(INTERP *interp);
+
+// main of a translated program: runs its expressions in order and prints
+// their results like cilisp --batch does, argv[1] is the file read takes
+// its lines from (stdin by default)
+int runAot(int argc, char **argv, const AOT_PROGRAM *program);
+// evalLetSlot for a slot still unforced (or being forced)
+RET_VAL forceAotLet(INTERP *interp, AOT_FRAME *frame, int slot, AOT_THUNK thunk, const char *id);
+
+// The libm builtins, kept out of line in libcilisp.a: gcc would fold a call
+// on a constant operand with correctly rounded results that glibc doesn't
+// always give, and the program would print other digits than cilisp
+RET_VAL aotExp(INTERP *interp, RET_VAL a);
+RET_VAL aotExp2(INTERP *interp, RET_VAL a);
+RET_VAL aotLog(INTERP *interp, RET_VAL a);
+RET_VAL aotSqrt(INTERP *interp, RET_VAL a);
+RET_VAL aotCbrt(INTERP *interp, RET_VAL a);
+RET_VAL aotPow(INTERP *interp, RET_VAL a, RET_VAL b);
+RET_VAL aotHypot(INTERP *interp, const RET_VAL *args, size_t n);
+
+// The frame of a symbol depth lamda frames up from the current one
+static inline AOT_FRAME *aotFrame(AOT_FRAME *frame, int depth)
+{
+    while (depth-- > 0)
+    {
+        frame = frame->link;
+    }
+    return frame;
+}
+
+static inline RET_VAL aotPrint(INTERP *interp, RET_VAL value)
+{
+    printRetVal(interp, value);
+    return value;
+}
+
+// Returns a let value, evaluating it on first use
+static inline RET_VAL aotLet(INTERP *interp, AOT_FRAME *frame, int slot, AOT_THUNK thunk, const char *id)
+{
+    if (frame->slots[slot].type != NO_TYPE)
+    {
+        return frame->slots[slot];
+    }
+
+    return forceAotLet(interp, frame, slot, thunk, id);
+}
+
+#endif
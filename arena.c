@@ -0,0 +1,124 @@
+#include "arena.h"
+#include "cilisp.h"
+
+#define ARENA_ALIGN(n) (((n) + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1))
+
+static ARENA_CHUNK *createArenaChunk(ARENA *arena, size_t size)
+{
+    ARENA_CHUNK *chunk;
+
+    if ((chunk = memAlloc(arena->category, sizeof(ARENA_CHUNK) + size)) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    arena->chunkMallocs++;
+
+    return chunk;
+}
+
+// Returns zeroed memory that lives until the next resetArena
+void *allocFromArena(ARENA *arena, size_t size)
+{
+    size = ARENA_ALIGN(size);
+
+    ARENA_CHUNK *chunk = arena->current;
+
+    // move on to a retained chunk or a new one when this one is full
+    while (chunk == NULL || chunk->used + size > chunk->size)
+    {
+        if (chunk != NULL && chunk->next != NULL)
+        {
+            chunk = chunk->next;
+            chunk->used = 0;
+            continue;
+        }
+
+        ARENA_CHUNK *fresh = createArenaChunk(arena, size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE);
+        if (chunk == NULL)
+        {
+            arena->first = fresh;
+        }
+        else
+        {
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        }
+        chunk = fresh;
+    }
+
+    arena->current = chunk;
+
+    void *memory = (char *) chunk->data + chunk->used;
+    chunk->used += size;
+
+    memset(memory, 0, size);
+
+    arena->allocations++;
+    arena->bytes += size;
+    arena->live += size;
+    if (arena->live > arena->peak)
+    {
+        arena->peak = arena->live;
+    }
+
+    return memory;
+}
+
+void resetArena(ARENA *arena)
+{
+    if (arena->first != NULL)
+    {
+        arena->first->used = 0;
+    }
+
+    arena->current = arena->first;
+    arena->live = 0;
+    arena->resets++;
+}
+
+void freeArena(ARENA *arena)
+{
+    ARENA_CHUNK *chunk = arena->first;
+
+    while (chunk != NULL)
+    {
+        ARENA_CHUNK *next = chunk->next;
+        memFree(chunk);
+        chunk = next;
+    }
+
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->live = 0;
+}
+
+void moveArena(ARENA *arena, ARENA *into)
+{
+    into->first = arena->first;
+    into->current = arena->current;
+    into->live = arena->live;
+    into->category = arena->category;
+
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->live = 0;
+}
+
+void printArenaStats(ARENA *arena, const char *name)
+{
+    size_t retained = 0;
+    for (ARENA_CHUNK *chunk = arena->first; chunk != NULL; chunk = chunk->next)
+    {
+        retained += chunk->size;
+    }
+
+    fprintf(stderr, "%s arena: %zu allocations, %zu bytes, peak %zu bytes, "
+        "%zu chunk mallocs (%zu bytes retained), %zu resets\n",
+        name, arena->allocations, arena->bytes, arena->peak,
+        arena->chunkMallocs, retained, arena->resets);
+}
@@ -0,0 +1,41 @@
+#ifndef __arena_h_
+#define __arena_h_
+
+#include <stddef.h>
+#include "mem.h"
+
+// Chunks are at least this big, larger requests get a chunk of their own
+#define ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} ARENA_CHUNK;
+
+// Bump allocator: allocation is a pointer bump in the current chunk and
+// everything is released at once by resetArena, which keeps the chunks for reuse.
+typedef struct {
+    ARENA_CHUNK *first;
+    ARENA_CHUNK *current;
+    // what the chunks are counted as, see mem.h
+    MEM_CATEGORY category;
+    // bytes handed out since the last reset
+    size_t live;
+    // counters since startup
+    size_t allocations;
+    size_t bytes;
+    size_t peak;
+    size_t chunkMallocs;
+    size_t resets;
+} ARENA;
+
+void *allocFromArena(ARENA *arena, size_t size);
+void resetArena(ARENA *arena);
+void freeArena(ARENA *arena);
+// Hands the chunks of arena over to the empty into, leaving arena empty with its counters
+void moveArena(ARENA *arena, ARENA *into);
+void printArenaStats(ARENA *arena, const char *name);
+
+#endif
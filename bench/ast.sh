@@ -0,0 +1,96 @@
+#!/bin/sh
+# Size and speed of the parsed and flattened tree: runs two generated lamdas
+# of known node count through the bytecode VM and the tree walker and writes
+# one CSV row per case and engine.
+#
+# usage: bench/ast.sh [binary] [output.csv] [extra cilisp options...]
+#   BENCH_WARMUP  untimed runs per case (default 1)
+#   BENCH_RUNS    timed runs per case, the median is reported (default 5)
+#   BENCH_TERMS   terms of the wide lamda's add (default 6000)
+#   BENCH_DEPTH   conds nested in the deep lamda (default 1000)
+#
+# The columns are:
+#   nodes           AST nodes in the generated expression
+#   ast_bytes       peak of the ast category of --mem-stats: the parse arena,
+#                   which holds the AST and, for the tree walker, its flattened copy
+#   bytes_per_node  ast_bytes divided by nodes
+#   eval_ns         median eval time from --timing
+#   peak_rss_kb     max over the timed runs
+
+BIN=${1:-./cilisp-bench}
+OUT=${2:-bench/ast.csv}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+WARMUP=${BENCH_WARMUP:-1}
+RUNS=${BENCH_RUNS:-5}
+TERMS=${BENCH_TERMS:-6000}
+DEPTH=${BENCH_DEPTH:-1000}
+DIR=$(dirname "$0")
+GEN=$(mktemp -d)
+trap 'rm -rf "$GEN"' EXIT
+
+VERSION=$(git -C "$DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+# A lamda adding TERMS products, 7 nodes each, called for 200 values
+awk -v terms="$TERMS" 'BEGIN {
+    printf "((let (f lambda (x) (add";
+    for (i = 0; i < terms; i++) printf " (mult (sub x %d) (add x %d))", i, i % 7;
+    print "))) (sum_range f 0 200))";
+}' > "$GEN/wide.cilisp"
+
+# A lamda of DEPTH nested conds, 5 nodes each, called for 2000 values
+awk -v depth="$DEPTH" 'BEGIN {
+    body = "x";
+    for (i = depth - 1; i >= 0; i--) body = "(cond (less x " i ") " i " " body ")";
+    print "((let (f lambda (x) " body ")) (sum_range f 0 2000))";
+}' > "$GEN/deep.cilisp"
+
+# the scope, the sum_range call and its three operands come on top of the body
+nodes_wide=$((TERMS * 7 + 6))
+nodes_deep=$((DEPTH * 5 + 6))
+
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print (NR ? v[int((NR + 1) / 2)] : 0) }'
+}
+
+echo "version,case,engine,nodes,runs,ast_bytes,bytes_per_node,eval_ns,peak_rss_kb" > "$OUT"
+
+for name in wide deep
+do
+    eval "nodes=\$nodes_$name"
+
+    for engine in vm tree-walk
+    do
+        flags=
+        [ "$engine" = tree-walk ] && flags=--tree-walk
+
+        i=0
+        while [ $i -lt "$WARMUP" ]
+        do
+            "$BIN" $flags "$@" "$GEN/$name.cilisp" < /dev/null > /dev/null 2>&1
+            i=$((i + 1))
+        done
+
+        : > "$GEN/eval"
+        : > "$GEN/rss"
+        i=0
+        while [ $i -lt "$RUNS" ]
+        do
+            "$BIN" $flags --timing --mem-stats "$@" "$GEN/$name.cilisp" < /dev/null 2> "$GEN/err" > /dev/null
+            sed -n 's/.*eval_ns=\([0-9]*\).*/\1/p' "$GEN/err" >> "$GEN/eval"
+            sed -n 's/.*peak_rss_kb=\([0-9]*\).*/\1/p' "$GEN/err" >> "$GEN/rss"
+            i=$((i + 1))
+        done
+
+        bytes=$(awk '$1 == "ast" { print $3 }' "$GEN/err")
+        per=$(awk -v b="$bytes" -v n="$nodes" 'BEGIN { printf "%.1f", (n ? b / n : 0) }')
+        evalns=$(median < "$GEN/eval")
+        rss=$(sort -n "$GEN/rss" | tail -1)
+
+        echo "$VERSION,$name,$engine,$nodes,$RUNS,$bytes,$per,$evalns,$rss" >> "$OUT"
+        printf "%-5s %-9s %7s nodes %10s bytes %7s B/node %12s eval_ns %8s kb\n" \
+            "$name" "$engine" "$nodes" "$bytes" "$per" "$evalns" "$rss"
+    done
+done
+
+echo "results written to $OUT"
@@ -0,0 +1,91 @@
+#!/bin/sh
+# Runs every bench/*.cilisp program (plus a few generated ones) against a
+# cilisp binary and writes one CSV row per case.
+#
+# usage: bench/bench.sh [binary] [output.csv] [extra cilisp options...]
+#   BENCH_WARMUP  untimed runs per case (default 1)
+#   BENCH_RUNS    timed runs per case, the median is reported (default 5)
+#
+# A case NAME.cilisp reads its (read) input from NAME.input when that exists.
+# The columns are medians over the timed runs, except peak_rss_kb which is the max:
+#   wall_ns      whole process, parse_ns/eval_ns from cilisp --timing,
+#   ns_per_eval  eval_ns divided by the number of top level expressions
+
+BIN=${1:-./cilisp-bench}
+OUT=${2:-bench/results.csv}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+WARMUP=${BENCH_WARMUP:-1}
+RUNS=${BENCH_RUNS:-5}
+DIR=$(dirname "$0")
+GEN=$(mktemp -d)
+trap 'rm -rf "$GEN"' EXIT
+
+VERSION=$(git -C "$DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+# Large generated expressions: a wide add over let bound symbols and a deeply
+# nested arithmetic tree, each repeated on many lines.
+awk 'BEGIN {
+    for (line = 0; line < 50; line++) {
+        printf "((let (x 1) (y 2.5)) (add";
+        for (i = 0; i < 500; i++) printf " (mult x %d) (sub y %d)", i, i;
+        print "))";
+    }
+}' > "$GEN/generated_wide.cilisp"
+
+awk 'BEGIN {
+    for (line = 0; line < 50; line++) {
+        expr = "x";
+        for (i = 0; i < 200; i++) expr = "(add " (i % 2 ? "(mult " expr " 1)" : expr) " " i ")";
+        print "((let (x " line ")) " expr ")";
+    }
+}' > "$GEN/generated_deep.cilisp"
+
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print (NR ? v[int((NR + 1) / 2)] : 0) }'
+}
+
+now_ns() {
+    date +%s%N
+}
+
+echo "version,case,exprs,runs,wall_ns,parse_ns,eval_ns,ns_per_eval,peak_rss_kb" > "$OUT"
+
+for program in "$DIR"/*.cilisp "$GEN"/*.cilisp
+do
+    name=$(basename "$program" .cilisp)
+    input="$DIR/$name.input"
+    [ -f "$input" ] || input=/dev/null
+
+    i=0
+    while [ $i -lt "$WARMUP" ]
+    do
+        "$BIN" "$@" "$program" "$input" > /dev/null 2>&1
+        i=$((i + 1))
+    done
+
+    : > "$GEN/runs"
+    i=0
+    while [ $i -lt "$RUNS" ]
+    do
+        start=$(now_ns)
+        "$BIN" --timing "$@" "$program" "$input" 2> "$GEN/stderr" > /dev/null
+        end=$(now_ns)
+        sed -n 's/^timing: //p' "$GEN/stderr" | tr ' ' '\n' | awk -F= -v wall=$((end - start)) '
+            { v[$1] = $2 }
+            END { print wall, v["exprs"], v["parse_ns"], v["eval_ns"], v["peak_rss_kb"] }' >> "$GEN/runs"
+        i=$((i + 1))
+    done
+
+    exprs=$(awk 'NR == 1 { print $2 }' "$GEN/runs")
+    wall=$(awk '{ print $1 }' "$GEN/runs" | median)
+    parse=$(awk '{ print $3 }' "$GEN/runs" | median)
+    eval=$(awk '{ print $4 }' "$GEN/runs" | median)
+    rss=$(awk '$5 > max { max = $5 } END { print max + 0 }' "$GEN/runs")
+    per_eval=$(awk -v e="$eval" -v n="$exprs" 'BEGIN { print (n ? int(e / n) : 0) }')
+
+    echo "$VERSION,$name,$exprs,$RUNS,$wall,$parse,$eval,$per_eval,$rss" >> "$OUT"
+    printf "%-18s %4s exprs %12s ns/eval %12s parse ns %8s kB\n" "$name" "$exprs" "$per_eval" "$parse" "$rss"
+done
+
+echo "results written to $OUT"
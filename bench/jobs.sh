@@ -0,0 +1,88 @@
+#!/bin/sh
+# Throughput of --jobs: runs one generated file of independent top level
+# expressions at 1, 2, 4, ... threads up to the number of cores and writes
+# one CSV row per thread count.
+#
+# usage: bench/jobs.sh [binary] [output.csv] [extra cilisp options...]
+#   BENCH_WARMUP  untimed runs per thread count (default 1)
+#   BENCH_RUNS    timed runs per thread count, the median is reported (default 5)
+#   BENCH_EXPRS   top level expressions in the generated file (default 2000)
+#   BENCH_THREADS largest thread count (default: online cores)
+#
+# The columns are medians over the timed runs:
+#   wall_ns        whole process
+#   exprs_per_sec  top level expressions evaluated per second of wall time
+#   speedup        wall time at 1 thread divided by wall time at this count
+
+BIN=${1:-./cilisp-bench}
+OUT=${2:-bench/jobs.csv}
+[ $# -gt 0 ] && shift
+[ $# -gt 0 ] && shift
+WARMUP=${BENCH_WARMUP:-1}
+RUNS=${BENCH_RUNS:-5}
+EXPRS=${BENCH_EXPRS:-2000}
+MAX=${BENCH_THREADS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}
+DIR=$(dirname "$0")
+GEN=$(mktemp -d)
+trap 'rm -rf "$GEN"' EXIT
+
+VERSION=$(git -C "$DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+# Recursive lamdas of varying cost, none of them using read, print or rand
+awk -v exprs="$EXPRS" 'BEGIN {
+    for (line = 0; line < exprs; line++) {
+        printf "((let (fib lambda (n) (cond (less n 2) n (add (fib (sub n 1)) (fib (sub n 2))))))";
+        printf " (add (fib %d) %d))\n", 12 + line % 6, line;
+    }
+}' > "$GEN/jobs.cilisp"
+
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print (NR ? v[int((NR + 1) / 2)] : 0) }'
+}
+
+now_ns() {
+    date +%s%N
+}
+
+echo "version,threads,exprs,runs,wall_ns,exprs_per_sec,speedup" > "$OUT"
+
+threads=1
+base=0
+while [ "$threads" -le "$MAX" ]
+do
+    i=0
+    while [ $i -lt "$WARMUP" ]
+    do
+        "$BIN" --jobs "$threads" "$@" "$GEN/jobs.cilisp" > /dev/null 2>&1
+        i=$((i + 1))
+    done
+
+    : > "$GEN/runs"
+    i=0
+    while [ $i -lt "$RUNS" ]
+    do
+        start=$(now_ns)
+        "$BIN" --jobs "$threads" "$@" "$GEN/jobs.cilisp" > /dev/null 2>&1
+        end=$(now_ns)
+        echo $((end - start)) >> "$GEN/runs"
+        i=$((i + 1))
+    done
+
+    wall=$(median < "$GEN/runs")
+    [ "$base" -eq 0 ] && base=$wall
+    rate=$(awk -v n="$EXPRS" -v w="$wall" 'BEGIN { print (w ? int(n * 1e9 / w) : 0) }')
+    speedup=$(awk -v b="$base" -v w="$wall" 'BEGIN { printf "%.2f", (w ? b / w : 0) }')
+
+    echo "$VERSION,$threads,$EXPRS,$RUNS,$wall,$rate,$speedup" >> "$OUT"
+    printf "%3s threads %12s ns %10s exprs/s %6sx\n" "$threads" "$wall" "$rate" "$speedup"
+
+    # 1, 2, 4, ... and the core count itself when it is not a power of two
+    if [ "$threads" -lt "$MAX" ] && [ $((threads * 2)) -gt "$MAX" ]
+    then
+        threads=$MAX
+    else
+        threads=$((threads * 2))
+    fi
+done
+
+echo "results written to $OUT"
@@ -0,0 +1,1478 @@
+#include "bytecode.h"
+#include "interp.h"
+#include "memo.h"
+#include "vector.h"
+#include "number.h"
+#include "types.h"
+
+// Computed goto dispatch needs the GNU "labels as values" extension,
+// build with -DCILISP_NO_THREADED to fall back to a plain switch.
+#if defined(__GNUC__) && !defined(CILISP_NO_THREADED)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+#define INITIAL_ARRAY_SIZE 16
+
+typedef enum {
+    UNARY_BUILTIN,          // extra operands are silently ignored
+    UNARY_STRICT_BUILTIN,   // extra operands are ignored with a warning
+    BINARY_BUILTIN,
+    FOLD_BUILTIN,           // any number of operands, combined left to right
+    VARIADIC_BUILTIN,
+    NULLARY_BUILTIN,
+    COMPARE_BUILTIN
+} BUILTIN_KIND;
+
+typedef struct {
+    OPCODE op;
+    BUILTIN_KIND kind;
+    char *name;
+    // warning and result when no operands are given, a variadic builtin
+    // without a warning runs with none
+    char *noOperands;
+    RET_VAL empty;
+    // operands a variadic builtin takes before the rest are ignored, 0 for any number
+    size_t maxOperands;
+} BUILTIN;
+
+// Indexed by FUNC_TYPE, the messages match the eval*FuncNode functions in cilisp.c
+static const BUILTIN builtins[] = {
+    [NEG_FUNC] = {OP_NEG, UNARY_BUILTIN, "neg", "No operands passed into neg", NAN_RET_VAL},
+    [ABS_FUNC] = {OP_ABS, UNARY_BUILTIN, "abs", "No operands passed into abs", NAN_RET_VAL},
+    [ADD_FUNC] = {OP_ADD, FOLD_BUILTIN, "add", "No operands passed into add!", ZERO_RET_VAL},
+    [SUB_FUNC] = {OP_SUB, BINARY_BUILTIN, "sub", "No operands passed into sub!", NAN_RET_VAL},
+    [MULT_FUNC] = {OP_MULT, FOLD_BUILTIN, "mult", "No operands passed into mult!", INT_RET_VAL(1)},
+    [DIV_FUNC] = {OP_DIV, BINARY_BUILTIN, "div", "No operands passed into div!", NAN_RET_VAL},
+    [REM_FUNC] = {OP_REM, BINARY_BUILTIN, "remainder", "No operands passed into remainder!", NAN_RET_VAL},
+    [EXP_FUNC] = {OP_EXP, UNARY_STRICT_BUILTIN, "exp", "No operands passed into exp!", NAN_RET_VAL},
+    [EXP2_FUNC] = {OP_EXP2, UNARY_STRICT_BUILTIN, "exp2", "No operands passed into exp2!", NAN_RET_VAL},
+    [POW_FUNC] = {OP_POW, BINARY_BUILTIN, "pow", "No operands passed into pow!", NAN_RET_VAL},
+    [LOG_FUNC] = {OP_LOG, UNARY_STRICT_BUILTIN, "log", "No operands passed into log!", NAN_RET_VAL},
+    [SQRT_FUNC] = {OP_SQRT, UNARY_STRICT_BUILTIN, "sqrt", "No operands passed into sqrt!", NAN_RET_VAL},
+    [CBRT_FUNC] = {OP_CBRT, UNARY_STRICT_BUILTIN, "cbrt", "No operands passed into cbrt!", NAN_RET_VAL},
+    [HYPOT_FUNC] = {OP_HYPOT, VARIADIC_BUILTIN, "hypot", "No operands passed into hypot!", ZERO_RET_VAL},
+    [MAX_FUNC] = {OP_MAX, FOLD_BUILTIN, "max", "No operands passed into max!", NAN_RET_VAL},
+    [MIN_FUNC] = {OP_MIN, FOLD_BUILTIN, "min", "No operands passed into min!", NAN_RET_VAL},
+    [RAND_FUNC] = {OP_RAND, NULLARY_BUILTIN, "rand", NULL, NAN_RET_VAL},
+    [READ_FUNC] = {OP_READ, NULLARY_BUILTIN, "read", NULL, NAN_RET_VAL},
+    [MEMSTATS_FUNC] = {OP_MEMSTATS, NULLARY_BUILTIN, "memstats", NULL, ZERO_RET_VAL},
+    [EQUAL_FUNC] = {OP_EQUAL, COMPARE_BUILTIN, "equal", "No operands passed into equal!", ZERO_RET_VAL},
+    [LESS_FUNC] = {OP_LESS, COMPARE_BUILTIN, "less", "No operands passed into equal!", ZERO_RET_VAL},
+    [GREATER_FUNC] = {OP_GREATER, COMPARE_BUILTIN, "greater", "No operands passed into equal!", ZERO_RET_VAL},
+    [PRINT_FUNC] = {OP_PRINT, UNARY_STRICT_BUILTIN, "print", "No operands passed into print", NAN_RET_VAL},
+    [VECTOR_FUNC] = {OP_VECTOR, VARIADIC_BUILTIN, "vector", NULL, NAN_RET_VAL},
+    [RANGE_FUNC] = {OP_RANGE, VARIADIC_BUILTIN, "range", "No operands passed into range!", NAN_RET_VAL, 3},
+    [SUM_FUNC] = {OP_SUM, UNARY_STRICT_BUILTIN, "sum", "No operands passed into sum!", ZERO_RET_VAL},
+    [DOT_FUNC] = {OP_DOT, BINARY_BUILTIN, "dot", "No operands passed into dot!", NAN_RET_VAL},
+    [LEN_FUNC] = {OP_LEN, UNARY_STRICT_BUILTIN, "len", "No operands passed into len!", ZERO_RET_VAL}
+};
+
+// Number of int32 operands following each opcode
+static const int opOperandCounts[OP_COUNT] = {
+    [OP_CONST] = 1, [OP_WARN] = 1, [OP_POP] = 1, [OP_JUMP] = 1, [OP_JUMP_FALSE] = 1,
+    [OP_LOAD_LOCAL] = 1, [OP_LOAD] = 2, [OP_LOAD_LET] = 3, [OP_CAST] = 1,
+    [OP_CALL] = 3, [OP_TAIL_CALL] = 3, [OP_MEMO_CALL] = 3, [OP_THUNK_RETURN] = 1,
+    [OP_ADD] = 1, [OP_MULT] = 1, [OP_HYPOT] = 1, [OP_MAX] = 1, [OP_MIN] = 1,
+    [OP_EQUAL] = 1, [OP_LESS] = 1, [OP_GREATER] = 1, [OP_VECTOR] = 1, [OP_RANGE] = 1,
+    [OP_LOOP_START] = 2, [OP_LOOP_NEXT] = 1
+};
+
+static const char *opNames[OP_COUNT] = {
+    [OP_CONST] = "CONST", [OP_WARN] = "WARN", [OP_POP] = "POP", [OP_JUMP] = "JUMP",
+    [OP_JUMP_FALSE] = "JUMP_FALSE", [OP_LOAD_LOCAL] = "LOAD_LOCAL", [OP_LOAD] = "LOAD",
+    [OP_LOAD_LET] = "LOAD_LET", [OP_CAST] = "CAST", [OP_CALL] = "CALL", [OP_TAIL_CALL] = "TAIL_CALL", [OP_MEMO_CALL] = "MEMO_CALL", [OP_RETURN] = "RETURN",
+    [OP_THUNK_RETURN] = "THUNK_RETURN", [OP_HALT] = "HALT", [OP_NEG] = "NEG", [OP_ABS] = "ABS",
+    [OP_ADD] = "ADD", [OP_SUB] = "SUB", [OP_MULT] = "MULT", [OP_DIV] = "DIV", [OP_REM] = "REM",
+    [OP_EXP] = "EXP", [OP_EXP2] = "EXP2", [OP_POW] = "POW", [OP_LOG] = "LOG", [OP_SQRT] = "SQRT",
+    [OP_CBRT] = "CBRT", [OP_HYPOT] = "HYPOT", [OP_MAX] = "MAX", [OP_MIN] = "MIN", [OP_RAND] = "RAND",
+    [OP_READ] = "READ", [OP_MEMSTATS] = "MEMSTATS", [OP_EQUAL] = "EQUAL", [OP_LESS] = "LESS", [OP_GREATER] = "GREATER",
+    [OP_COMPARE_TRUE] = "COMPARE_TRUE", [OP_PRINT] = "PRINT", [OP_VECTOR] = "VECTOR",
+    [OP_RANGE] = "RANGE", [OP_SUM] = "SUM", [OP_DOT] = "DOT", [OP_LEN] = "LEN",
+    [OP_ADD_INT] = "ADD_INT", [OP_SUB_INT] = "SUB_INT", [OP_MULT_INT] = "MULT_INT", [OP_DIV_INT] = "DIV_INT",
+    [OP_ADD_DOUBLE] = "ADD_DOUBLE", [OP_SUB_DOUBLE] = "SUB_DOUBLE", [OP_MULT_DOUBLE] = "MULT_DOUBLE",
+    [OP_DIV_DOUBLE] = "DIV_DOUBLE",
+    [OP_LOOP_START] = "LOOP_START", [OP_LOOP_NEXT] = "LOOP_NEXT", [OP_LOOP_ADD] = "LOOP_ADD",
+    [OP_LOOP_MULT] = "LOOP_MULT", [OP_LOOP_COUNT] = "LOOP_COUNT", [OP_LOOP_ARGS] = "LOOP_ARGS",
+    [OP_LOOP_STORE] = "LOOP_STORE"
+};
+
+typedef struct {
+    INTERP *interp;
+    BYTECODE *bc;
+    // operand stack depth of the code being emitted
+    long depth;
+    long maxDepth;
+} COMPILER;
+
+static void compileNode(COMPILER *c, AST_NODE *node);
+
+// Makes room for one more element in a dynamic array
+static void *bcGrow(MEM_CATEGORY category, void *array, size_t *cap, size_t len, size_t elemSize)
+{
+    if (len < *cap)
+    {
+        return array;
+    }
+
+    *cap = *cap ? *cap * 2 : INITIAL_ARRAY_SIZE;
+    if ((array = memRealloc(category, array, *cap * elemSize)) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    return array;
+}
+
+static void emitWord(COMPILER *c, int32_t word)
+{
+    BYTECODE *bc = c->bc;
+    bc->code = bcGrow(MEM_BYTECODE, bc->code, &bc->codeCap, bc->codeLen, sizeof(int32_t));
+    bc->code[bc->codeLen++] = word;
+}
+
+// Emits an opcode and tracks how it changes the operand stack depth
+static void emitOp(COMPILER *c, OPCODE op, long stackEffect)
+{
+    emitWord(c, op);
+    c->depth += stackEffect;
+    if (c->depth > c->maxDepth)
+    {
+        c->maxDepth = c->depth;
+    }
+}
+
+// Emits a jump with a placeholder target, returns where to patch it
+static size_t emitJump(COMPILER *c, OPCODE op, long stackEffect)
+{
+    emitOp(c, op, stackEffect);
+    emitWord(c, 0);
+    return c->bc->codeLen - 1;
+}
+
+static void patchJump(COMPILER *c, size_t at)
+{
+    c->bc->code[at] = (int32_t) c->bc->codeLen;
+}
+
+static int32_t addConst(COMPILER *c, RET_VAL value)
+{
+    BYTECODE *bc = c->bc;
+    bc->consts = bcGrow(MEM_BYTECODE, bc->consts, &bc->constCap, bc->constLen, sizeof(RET_VAL));
+    bc->consts[bc->constLen] = value;
+    return (int32_t) bc->constLen++;
+}
+
+static void emitConst(COMPILER *c, RET_VAL value)
+{
+    emitOp(c, OP_CONST, 1);
+    emitWord(c, addConst(c, value));
+}
+
+static int32_t addString(COMPILER *c, char *string)
+{
+    BYTECODE *bc = c->bc;
+    bc->strings = bcGrow(MEM_BYTECODE, bc->strings, &bc->stringCap, bc->stringLen, sizeof(char *));
+    // the string lives in the parse arena along with the AST
+    bc->strings[bc->stringLen] = cloneString(c->interp, string);
+    return (int32_t) bc->stringLen++;
+}
+
+// Emits a warning that is printed every time the instruction runs
+static void emitWarning(COMPILER *c, char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start (args, format);
+    vsnprintf (buffer, 255, format, args);
+    va_end (args);
+
+    emitOp(c, OP_WARN, 0);
+    emitWord(c, addString(c, buffer));
+}
+
+static size_t countSymbols(SYMBOL_TABLE_NODE *symbol)
+{
+    size_t count = 0;
+    while (symbol != NULL)
+    {
+        count++;
+        symbol = symbol->next;
+    }
+    return count;
+}
+
+// Compiles a lambda body into its own function, its frame was laid out by resolveSymbols
+static void compileLambda(COMPILER *c, SYMBOL_TABLE_NODE *lamda)
+{
+    long depth = c->depth;
+    long maxDepth = c->maxDepth;
+    BC_FUNCTION *function = &c->bc->functions[lamda->index];
+
+    *function = (BC_FUNCTION){lamda->id, c->bc->codeLen, 0, countSymbols(lamda->arg_list), lamda->frameSize,
+        memoTableFor(c->interp, lamda), lamda};
+
+    c->depth = 0;
+    c->maxDepth = 0;
+
+    compileNode(c, lamda->value);
+
+    if (lamda->type != NO_TYPE)
+    {
+        emitOp(c, OP_CAST, 0);
+        emitWord(c, lamda->type);
+    }
+    emitOp(c, OP_RETURN, -1);
+
+    function->maxStack = c->maxDepth;
+    c->depth = depth;
+    c->maxDepth = maxDepth;
+}
+
+// Compiles a let value into a thunk that runs in the frame owning its slot
+static void compileThunk(COMPILER *c, SYMBOL_TABLE_NODE *symbol)
+{
+    long depth = c->depth;
+    long maxDepth = c->maxDepth;
+
+    c->bc->thunks[symbol->index] = (BC_FUNCTION){symbol->id, c->bc->codeLen, 0, 0, 0, NULL, NULL};
+    c->depth = 0;
+    c->maxDepth = 0;
+
+    compileNode(c, symbol->value);
+    // a typed let is cast once, when forced
+    if (symbol->type != NO_TYPE)
+    {
+        emitOp(c, OP_CAST, 0);
+        emitWord(c, symbol->type);
+    }
+    emitOp(c, OP_THUNK_RETURN, -1);
+    emitWord(c, symbol->slot);
+
+    c->bc->thunks[symbol->index].maxStack = c->maxDepth;
+    c->depth = depth;
+    c->maxDepth = maxDepth;
+}
+
+static void compileSymbol(COMPILER *c, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *symbol = node->data.symbol.binding;
+    int32_t depth = node->data.symbol.depth;
+
+    // undefined symbols were reported by resolveSymbols
+    if (symbol == NULL)
+    {
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (symbol->symbolType == ARG_TYPE)
+    {
+        if (depth == 0)
+        {
+            emitOp(c, OP_LOAD_LOCAL, 1);
+        }
+        else
+        {
+            emitOp(c, OP_LOAD, 1);
+            emitWord(c, depth);
+        }
+        emitWord(c, symbol->slot);
+        return;
+    }
+
+    emitOp(c, OP_LOAD_LET, 1);
+    emitWord(c, depth);
+    emitWord(c, symbol->slot);
+    emitWord(c, symbol->index);
+}
+
+static void compileCall(COMPILER *c, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *lamda = node->data.function.binding;
+
+    // undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL)
+    {
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    size_t nargs = countSymbols(lamda->arg_list);
+    size_t count = 0;
+    AST_NODE *op = node->data.function.opList;
+
+    while (op != NULL && count < nargs)
+    {
+        compileNode(c, op);
+        op = op->next;
+        count++;
+    }
+
+    if (count < nargs)
+    {
+        // the arguments are still evaluated for their side effects
+        if (count > 0)
+        {
+            emitOp(c, OP_POP, -(long) count);
+            emitWord(c, (int32_t) count);
+        }
+        emitWarning(c, "Not enough arguments passed into lamda: %s", lamda->id);
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (op != NULL)
+    {
+        emitWarning(c, "lamda: %s called with extra (ignored) arguments!!", lamda->id);
+    }
+
+    // tail calls win over the cache so loops keep running in constant space
+    OPCODE call = OP_CALL;
+    if (node->data.function.tail)
+    {
+        call = OP_TAIL_CALL;
+    }
+    else if (memoTableFor(c->interp, lamda) != NULL)
+    {
+        call = OP_MEMO_CALL;
+    }
+
+    emitOp(c, call, 1 - (long) nargs);
+    emitWord(c, node->data.function.depth);
+    emitWord(c, lamda->index);
+    emitWord(c, (int32_t) nargs);
+}
+
+static void emitLamdaCall(COMPILER *c, AST_NODE *operand, SYMBOL_TABLE_NODE *lamda, size_t nargs)
+{
+    emitOp(c, memoTableFor(c->interp, lamda) != NULL ? OP_MEMO_CALL : OP_CALL, 1 - (long) nargs);
+    emitWord(c, operand->data.symbol.depth);
+    emitWord(c, lamda->index);
+    emitWord(c, (int32_t) nargs);
+}
+
+// Compiles sum_range, prod_range, count_range and fold_range into a loop
+// around a call of the lamda, checked the same way evalRangeLoopFuncNode does.
+static void compileRangeLoop(COMPILER *c, AST_NODE *node)
+{
+    FUNC_TYPE func = node->data.function.func;
+    const char *name = nameOfFunc(func);
+    AST_NODE *current = node->data.function.opList;
+    size_t needed = func == FOLD_RANGE_FUNC ? 5 : 3;
+    size_t count = countOperands(current);
+
+    if (count == 0)
+    {
+        emitWarning(c, "No operands passed into %s!", name);
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (count < needed)
+    {
+        emitWarning(c, "Not enough operands passed into %s!", name);
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (count > needed)
+    {
+        emitWarning(c, "%s called with extra (ignored) operands!!", name);
+    }
+
+    AST_NODE *fold = NULL;
+    if (func == FOLD_RANGE_FUNC)
+    {
+        fold = current;
+        current = current->next;
+    }
+    AST_NODE *body = current;
+    current = current->next;
+
+    SYMBOL_TABLE_NODE *lamda = rangeLoopLamda(body);
+    SYMBOL_TABLE_NODE *op = rangeLoopLamda(fold);
+
+    // bad and undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL || (fold != NULL && op == NULL))
+    {
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (countSymbols(lamda->arg_list) != 1)
+    {
+        emitWarning(c, "%s needs a lamda of one argument, %s isn't!", name, lamda->id);
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (op != NULL && countSymbols(op->arg_list) != 2)
+    {
+        emitWarning(c, "%s needs a lamda of two arguments, %s isn't!", name, op->id);
+        emitConst(c, NAN_RET_VAL);
+        return;
+    }
+
+    if (func == FOLD_RANGE_FUNC)
+    {
+        compileNode(c, current);
+        current = current->next;
+    }
+    else
+    {
+        emitConst(c, func == PROD_RANGE_FUNC ? INT_RET_VAL(1) : ZERO_RET_VAL);
+    }
+
+    compileNode(c, current);
+    compileNode(c, current->next);
+
+    char message[256];
+    snprintf(message, sizeof(message), "%s bounds must be integers!", name);
+    size_t fail = emitJump(c, OP_LOOP_START, 0);
+    emitWord(c, addString(c, message));
+
+    size_t loop = c->bc->codeLen;
+    size_t end = emitJump(c, OP_LOOP_NEXT, 1);
+
+    emitLamdaCall(c, body, lamda, 1);
+
+    switch (func)
+    {
+    case SUM_RANGE_FUNC:
+        emitOp(c, OP_LOOP_ADD, -1);
+        break;
+    case PROD_RANGE_FUNC:
+        emitOp(c, OP_LOOP_MULT, -1);
+        break;
+    case COUNT_RANGE_FUNC:
+        emitOp(c, OP_LOOP_COUNT, -1);
+        break;
+    default:
+        emitOp(c, OP_LOOP_ARGS, 1);
+        emitLamdaCall(c, fold, op, 2);
+        emitOp(c, OP_LOOP_STORE, -1);
+    }
+
+    emitOp(c, OP_JUMP, 0);
+    emitWord(c, (int32_t) loop);
+
+    // both ways out leave just the result
+    patchJump(c, fail);
+    patchJump(c, end);
+    c->depth -= 2;
+}
+
+// Emits the short circuiting comparison chain used by equal, less and greater
+static void compileCompare(COMPILER *c, OPCODE op, AST_NODE *current)
+{
+    size_t fails[countOperands(current)];
+    size_t nfails = 0;
+
+    compileNode(c, current);
+
+    while (current->next != NULL)
+    {
+        compileNode(c, current->next);
+        fails[nfails++] = emitJump(c, op, -1);
+        current = current->next;
+    }
+
+    emitOp(c, OP_COMPARE_TRUE, 0);
+
+    if (nfails == 0)
+    {
+        return;
+    }
+
+    size_t end = emitJump(c, OP_JUMP, 0);
+
+    for (size_t i = 0; i < nfails; i++)
+    {
+        patchJump(c, fails[i]);
+    }
+    c->depth--;
+    emitConst(c, ZERO_RET_VAL);
+
+    patchJump(c, end);
+}
+
+// The kernel of number.h an arithmetic op has for operands of type
+static OPCODE kernelOp(OPCODE op, NUM_TYPE type)
+{
+    bool ints = type == INT_TYPE;
+
+    if (type == NO_TYPE)
+    {
+        return op;
+    }
+
+    switch (op)
+    {
+    case OP_ADD:
+        return ints ? OP_ADD_INT : OP_ADD_DOUBLE;
+    case OP_SUB:
+        return ints ? OP_SUB_INT : OP_SUB_DOUBLE;
+    case OP_MULT:
+        return ints ? OP_MULT_INT : OP_MULT_DOUBLE;
+    case OP_DIV:
+        return ints ? OP_DIV_INT : OP_DIV_DOUBLE;
+    default:
+        return op;
+    }
+}
+
+static void compileFunction(COMPILER *c, AST_NODE *node)
+{
+    FUNC_TYPE func = node->data.function.func;
+
+    if (func == CUSTOM_FUNC)
+    {
+        compileCall(c, node);
+        return;
+    }
+
+    if (lamdaOperandCount(func) > 0)
+    {
+        compileRangeLoop(c, node);
+        return;
+    }
+
+    if (func < NEG_FUNC || func > LEN_FUNC)
+    {
+        yyerror("Invalid function type passed into compileFunction!");
+        return;
+    }
+
+    const BUILTIN *builtin = &builtins[func];
+    AST_NODE *opList = node->data.function.opList;
+    size_t count = countOperands(opList);
+
+    if (builtin->kind == NULLARY_BUILTIN)
+    {
+        if (count > 0)
+        {
+            emitWarning(c, "%s called with extra (ignored) operands!!", builtin->name);
+        }
+        emitOp(c, builtin->op, 1);
+        return;
+    }
+
+    if (count == 0 && builtin->noOperands != NULL)
+    {
+        emitWarning(c, "%s", builtin->noOperands);
+        emitConst(c, builtin->empty);
+        return;
+    }
+
+    // two operands of one known type go to an int or double kernel
+    if (count == 2)
+    {
+        OPCODE kernel = kernelOp(builtin->op, kernelType(opList->types, opList->next->types));
+
+        if (kernel != builtin->op)
+        {
+            compileNode(c, opList);
+            compileNode(c, opList->next);
+            emitOp(c, kernel, -1);
+            return;
+        }
+    }
+
+    switch (builtin->kind)
+    {
+    case UNARY_STRICT_BUILTIN:
+        if (count > 1)
+        {
+            emitWarning(c, "%s called with extra (ignored) operands!!", builtin->name);
+        }
+        // fall through
+    case UNARY_BUILTIN:
+        compileNode(c, opList);
+        emitOp(c, builtin->op, 0);
+        break;
+    case BINARY_BUILTIN:
+        if (count == 1)
+        {
+            emitWarning(c, "Only one operand passed into %s!", builtin->name);
+            emitConst(c, NAN_RET_VAL);
+            break;
+        }
+        if (count > 2)
+        {
+            emitWarning(c, "%s called with extra (ignored) operands!!", builtin->name);
+        }
+        compileNode(c, opList);
+        compileNode(c, opList->next);
+        emitOp(c, builtin->op, -1);
+        break;
+    case FOLD_BUILTIN:
+        // each operand is combined as soon as it is evaluated, the way the
+        // tree walker does it, so warnings come out in the same order
+        compileNode(c, opList);
+        if (count == 1)
+        {
+            emitOp(c, builtin->op, 0);
+            emitWord(c, 1);
+            break;
+        }
+        for (AST_NODE *op = opList->next; op != NULL; op = op->next)
+        {
+            compileNode(c, op);
+            emitOp(c, builtin->op, -1);
+            emitWord(c, 2);
+        }
+        break;
+    case VARIADIC_BUILTIN:
+        if (builtin->maxOperands > 0 && count > builtin->maxOperands)
+        {
+            emitWarning(c, "%s called with extra (ignored) operands!!", builtin->name);
+            count = builtin->maxOperands;
+        }
+        AST_NODE *op = opList;
+        for (size_t i = 0; i < count; i++, op = op->next)
+        {
+            compileNode(c, op);
+        }
+        emitOp(c, builtin->op, 1 - (long) count);
+        emitWord(c, (int32_t) count);
+        break;
+    case COMPARE_BUILTIN:
+        compileCompare(c, builtin->op, opList);
+        break;
+    default:
+        yyerror("Invalid builtin kind in compileFunction!");
+    }
+}
+
+// Emits the thunks and lambda bodies of a scope's let section out of line,
+// then the expression it applies to.
+static void compileScope(COMPILER *c, AST_NODE *node)
+{
+    if (node->data.scope.symbols != NULL)
+    {
+        size_t skip = emitJump(c, OP_JUMP, 0);
+
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (symbol->symbolType == LAMBDA_TYPE)
+            {
+                compileLambda(c, symbol);
+            }
+            else
+            {
+                compileThunk(c, symbol);
+            }
+        }
+
+        patchJump(c, skip);
+    }
+
+    compileNode(c, node->data.scope.child);
+}
+
+static void compileExpression(COMPILER *c, AST_NODE *node)
+{
+    switch (node->type)
+    {
+    case NUM_NODE_TYPE:
+        emitConst(c, node->data.number);
+        break;
+    case FUNC_NODE_TYPE:
+        compileFunction(c, node);
+        break;
+    case SYM_NODE_TYPE:
+        compileSymbol(c, node);
+        break;
+    case SCOPE_NODE_TYPE:
+        compileScope(c, node);
+        break;
+    case COND_NODE_TYPE:
+    {
+        compileNode(c, node->data.cond.contiditonal);
+        size_t otherwise = emitJump(c, OP_JUMP_FALSE, -1);
+        compileNode(c, node->data.cond.true_node);
+        size_t end = emitJump(c, OP_JUMP, 0);
+        patchJump(c, otherwise);
+        c->depth--;
+        compileNode(c, node->data.cond.false_node);
+        patchJump(c, end);
+        break;
+    }
+    default:
+        yyerror("Incorrect ast node passed into compileExpression!");
+    }
+}
+
+static void compileNode(COMPILER *c, AST_NODE *node)
+{
+    if (!node)
+    {
+        yyerror("NULL ast node passed into compileNode!");
+        return;
+    }
+
+    compileExpression(c, node);
+}
+
+// Lowers a resolved top level expression into bytecode, the result must not outlive the AST
+BYTECODE *compileBytecode(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info)
+{
+    BYTECODE *bc;
+
+    if ((bc = memCalloc(MEM_BYTECODE, 1, sizeof(BYTECODE))) == NULL
+        || (bc->functions = memCalloc(MEM_BYTECODE, info->lamdas + 1, sizeof(BC_FUNCTION))) == NULL
+        || (bc->thunks = memCalloc(MEM_BYTECODE, info->vars + 1, sizeof(BC_FUNCTION))) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    bc->functionLen = bc->functionCap = info->lamdas + 1;
+    bc->thunkLen = bc->thunkCap = info->vars;
+    bc->functions[0] = (BC_FUNCTION){"top level", 0, 0, 0, info->frameSize, NULL, NULL};
+
+    COMPILER c = {interp, bc, 0, 0};
+
+    compileNode(&c, node);
+    emitOp(&c, OP_HALT, -1);
+
+    bc->functions[0].maxStack = c.maxDepth;
+
+    return bc;
+}
+
+void freeBytecode(BYTECODE *bc)
+{
+    if (bc == NULL)
+    {
+        return;
+    }
+
+    memFree(bc->code);
+    memFree(bc->consts);
+    memFree(bc->strings);
+    memFree(bc->functions);
+    memFree(bc->thunks);
+    memFree(bc);
+}
+
+void printBytecode(BYTECODE *bc)
+{
+    for (size_t i = 0; i < bc->functionLen; i++)
+    {
+        BC_FUNCTION *f = &bc->functions[i];
+        // lamdas in folded away cond branches are never compiled
+        if (f->name == NULL)
+        {
+            continue;
+        }
+        printf("function %zu %s: entry %zu, args %zu, slots %zu, stack %zu\n",
+            i, f->name, f->entry, f->nargs, f->nslots, f->maxStack);
+    }
+
+    for (size_t i = 0; i < bc->thunkLen; i++)
+    {
+        BC_FUNCTION *t = &bc->thunks[i];
+        if (t->name == NULL)
+        {
+            continue;
+        }
+        printf("thunk %zu %s: entry %zu, stack %zu\n", i, t->name, t->entry, t->maxStack);
+    }
+
+    size_t pc = 0;
+    while (pc < bc->codeLen)
+    {
+        OPCODE op = bc->code[pc];
+        printf("%5zu  %-13s", pc, opNames[op]);
+
+        for (int i = 1; i <= opOperandCounts[op]; i++)
+        {
+            printf(" %d", bc->code[pc + i]);
+        }
+
+        if (op == OP_CONST)
+        {
+            RET_VAL value = bc->consts[bc->code[pc + 1]];
+            if (value.type == INT_TYPE)
+            {
+                printf("  (int %lld)", (long long) value.integer);
+            }
+            else if (value.type == VECTOR_TYPE)
+            {
+                printf("  (vector of %zu)", value.vector->len);
+            }
+            else
+            {
+                printf("  (double %g)", value.value);
+            }
+        }
+        else if (op == OP_WARN)
+        {
+            printf("  \"%s\"", bc->strings[bc->code[pc + 1]]);
+        }
+
+        printf("\n");
+        pc += 1 + opOperandCounts[op];
+    }
+}
+
+// Follows static links from a frame to the frame of an enclosing lambda
+static inline size_t vmEnclosingFrame(VM_STACK *vm, size_t frame, int32_t depth)
+{
+    while (depth-- > 0)
+    {
+        frame = vm->frames[frame].link;
+    }
+    return frame;
+}
+
+static void vmGrowStack(VM_STACK *vm, size_t needed)
+{
+    size_t cap = vm->stackCap ? vm->stackCap : 256;
+    while (cap < needed)
+    {
+        cap *= 2;
+    }
+
+    if ((vm->stack = memRealloc(MEM_STACKS, vm->stack, cap * sizeof(RET_VAL))) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+    vm->stackCap = cap;
+}
+
+static inline void vmPushFrame(VM_STACK *vm, size_t *nframes, VM_FRAME frame)
+{
+    vm->frames = bcGrow(MEM_STACKS, vm->frames, &vm->frameCap, *nframes, sizeof(VM_FRAME));
+    vm->frames[(*nframes)++] = frame;
+}
+
+RET_VAL runBytecode(INTERP *interp, BYTECODE *bc)
+{
+    VM_STACK *vm = &interp->vm;
+    const int32_t *code = bc->code;
+    const RET_VAL *consts = bc->consts;
+    BC_FUNCTION *top = &bc->functions[0];
+
+    if (vm->stackCap < top->nslots + top->maxStack)
+    {
+        vmGrowStack(vm, top->nslots + top->maxStack);
+    }
+
+    size_t nframes = 0;
+    size_t env = 0;
+    vmPushFrame(vm, &nframes, (VM_FRAME){NULL, 0, 0, 0, NULL});
+
+    RET_VAL *bp = vm->stack;
+    RET_VAL *sp = vm->stack;
+    for (size_t i = 0; i < top->nslots; i++)
+    {
+        *sp++ = UNFORCED_SLOT;
+    }
+
+    const int32_t *ip = code + top->entry;
+
+// Keeps sp and bp valid when the value stack has to move
+#define VM_RESERVE(n) \
+    if ((size_t) (sp - vm->stack) + (n) > vm->stackCap) \
+    { \
+        size_t used = sp - vm->stack; \
+        vmGrowStack(vm, used + (n)); \
+        sp = vm->stack + used; \
+        bp = vm->stack + vm->frames[env].base; \
+    }
+
+#if VM_THREADED
+    static void *dispatch[OP_COUNT] = {
+        [OP_CONST] = &&TARGET_OP_CONST, [OP_WARN] = &&TARGET_OP_WARN, [OP_POP] = &&TARGET_OP_POP,
+        [OP_JUMP] = &&TARGET_OP_JUMP, [OP_JUMP_FALSE] = &&TARGET_OP_JUMP_FALSE,
+        [OP_LOAD_LOCAL] = &&TARGET_OP_LOAD_LOCAL, [OP_LOAD] = &&TARGET_OP_LOAD,
+        [OP_LOAD_LET] = &&TARGET_OP_LOAD_LET, [OP_CAST] = &&TARGET_OP_CAST, [OP_CALL] = &&TARGET_OP_CALL,
+        [OP_TAIL_CALL] = &&TARGET_OP_TAIL_CALL, [OP_MEMO_CALL] = &&TARGET_OP_MEMO_CALL,
+        [OP_RETURN] = &&TARGET_OP_RETURN,
+        [OP_THUNK_RETURN] = &&TARGET_OP_THUNK_RETURN,
+        [OP_HALT] = &&TARGET_OP_HALT, [OP_NEG] = &&TARGET_OP_NEG, [OP_ABS] = &&TARGET_OP_ABS,
+        [OP_ADD] = &&TARGET_OP_ADD, [OP_SUB] = &&TARGET_OP_SUB, [OP_MULT] = &&TARGET_OP_MULT,
+        [OP_DIV] = &&TARGET_OP_DIV, [OP_REM] = &&TARGET_OP_REM, [OP_EXP] = &&TARGET_OP_EXP,
+        [OP_EXP2] = &&TARGET_OP_EXP2, [OP_POW] = &&TARGET_OP_POW, [OP_LOG] = &&TARGET_OP_LOG,
+        [OP_SQRT] = &&TARGET_OP_SQRT, [OP_CBRT] = &&TARGET_OP_CBRT, [OP_HYPOT] = &&TARGET_OP_HYPOT,
+        [OP_MAX] = &&TARGET_OP_MAX, [OP_MIN] = &&TARGET_OP_MIN, [OP_RAND] = &&TARGET_OP_RAND,
+        [OP_READ] = &&TARGET_OP_READ, [OP_MEMSTATS] = &&TARGET_OP_MEMSTATS, [OP_EQUAL] = &&TARGET_OP_EQUAL, [OP_LESS] = &&TARGET_OP_LESS,
+        [OP_GREATER] = &&TARGET_OP_GREATER, [OP_COMPARE_TRUE] = &&TARGET_OP_COMPARE_TRUE,
+        [OP_PRINT] = &&TARGET_OP_PRINT, [OP_VECTOR] = &&TARGET_OP_VECTOR, [OP_RANGE] = &&TARGET_OP_RANGE,
+        [OP_SUM] = &&TARGET_OP_SUM, [OP_DOT] = &&TARGET_OP_DOT, [OP_LEN] = &&TARGET_OP_LEN,
+        [OP_ADD_INT] = &&TARGET_OP_ADD_INT, [OP_SUB_INT] = &&TARGET_OP_SUB_INT,
+        [OP_MULT_INT] = &&TARGET_OP_MULT_INT, [OP_DIV_INT] = &&TARGET_OP_DIV_INT,
+        [OP_ADD_DOUBLE] = &&TARGET_OP_ADD_DOUBLE, [OP_SUB_DOUBLE] = &&TARGET_OP_SUB_DOUBLE,
+        [OP_MULT_DOUBLE] = &&TARGET_OP_MULT_DOUBLE, [OP_DIV_DOUBLE] = &&TARGET_OP_DIV_DOUBLE,
+        [OP_LOOP_START] = &&TARGET_OP_LOOP_START, [OP_LOOP_NEXT] = &&TARGET_OP_LOOP_NEXT,
+        [OP_LOOP_ADD] = &&TARGET_OP_LOOP_ADD, [OP_LOOP_MULT] = &&TARGET_OP_LOOP_MULT,
+        [OP_LOOP_COUNT] = &&TARGET_OP_LOOP_COUNT, [OP_LOOP_ARGS] = &&TARGET_OP_LOOP_ARGS,
+        [OP_LOOP_STORE] = &&TARGET_OP_LOOP_STORE
+    };
+#define TARGET(op) TARGET_##op:
+#define DISPATCH() goto *dispatch[*ip++]
+    DISPATCH();
+#else
+#define TARGET(op) case op:
+#define DISPATCH() continue
+    for (;;) switch (*ip++) {
+#endif
+
+    TARGET(OP_CONST)
+    {
+        *sp++ = consts[ip[0]];
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_WARN)
+    {
+        warning(interp, "%s", bc->strings[ip[0]]);
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_POP)
+    {
+        sp -= ip[0];
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_JUMP)
+    {
+        ip = code + ip[0];
+        DISPATCH();
+    }
+    TARGET(OP_JUMP_FALSE)
+    {
+        sp--;
+        if (!numIsTrue(*sp))
+        {
+            ip = code + ip[0];
+        }
+        else
+        {
+            ip++;
+        }
+        DISPATCH();
+    }
+    TARGET(OP_LOAD_LOCAL)
+    {
+        *sp++ = bp[ip[0]];
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_LOAD)
+    {
+        size_t frame = vmEnclosingFrame(vm, env, ip[0]);
+        *sp++ = vm->stack[vm->frames[frame].base + ip[1]];
+        ip += 2;
+        DISPATCH();
+    }
+    TARGET(OP_LOAD_LET)
+    {
+        size_t frame = vmEnclosingFrame(vm, env, ip[0]);
+        RET_VAL *slot = vm->stack + vm->frames[frame].base + ip[1];
+
+        if (slot->type != NO_TYPE)
+        {
+            *sp++ = *slot;
+            ip += 3;
+            DISPATCH();
+        }
+
+        BC_FUNCTION *thunk = &bc->thunks[ip[2]];
+
+        if (slot->integer != 0)
+        {
+            warning(interp, "Recursive definition of symbol: %s", thunk->name);
+            *sp++ = NAN_RET_VAL;
+            ip += 3;
+            DISPATCH();
+        }
+
+        *slot = FORCING_SLOT;
+        VM_RESERVE(thunk->maxStack);
+        vmPushFrame(vm, &nframes, (VM_FRAME){ip + 3, env, 0, 0, NULL});
+        env = frame;
+        bp = vm->stack + vm->frames[env].base;
+        ip = code + thunk->entry;
+        DISPATCH();
+    }
+    TARGET(OP_THUNK_RETURN)
+    {
+        RET_VAL value = *--sp;
+        VM_FRAME *frame = &vm->frames[--nframes];
+        bp[ip[0]] = value;
+        env = frame->caller;
+        ip = frame->ret;
+        bp = vm->stack + vm->frames[env].base;
+        *sp++ = value;
+        DISPATCH();
+    }
+    TARGET(OP_CAST)
+    {
+        sp[-1] = castRetVal(interp, sp[-1], ip[0]);
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_CALL)
+    {
+        BC_FUNCTION *function = &bc->functions[ip[1]];
+        size_t argc = ip[2];
+        RET_VAL result;
+
+        if (interp->jit.enabled && jitCall(interp, function->lamda, sp - argc, argc, &result))
+        {
+            sp -= argc;
+            *sp++ = result;
+            ip += 3;
+            DISPATCH();
+        }
+
+        size_t link = vmEnclosingFrame(vm, env, ip[0]);
+
+        VM_RESERVE(function->nslots - argc + function->maxStack);
+
+        size_t base = (sp - vm->stack) - argc;
+        for (size_t i = argc; i < function->nslots; i++)
+        {
+            *sp++ = UNFORCED_SLOT;
+        }
+
+        vmPushFrame(vm, &nframes, (VM_FRAME){ip + 3, env, base, link, NULL});
+        env = nframes - 1;
+        bp = vm->stack + base;
+        ip = code + function->entry;
+        DISPATCH();
+    }
+    TARGET(OP_TAIL_CALL)
+    {
+        // only emitted in lambda bodies, so env is the topmost frame
+        BC_FUNCTION *function = &bc->functions[ip[1]];
+        size_t link = vmEnclosingFrame(vm, env, ip[0]);
+        size_t argc = ip[2];
+
+        sp -= argc;
+        memmove(bp, sp, argc * sizeof(RET_VAL));
+        sp = bp + argc;
+
+        VM_RESERVE(function->nslots - argc + function->maxStack);
+
+        for (size_t i = argc; i < function->nslots; i++)
+        {
+            *sp++ = UNFORCED_SLOT;
+        }
+
+        // the args the result would be cached under are gone
+        vm->frames[env].link = link;
+        vm->frames[env].memo = NULL;
+        ip = code + function->entry;
+        DISPATCH();
+    }
+    TARGET(OP_MEMO_CALL)
+    {
+        BC_FUNCTION *function = &bc->functions[ip[1]];
+        size_t argc = ip[2];
+        RET_VAL result;
+
+        if (memoLookup(interp, function->memo, sp - argc, &result))
+        {
+            sp -= argc;
+            *sp++ = result;
+            ip += 3;
+            DISPATCH();
+        }
+
+        size_t link = vmEnclosingFrame(vm, env, ip[0]);
+
+        VM_RESERVE(function->nslots - argc + function->maxStack);
+
+        size_t base = (sp - vm->stack) - argc;
+        for (size_t i = argc; i < function->nslots; i++)
+        {
+            *sp++ = UNFORCED_SLOT;
+        }
+
+        vmPushFrame(vm, &nframes, (VM_FRAME){ip + 3, env, base, link, function->memo, interp->warningCount});
+        env = nframes - 1;
+        bp = vm->stack + base;
+        ip = code + function->entry;
+        DISPATCH();
+    }
+    TARGET(OP_RETURN)
+    {
+        RET_VAL value = *--sp;
+        VM_FRAME *frame = &vm->frames[--nframes];
+        sp = vm->stack + frame->base;
+        if (frame->memo != NULL && interp->warningCount == frame->warnings)
+        {
+            memoStore(interp, frame->memo, sp, value);
+        }
+        env = frame->caller;
+        ip = frame->ret;
+        bp = vm->stack + vm->frames[env].base;
+        *sp++ = value;
+        DISPATCH();
+    }
+    TARGET(OP_HALT)
+    {
+        return *--sp;
+    }
+    TARGET(OP_NEG)
+    {
+        sp[-1] = numNeg(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_ABS)
+    {
+        sp[-1] = numAbs(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_ADD)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = args[0];
+
+        // the overall type is double if there is any double operand
+        for (int32_t i = 1; i < n; i++)
+        {
+            result = numAdd(interp, result, args[i]);
+        }
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_SUB)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = numSub(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_MULT)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = args[0];
+
+        for (int32_t i = 1; i < n; i++)
+        {
+            result = numMult(interp, result, args[i]);
+        }
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_DIV)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = numDiv(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_REM)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = numRem(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_EXP)
+    {
+        sp[-1] = numExp(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_EXP2)
+    {
+        sp[-1] = numExp2(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_POW)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = numPow(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_LOG)
+    {
+        sp[-1] = numLog(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_SQRT)
+    {
+        sp[-1] = numSqrt(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_CBRT)
+    {
+        sp[-1] = numCbrt(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_HYPOT)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = numHypot(interp, args, n);
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_MAX)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = n == 1 ? vecReduce(interp, VEC_MAX, args[0]) : args[0];
+
+        for (int32_t i = 1; i < n; i++)
+        {
+            result = numMax(interp, result, args[i]);
+        }
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_MIN)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = n == 1 ? vecReduce(interp, VEC_MIN, args[0]) : args[0];
+
+        for (int32_t i = 1; i < n; i++)
+        {
+            result = numMin(interp, result, args[i]);
+        }
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_RAND)
+    {
+        *sp++ = DOUBLE_RET_VAL((double) rand() / (double)RAND_MAX);
+        DISPATCH();
+    }
+    TARGET(OP_READ)
+    {
+        *sp++ = readRetVal(interp);
+        DISPATCH();
+    }
+    TARGET(OP_MEMSTATS)
+    {
+        *sp++ = memStatsRetVal(interp);
+        DISPATCH();
+    }
+    TARGET(OP_EQUAL)
+    {
+        if (!numEqual(sp[-1], sp[-2]))
+        {
+            sp -= 2;
+            ip = code + ip[0];
+            DISPATCH();
+        }
+        sp--;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_LESS)
+    {
+        if (numLessEqual(sp[-1], sp[-2]))
+        {
+            sp -= 2;
+            ip = code + ip[0];
+            DISPATCH();
+        }
+        sp--;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_GREATER)
+    {
+        if (numLessEqual(sp[-2], sp[-1]))
+        {
+            sp -= 2;
+            ip = code + ip[0];
+            DISPATCH();
+        }
+        sp--;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_COMPARE_TRUE)
+    {
+        sp[-1] = INT_RET_VAL(1);
+        DISPATCH();
+    }
+    TARGET(OP_PRINT)
+    {
+        printRetVal(interp, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_VECTOR)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = vecConcat(interp, args, n);
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_RANGE)
+    {
+        int32_t n = ip[0];
+        RET_VAL *args = sp - n;
+        RET_VAL result = vecRange(interp, args, n);
+
+        sp = args;
+        *sp++ = result;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_SUM)
+    {
+        sp[-1] = vecReduce(interp, VEC_ADD, sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_DOT)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = numDot(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_LEN)
+    {
+        sp[-1] = numLen(sp[-1]);
+        DISPATCH();
+    }
+    TARGET(OP_ADD_INT)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = intAdd(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_SUB_INT)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = intSub(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_MULT_INT)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = intMult(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_DIV_INT)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = intDiv(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_ADD_DOUBLE)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = doubleAdd(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_SUB_DOUBLE)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = doubleSub(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_MULT_DOUBLE)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = doubleMult(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_DIV_DOUBLE)
+    {
+        RET_VAL right = *--sp;
+        sp[-1] = doubleDiv(interp, sp[-1], right);
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_START)
+    {
+        if (sp[-2].type != INT_TYPE || sp[-1].type != INT_TYPE)
+        {
+            warning(interp, "%s", bc->strings[ip[1]]);
+            sp -= 3;
+            *sp++ = NAN_RET_VAL;
+            ip = code + ip[0];
+            DISPATCH();
+        }
+        ip += 2;
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_NEXT)
+    {
+        if (sp[-2].integer >= sp[-1].integer)
+        {
+            sp -= 2;
+            ip = code + ip[0];
+            DISPATCH();
+        }
+        *sp = sp[-2];
+        sp[-2].integer++;
+        sp++;
+        ip++;
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_ADD)
+    {
+        RET_VAL result = *--sp;
+        sp[-3] = numAdd(interp, sp[-3], result);
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_MULT)
+    {
+        RET_VAL result = *--sp;
+        sp[-3] = numMult(interp, sp[-3], result);
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_COUNT)
+    {
+        RET_VAL result = *--sp;
+        sp[-3].integer += numIsTrue(result);
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_ARGS)
+    {
+        *sp = sp[-1];
+        sp[-1] = sp[-4];
+        sp++;
+        DISPATCH();
+    }
+    TARGET(OP_LOOP_STORE)
+    {
+        RET_VAL acc = *--sp;
+        sp[-3] = acc;
+        DISPATCH();
+    }
+
+#if !VM_THREADED
+    default:
+        yyerror("Invalid opcode in runBytecode!");
+    }
+#endif
+
+#undef TARGET
+#undef DISPATCH
+#undef VM_RESERVE
+
+    return NAN_RET_VAL;
+}
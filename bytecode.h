@@ -0,0 +1,136 @@
+#ifndef __bytecode_h_
+#define __bytecode_h_
+
+#include "cilisp.h"
+#include "resolve.h"
+#include <stdint.h>
+
+// Bytecode for the stack VM.
+// Each instruction is an opcode word followed by its int32 operands,
+// see opOperandCounts in bytecode.c when adding new opcodes.
+typedef enum {
+    OP_CONST,           // k            push consts[k]
+    OP_WARN,            // k            warning with strings[k]
+    OP_POP,             // n            drop n values
+    OP_JUMP,            // target
+    OP_JUMP_FALSE,      // target       pop, jump if the value is 0
+    OP_LOAD_LOCAL,      // slot         push a slot of the current frame
+    OP_LOAD,            // depth slot   push a slot of an enclosing frame
+    OP_LOAD_LET,        // depth slot thunk   push a let slot, forcing its thunk on first use
+    OP_CAST,            // type         apply a typed symbol cast to the top value
+    OP_CALL,            // depth func argc
+    OP_TAIL_CALL,       // depth func argc      replace the current lambda frame with the callee's
+    OP_MEMO_CALL,       // depth func argc      call a pure lambda through its result cache
+    OP_RETURN,
+    OP_THUNK_RETURN,    // slot
+    OP_HALT,
+    OP_NEG,
+    OP_ABS,
+    OP_ADD,             // n
+    OP_SUB,
+    OP_MULT,            // n
+    OP_DIV,
+    OP_REM,
+    OP_EXP,
+    OP_EXP2,
+    OP_POW,
+    OP_LOG,
+    OP_SQRT,
+    OP_CBRT,
+    OP_HYPOT,           // n
+    OP_MAX,             // n
+    OP_MIN,             // n
+    OP_RAND,
+    OP_READ,
+    OP_MEMSTATS,
+    OP_EQUAL,           // fail         compare the top value against the first operand
+    OP_LESS,            // fail
+    OP_GREATER,         // fail
+    OP_COMPARE_TRUE,
+    OP_PRINT,
+    OP_VECTOR,          // n
+    OP_RANGE,           // n
+    OP_SUM,
+    OP_DOT,
+    OP_LEN,
+    // two operands inferTypes knows are both ints or both doubles
+    OP_ADD_INT,
+    OP_SUB_INT,
+    OP_MULT_INT,
+    OP_DIV_INT,
+    OP_ADD_DOUBLE,
+    OP_SUB_DOUBLE,
+    OP_MULT_DOUBLE,
+    OP_DIV_DOUBLE,
+    // range builtin loops keep [acc i hi] on the stack, see compileRangeLoop
+    OP_LOOP_START,      // fail k       check the bounds are ints, else warn with strings[k] and jump
+    OP_LOOP_NEXT,       // end          push i and step it, or drop i and hi and jump once i reaches hi
+    OP_LOOP_ADD,        //              pop a lamda result into acc
+    OP_LOOP_MULT,
+    OP_LOOP_COUNT,
+    OP_LOOP_ARGS,       //              push acc under the lamda result as args of the fold lamda
+    OP_LOOP_STORE,      //              pop the new acc
+    OP_COUNT
+} OPCODE;
+
+// A lambda body (or the top level expression) or a let value thunk
+typedef struct {
+    char *name;
+    size_t entry;
+    size_t maxStack;
+    size_t nargs;
+    size_t nslots;
+    // result cache of a pure lambda under --memoize
+    struct memo_table *memo;
+    // the lambda itself, which --jit may run natively, NULL for thunks and the top level
+    SYMBOL_TABLE_NODE *lamda;
+} BC_FUNCTION;
+
+typedef struct {
+    int32_t *code;
+    size_t codeLen;
+    size_t codeCap;
+    RET_VAL *consts;
+    size_t constLen;
+    size_t constCap;
+    char **strings;
+    size_t stringLen;
+    size_t stringCap;
+    // functions[0] is the top level expression
+    BC_FUNCTION *functions;
+    size_t functionLen;
+    size_t functionCap;
+    BC_FUNCTION *thunks;
+    size_t thunkLen;
+    size_t thunkCap;
+} BYTECODE;
+
+// One call or thunk in progress
+typedef struct {
+    const int32_t *ret;
+    // frame that was current before the call
+    size_t caller;
+    // first slot of the frame on the value stack
+    size_t base;
+    // frame the lambda was defined in
+    size_t link;
+    // cache the result goes in on return, the args at base are its key
+    struct memo_table *memo;
+    // warning count at the call, a result that warned isn't cached
+    size_t warnings;
+} VM_FRAME;
+
+// Value and frame stacks of one interpreter's VM, kept between runs
+typedef struct {
+    RET_VAL *stack;
+    size_t stackCap;
+    VM_FRAME *frames;
+    size_t frameCap;
+} VM_STACK;
+
+BYTECODE *compileBytecode(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info);
+RET_VAL runBytecode(INTERP *interp, BYTECODE *bc);
+void printBytecode(BYTECODE *bc);
+void freeBytecode(BYTECODE *bc);
+
+#endif
@@ -0,0 +1,64 @@
+#!/bin/sh
+# Differential test of --jit against the VM over the programs in check/jit/.
+# Each program has to print the same with and without --jit, and --jit=check
+# has to report no mismatches. On x86-64 every program also has to compile
+# something, and the bail_*.cilisp ones have to bail out at least once, so a
+# change that quietly leaves everything to the interpreter fails too.
+#
+# usage: check/jit.sh [binary]
+#   exits 1 when any program fails, after running all of them
+
+BIN=${1:-./cilisp-check}
+DIR=$(dirname "$0")
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+NATIVE=0
+[ "$(uname -m)" = x86_64 ] && NATIVE=1
+
+failed=0
+
+fail() {
+    echo "FAIL $name: $1"
+    failed=1
+    bad=1
+}
+
+for program in "$DIR"/jit/*.cilisp
+do
+    name=$(basename "$program" .cilisp)
+    bad=0
+
+    "$BIN" "$program" < /dev/null > "$OUT/vm" 2> /dev/null
+    "$BIN" --jit "$program" < /dev/null > "$OUT/jit" 2> "$OUT/jit.err"
+    "$BIN" --jit=check "$program" < /dev/null > "$OUT/check" 2> "$OUT/check.err"
+
+    if ! cmp -s "$OUT/vm" "$OUT/jit"
+    then
+        fail "output differs with --jit"
+        diff "$OUT/vm" "$OUT/jit" | head -20
+    fi
+
+    if grep -q "jit check:" "$OUT/check"
+    then
+        fail "--jit=check warned"
+        grep "jit check:" "$OUT/check" | head -20
+    fi
+    grep -q "^jit check: [0-9]* expressions compared, 0 mismatches$" "$OUT/check.err" ||
+        fail "--jit=check reported mismatches: $(grep '^jit check:' "$OUT/check.err")"
+
+    if [ $NATIVE = 1 ]
+    then
+        stats=$(grep "^jit: " "$OUT/jit.err")
+        compiled=$(echo "$stats" | sed -n 's/^jit: \([0-9]*\) compiled.*/\1/p')
+        bails=$(echo "$stats" | sed -n 's/.*, \([0-9]*\) bail outs$/\1/p')
+        [ "${compiled:-0}" -gt 0 ] || fail "nothing compiled ($stats)"
+        case $name in
+        bail_*) [ "${bails:-0}" -gt 0 ] || fail "no bail outs ($stats)" ;;
+        esac
+    fi
+
+    [ $bad = 0 ] && echo "ok   $name"
+done
+
+exit $failed
@@ -0,0 +1,50 @@
+#!/bin/sh
+# Checks --jobs against --batch over the programs in check/jobs/: both have
+# to print the same, and nothing may show up on stderr from a sanitizer.
+# make check-jobs builds the binary with -fsanitize=undefined for that.
+#
+# usage: check/jobs.sh [binary] [thread count]
+#   exits 1 when any program fails, after running all of them
+#
+# A program NAME.cilisp reads its (read) input from NAME.input when that exists.
+
+BIN=${1:-./cilisp-check}
+THREADS=${2:-4}
+DIR=$(dirname "$0")
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $name: $1"
+    failed=1
+    bad=1
+}
+
+for program in "$DIR"/jobs/*.cilisp
+do
+    name=$(basename "$program" .cilisp)
+    input="$DIR/jobs/$name.input"
+    [ -f "$input" ] || input=/dev/null
+    bad=0
+
+    "$BIN" --batch "$program" "$input" < /dev/null > "$OUT/batch" 2> /dev/null
+    "$BIN" --jobs "$THREADS" "$program" "$input" < /dev/null > "$OUT/jobs" 2> "$OUT/jobs.err"
+
+    if ! cmp -s "$OUT/batch" "$OUT/jobs"
+    then
+        fail "output differs with --jobs $THREADS"
+        diff "$OUT/batch" "$OUT/jobs" | head -20
+    fi
+
+    if grep -q "runtime error" "$OUT/jobs.err"
+    then
+        fail "sanitizer report"
+        grep "runtime error" "$OUT/jobs.err" | head -20
+    fi
+
+    [ $bad = 0 ] && echo "ok   $name"
+done
+
+exit $failed
@@ -0,0 +1,45 @@
+#!/bin/sh
+# Checks --memoize against plain runs over the programs in check/memoize/,
+# with the VM and the tree walker: both have to print the same, warnings
+# included, and every program has to hit the cache at least once.
+#
+# usage: check/memoize.sh [binary]
+#   exits 1 when any program fails, after running all of them
+
+BIN=${1:-./cilisp-check}
+DIR=$(dirname "$0")
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $name (${engine:-vm}): $1"
+    failed=1
+    bad=1
+}
+
+for program in "$DIR"/memoize/*.cilisp
+do
+    name=$(basename "$program" .cilisp)
+    bad=0
+
+    for engine in "" --tree-walk
+    do
+        "$BIN" --batch $engine "$program" < /dev/null > "$OUT/plain" 2> /dev/null
+        "$BIN" --batch $engine --memoize "$program" < /dev/null > "$OUT/memo" 2> "$OUT/memo.err"
+
+        if ! cmp -s "$OUT/plain" "$OUT/memo"
+        then
+            fail "output differs with --memoize"
+            diff "$OUT/plain" "$OUT/memo" | head -20
+        fi
+
+        hits=$(sed -n 's/^memo: \([0-9]*\) hits.*/\1/p' "$OUT/memo.err")
+        [ "${hits:-0}" -gt 0 ] || fail "no cache hits ($(grep '^memo:' "$OUT/memo.err"))"
+    done
+
+    [ $bad = 0 ] && echo "ok   $name"
+done
+
+exit $failed
@@ -1,13 +1,34 @@
 #include "cilisp.h"
+#include "interp.h"
+#include "bytecode.h"
+#include "arena.h"
+#include "resolve.h"
+#include "memo.h"
+#include "fold.h"
+#include "types.h"
+#include "flat.h"
+#include "closure.h"
+#include "fork.h"
+#include "profile.h"
+#include "vector.h"
+#include "number.h"
+#include "keyword_table.h"
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
 
 #define RED             "\033[31m"
 #define RESET_COLOR     "\033[0m"
 #define MAX_READ_CHARS  255
 
-// Build shenanigans, define the extern variable here
-FILE* read_target;
-FILE* flex_bison_log_file;
+static uint64_t nowNs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
 
 // yyerror:
 // Something went so wrong that the whole program should crash.
@@ -40,116 +61,109 @@ void yyerror(char *format, ...)
 //      invalid arguments, let them know and return NAN
 //      many more uses to be added as we progress...
 // This is basically printf, but red, and with "\nWARNING: " prepended and "\n" appended.
-void warning(char *format, ...)
+void warning(INTERP *interp, char *format, ...)
 {
+    interp->warningCount++;
+    if (interp->muteWarnings)
+    {
+        return;
+    }
+
     char buffer[256];
     va_list args;
     va_start (args, format);
     vsnprintf (buffer, 255, format, args);
 
-    printf(RED "WARNING: %s\n" RESET_COLOR, buffer);
-    fflush(stdout);
+    outputFormat(&interp->out, RED "WARNING: %s\n" RESET_COLOR, buffer);
 
     va_end (args);
 }
 
+#define LIST_NAME(value, name) name,
+
+// Array of string values for function names, funcNames[NEG_FUNC] is "neg"
+static const char *funcNames[] = {
+    FUNC_LIST(LIST_NAME)
+};
+
+static const char *typeNames[] = {
+    TYPE_LIST(LIST_NAME)
+};
+
+// One probe into the perfect hash generated by mkkeywords, then a single compare
 FUNC_TYPE resolveFunc(char *funcName)
 {
-    // Array of string values for function names.
-    // Must be in sync with members of the FUNC_TYPE enum in order for resolveFunc to work.
-    // For example, funcNames[NEG_FUNC] should be "neg"
-    char *funcNames[] = {
-            "neg",
-            "abs",
-            "add",
-            "sub",
-            "mult",
-            "div",
-            "remainder",
-            "exp",
-            "exp2",
-            "pow",
-            "log",
-            "sqrt",
-            "cbrt",
-            "hypot",
-            "max",
-            "min",
-            "rand",
-            "read",
-            "equal",
-            "less",
-            "greater",
-            "print",
-            ""
-    };
-    int i = 0;
-    while (funcNames[i][0] != '\0')
+    int func = funcHashTable[hashString(funcName, strlen(funcName), FUNC_HASH_SEED) & (FUNC_HASH_SIZE - 1)];
+
+    if (func >= 0 && strcmp(funcNames[func], funcName) == 0)
     {
-        if (strcmp(funcNames[i], funcName) == 0)
-        {
-            return i;
-        }
-        i++;
+        return func;
     }
     return CUSTOM_FUNC;
 }
 
 
+const char *nameOfFunc(FUNC_TYPE func)
+{
+    return func < CUSTOM_FUNC ? funcNames[func] : "lamda";
+}
+
 NUM_TYPE resolveType(char *typename) {
-    char *typenames[] = {
-            "int",
-            "double",
-            ""
-    };
-    int i = 0;
-    while (typenames[i][0] != '\0')
+    int type = typeHashTable[hashString(typename, strlen(typename), TYPE_HASH_SEED) & (TYPE_HASH_SIZE - 1)];
+
+    if (type >= 0 && strcmp(typeNames[type], typename) == 0)
     {
-        if (strcmp(typenames[i], typename) == 0)
-        {
-            return i;
-        }
-        i++;
+        return type;
     }
     return NO_TYPE;
 }
 
-char* cloneString(char *symbol) {
-    char *copy = (char *) malloc(strlen(symbol) + 1);
-    if (copy != NULL) {
-      strcpy(copy, symbol);
-    }
+char* cloneString(INTERP *interp, char *symbol) {
+    char *copy = (char *) allocFromArena(&interp->parseArena, strlen(symbol) + 1);
+    strcpy(copy, symbol);
     return copy;
 }
 
-AST_NODE *createNumberNode(double value, NUM_TYPE type)
+// Releases the AST, symbols, strings and stacks of the last top level expression
+void resetParseArena(INTERP *interp)
+{
+    resetArena(&interp->parseArena);
+
+    // vectors made by forked operands live in the workers' arenas
+    if (interp->fork != NULL && interp->forkIndex == 0)
+    {
+        for (int i = 1; i < interp->fork->threads; i++)
+        {
+            resetArena(&interp->fork->interps[i]->parseArena);
+        }
+    }
+
+    if (interp->timing.enabled)
+    {
+        interp->timing.mark = nowNs();
+    }
+}
+
+AST_NODE *createNumberNode(INTERP *interp, RET_VAL value)
 {
     AST_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(AST_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
-    node->data.number = (AST_NUMBER){type, value};
+    node->data.number = value;
     node->type = NUM_NODE_TYPE;
 
     return node;
 }
 
-SYMBOL_TABLE_NODE *createSymbolArgNode(char* value) {
+SYMBOL_TABLE_NODE *createSymbolArgNode(INTERP *interp, char* value) {
     SYMBOL_TABLE_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(SYMBOL_TABLE_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     node->id = value;
     node->symbolType = ARG_TYPE;
@@ -158,16 +172,12 @@ SYMBOL_TABLE_NODE *createSymbolArgNode(char* value) {
 
 }
 
-SYMBOL_TABLE_NODE *createTypecastSymbolVarNode(char* value, AST_NODE *s_expr, NUM_TYPE type) {
+SYMBOL_TABLE_NODE *createTypecastSymbolVarNode(INTERP *interp, char* value, AST_NODE *s_expr, NUM_TYPE type) {
     SYMBOL_TABLE_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(SYMBOL_TABLE_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     node->id = value;
     node->value = s_expr;
@@ -176,21 +186,17 @@ SYMBOL_TABLE_NODE *createTypecastSymbolVarNode(char* value, AST_NODE *s_expr, NU
     return node;
 }
 
-SYMBOL_TABLE_NODE *createSymbolVarNode(char* value, AST_NODE *s_expr)
+SYMBOL_TABLE_NODE *createSymbolVarNode(INTERP *interp, char* value, AST_NODE *s_expr)
 {
-    return createTypecastSymbolVarNode(value, s_expr, NO_TYPE);
+    return createTypecastSymbolVarNode(interp, value, s_expr, NO_TYPE);
 }
 
-SYMBOL_TABLE_NODE *createTypecastSymbolLamdaNode(char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr, NUM_TYPE type) {
+SYMBOL_TABLE_NODE *createTypecastSymbolLamdaNode(INTERP *interp, char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr, NUM_TYPE type) {
     SYMBOL_TABLE_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(SYMBOL_TABLE_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     node->id = value;
     node->value = s_expr;
@@ -201,8 +207,8 @@ SYMBOL_TABLE_NODE *createTypecastSymbolLamdaNode(char* value, SYMBOL_TABLE_NODE
     return node;
 }
 
-SYMBOL_TABLE_NODE *createSymbolLamdaNode(char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr) {
-    return createTypecastSymbolLamdaNode(value, arg_list, s_expr, NO_TYPE);
+SYMBOL_TABLE_NODE *createSymbolLamdaNode(INTERP *interp, char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr) {
+    return createTypecastSymbolLamdaNode(interp, value, arg_list, s_expr, NO_TYPE);
 }
 
 SYMBOL_TABLE_NODE *addSymbolToList(SYMBOL_TABLE_NODE *newSymbol, SYMBOL_TABLE_NODE *symbolList) {
@@ -217,23 +223,19 @@ SYMBOL_TABLE_NODE *addSymbolToList(SYMBOL_TABLE_NODE *newSymbol, SYMBOL_TABLE_NO
     return newSymbol;
 }
 
-AST_NODE *createSymbolReferenceNode(char* id) {
+AST_NODE *createSymbolReferenceNode(INTERP *interp, char* id) {
     AST_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(AST_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     node->type = SYM_NODE_TYPE;
     node->data.symbol.id = id;
 
     return node;
 }
-AST_NODE *createCondNode(AST_NODE *conditional, AST_NODE *true_node, AST_NODE *false_node) {
+AST_NODE *createCondNode(INTERP *interp, AST_NODE *conditional, AST_NODE *true_node, AST_NODE *false_node) {
     if (conditional == NULL || true_node == NULL || false_node == NULL) {
         yyerror("NULL node passed into createCondNode!");
         exit(1);
@@ -243,15 +245,7 @@ AST_NODE *createCondNode(AST_NODE *conditional, AST_NODE *true_node, AST_NODE *f
     size_t nodeSize;
 
     nodeSize = sizeof(AST_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
-
-    conditional->parent = node;
-    true_node->parent = node;
-    false_node->parent = node;
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     node->data.cond.contiditonal = conditional;
     node->data.cond.true_node = true_node;
@@ -261,71 +255,43 @@ AST_NODE *createCondNode(AST_NODE *conditional, AST_NODE *true_node, AST_NODE *f
     return node;
 }
 
-AST_NODE *createFunctionNode(FUNC_TYPE func, AST_NODE *opList, char *identifer)
+AST_NODE *createFunctionNode(INTERP *interp, FUNC_TYPE func, AST_NODE *opList, char *identifer)
 {
     AST_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(AST_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     node->data.function.func = func;
     node->data.function.opList = opList;
     node->data.function.id = identifer;
     node->type = FUNC_NODE_TYPE;
 
-    // Set parent pointers for all nodes in list 
-    // so nested functions can access scope symbols
-    AST_NODE *current = opList;
-    while (current != NULL) {
-        current->parent = node;
-        current = current->next;
-    }
-
     return node;
 }
 
-AST_NODE *createCoreFunctionNode(FUNC_TYPE func, AST_NODE *opList) {
-    return createFunctionNode(func, opList, NULL);
+AST_NODE *createCoreFunctionNode(INTERP *interp, FUNC_TYPE func, AST_NODE *opList) {
+    return createFunctionNode(interp, func, opList, NULL);
 }
 
-AST_NODE *createLamdaFunctionNode(char* identifer, AST_NODE *opList) {
-    return createFunctionNode(CUSTOM_FUNC, opList, identifer);
+AST_NODE *createLamdaFunctionNode(INTERP *interp, char* identifer, AST_NODE *opList) {
+    return createFunctionNode(interp, CUSTOM_FUNC, opList, identifer);
 }
 
-AST_NODE *createScopeNode(SYMBOL_TABLE_NODE *symbol, AST_NODE *child) {
+AST_NODE *createScopeNode(INTERP *interp, SYMBOL_TABLE_NODE *symbol, AST_NODE *child) {
     AST_NODE *node;
     size_t nodeSize;
 
     nodeSize = sizeof(AST_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
-    {
-        yyerror("Memory allocation failed!");
-        exit(1);
-    }
+    node = allocFromArena(&interp->parseArena, nodeSize);
 
     // Set the node type, the scope node has a single child
     node->type = SCOPE_NODE_TYPE;
     node->data.scope.child = child;
 
-    // Set the child's parent to this new scope node
-    child->parent = node;
-
-    // Assign the child scopes symbol table to the symbol (let section in the grammar)
-    child->symbolTable = symbol;
-
-    // All symbol siblings in the symbol table must have their parent set to the new child scope 
-    SYMBOL_TABLE_NODE *current = symbol;
-    while (current != NULL) {
-        if (current->value != NULL) {
-            current->value->parent = child;
-        }
-        current = current->next;
-    }
+    // The let section (symbol table in the grammar) is kept on the scope node only
+    node->data.scope.symbols = symbol;
 
     return node;
 }
@@ -343,498 +309,471 @@ AST_NODE *addExpressionToList(AST_NODE *newExpr, AST_NODE *exprList)
     return newExpr;
 }
 
-RET_VAL evalNegFuncNode(AST_NODE *node) {
-    if (!node)
+// The forked operands of one variadic call, tasks are indexed by operand
+typedef struct {
+    size_t count;
+    uint64_t forked;
+    FORK_SCOPE *scope;
+    FORK_TASK tasks[];
+} FORK_JOIN;
+
+// Copies the frames reachable from the current one, so forked operands can
+// read (and force lets in) them while this thread carries on
+static FORK_SCOPE *copyEvalScope(INTERP *interp)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    size_t frameLen = 1;
+    size_t valueLen = stack->frames[stack->current].size;
+
+    // the outermost frame links to itself, the top level one or a forked task's copy of it
+    for (size_t frame = stack->current; stack->frames[frame].link != frame; frame = stack->frames[frame].link)
     {
-        yyerror("NULL ast node passed into evalNegFuncNode!");
-        return NAN_RET_VAL; 
+        frameLen++;
+        valueLen += stack->frames[stack->frames[frame].link].size;
     }
 
-    if (node->data.function.opList == NULL)
+    FORK_SCOPE *scope = memAlloc(MEM_STACKS, sizeof(FORK_SCOPE) + frameLen * sizeof(EVAL_FRAME) + valueLen * sizeof(RET_VAL));
+    if (scope == NULL)
     {
-        warning("No operands passed into neg");
-        return NAN_RET_VAL;
+        yyerror("Memory allocation failed!");
+        exit(1);
     }
 
-    RET_VAL r = eval(node->data.function.opList);
-    r.value *= -1.0;
-    return r;
-}
+    scope->frames = (EVAL_FRAME *) (scope + 1);
+    scope->values = (RET_VAL *) (scope->frames + frameLen);
+    scope->frameLen = frameLen;
+    scope->valueLen = valueLen;
 
-RET_VAL evalAbsFuncNode(AST_NODE *node) {
-    if (!node)
+    // filled in from the innermost frame out, each linking to the one before it
+    size_t frame = stack->current;
+    for (size_t i = frameLen; i-- > 0; frame = stack->frames[frame].link)
     {
-        yyerror("NULL ast node passed into evalAbsFuncNode!");
-        return NAN_RET_VAL; 
-    }
+        EVAL_FRAME *from = &stack->frames[frame];
 
-    if (node->data.function.opList == NULL)
-    {
-        warning("No operands passed into abs");
-        return NAN_RET_VAL;
+        valueLen -= from->size;
+        scope->frames[i] = (EVAL_FRAME){valueLen, i > 0 ? i - 1 : 0, from->size};
+        // the value stack is still NULL while no frame has slots
+        if (from->size > 0)
+        {
+            memcpy(scope->values + valueLen, stack->values + from->base, from->size * sizeof(RET_VAL));
+        }
     }
 
-    RET_VAL r = eval(node->data.function.opList);
-    r.value = fabs(r.value);
-    return r;
+    return scope;
 }
 
-RET_VAL evalAddFuncNode(AST_NODE *node) {
-    if (!node)
+// Starts the forkable operands of a variadic call on other threads while some
+// are idle and waits for them, running the first (and any nobody took) here.
+// NULL when nothing was forked, or when a forked operand warned: the call is
+// then evaluated one operand at a time so the warnings come out in order.
+static FORK_JOIN *forkOperands(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    uint64_t forkable = tree->forkable[tree->nodes[node].value];
+
+    if (interp->fork == NULL || forkable == 0 || !forkWorkersIdle(interp))
     {
-        yyerror("NULL ast node passed into evalAddFuncNode!");
-        return NAN_RET_VAL; 
+        return NULL;
     }
 
-    AST_NODE *current = node->data.function.opList;
-
-    if (current == NULL)
+    size_t count = 64 - __builtin_clzll(forkable);
+    FORK_JOIN *join = memCalloc(MEM_STACKS, 1, sizeof(FORK_JOIN) + count * sizeof(FORK_TASK));
+    if (join == NULL)
     {
-        warning("No operands passed into add!");
-        return ZERO_RET_VAL;
+        yyerror("Memory allocation failed!");
+        exit(1);
     }
 
-    RET_VAL result = eval(current);
+    join->count = count;
+    join->forked = forkable;
+    join->scope = copyEvalScope(interp);
 
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+    for (size_t i = 0; i < count; i++)
+    {
+        join->tasks[i].tree = tree;
+        join->tasks[i].node = tree->nodes[node].first + i;
+        join->tasks[i].scope = join->scope;
+    }
 
-        // convert overall type to double if there is any double operand
-        if (result.type == INT_TYPE && newVal.type == DOUBLE_TYPE) {
-            result.type = DOUBLE_TYPE;
+    // pushed last to first, so this thread pops them back in source order
+    size_t first = __builtin_ctzll(forkable);
+    for (size_t i = count; i-- > first + 1;)
+    {
+        if (forkable >> i & 1)
+        {
+            pushForkTask(interp, &join->tasks[i]);
         }
-
-        result.value += newVal.value;
-        current = current->next;
     }
 
-    return result;
-}
+    atomic_fetch_add(&interp->fork->forks, 1);
+    evalForkTask(interp, &join->tasks[first]);
 
-RET_VAL evalSubFuncNode(AST_NODE *node) {
-    if (!node)
+    size_t warnings = join->tasks[first].warnings;
+    for (size_t i = first + 1; i < count; i++)
     {
-        yyerror("NULL ast node passed into evalDivFuncNode!");
-        return NAN_RET_VAL; 
-    }
+        if (!(forkable >> i & 1))
+        {
+            continue;
+        }
 
-    if (node->data.function.opList == NULL)
-    {
-        warning("No operands passed into sub!");
-        return NAN_RET_VAL;
+        if (popForkTask(interp, &join->tasks[i]))
+        {
+            evalForkTask(interp, &join->tasks[i]);
+        }
+        else
+        {
+            joinForkTask(interp, &join->tasks[i]);
+        }
+        warnings += join->tasks[i].warnings;
     }
 
-    if (node->data.function.opList->next == NULL)
+    if (warnings > 0)
     {
-        warning("Only one operand passed into sub!");
-        return NAN_RET_VAL;
+        atomic_fetch_add(&interp->fork->redone, 1);
+        memFree(join->scope);
+        memFree(join);
+        return NULL;
     }
 
-    if (node->data.function.opList->next->next != NULL)
+    return join;
+}
+
+// The i-th operand of a variadic call: its forked result or evaluated here
+static RET_VAL operandValue(INTERP *interp, FORK_JOIN *join, const FLAT_TREE *tree, uint32_t node, size_t i)
+{
+    if (join != NULL && i < join->count && (join->forked >> i & 1))
     {
-        warning("sub called with extra (ignored) operands!!");
+        return join->tasks[i].result;
     }
 
-    RET_VAL left = eval(node->data.function.opList);
-    RET_VAL right = eval(node->data.function.opList->next);
+    return eval(interp, tree, tree->nodes[node].first + i);
+}
 
-    if (right.type == DOUBLE_TYPE ) {
-        left.type = DOUBLE_TYPE;
+static void freeForkJoin(FORK_JOIN *join)
+{
+    if (join != NULL)
+    {
+        memFree(join->scope);
+        memFree(join);
     }
-
-    left.value = left.value - right.value;
-
-    return left;
 }
 
-RET_VAL evalMultFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalNegFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalMultFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into neg");
+        return NAN_RET_VAL;
     }
 
-    AST_NODE *current = node->data.function.opList;
+    return numNeg(interp, eval(interp, tree, tree->nodes[node].first));
+}
 
-    if (current == NULL)
+RET_VAL evalAbsFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        warning("No operands passed into mult!");
-        return (RET_VAL){INT_TYPE, 1};
+        warning(interp, "No operands passed into abs");
+        return NAN_RET_VAL;
     }
 
-    RET_VAL result = eval(current);
+    return numAbs(interp, eval(interp, tree, tree->nodes[node].first));
+}
 
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+RET_VAL evalAddFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t count = tree->nodes[node].count;
 
-        // convert overall type to double if there is any double operand
-        if (result.type == INT_TYPE && newVal.type == DOUBLE_TYPE) {
-            result.type = DOUBLE_TYPE;
-        }
+    if (count == 0)
+    {
+        warning(interp, "No operands passed into add!");
+        return ZERO_RET_VAL;
+    }
 
-        result.value *= newVal.value;
-        current = current->next;
+    FORK_JOIN *join = forkOperands(interp, tree, node);
+    RET_VAL result = operandValue(interp, join, tree, node, 0);
+
+    for (uint32_t i = 1; i < count; i++) {
+        // the overall type is double if there is any double operand
+        result = numAdd(interp, result, operandValue(interp, join, tree, node, i));
     }
 
+    freeForkJoin(join);
     return result;
 }
 
-RET_VAL evalDivFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalDivFuncNode!");
-        return NAN_RET_VAL; 
-    }
-
-    if (node->data.function.opList == NULL)
+RET_VAL evalSubFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        warning("No operands passed into div!");
+        warning(interp, "No operands passed into sub!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next == NULL)
+    if (tree->nodes[node].count < 2)
     {
-        warning("Only one operand passed into div!");
+        warning(interp, "Only one operand passed into sub!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next->next != NULL)
+    if (tree->nodes[node].count > 2)
     {
-        warning("div called with extra (ignored) operands!!");
+        warning(interp, "sub called with extra (ignored) operands!!");
     }
 
-    RET_VAL left = eval(node->data.function.opList);
-    RET_VAL right = eval(node->data.function.opList->next);
-
-    if (left.type == DOUBLE_TYPE || right.type == DOUBLE_TYPE ) {
-        left.type = DOUBLE_TYPE;
-        left.value = left.value / right.value;
-    } else {
-        left.type = INT_TYPE;
-        left.value = floor(left.value / right.value);
-    }
+    RET_VAL left = eval(interp, tree, tree->nodes[node].first);
+    RET_VAL right = eval(interp, tree, tree->nodes[node].first + 1);
 
-    return left;
+    return numSub(interp, left, right);
 }
 
-RET_VAL evalRemainderFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalRemainderFuncNode!");
-        return NAN_RET_VAL; 
-    }
+RET_VAL evalMultFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t count = tree->nodes[node].count;
 
-    if (node->data.function.opList == NULL)
+    if (count == 0)
     {
-        warning("No operands passed into remainder!");
-        return NAN_RET_VAL;
+        warning(interp, "No operands passed into mult!");
+        return INT_RET_VAL(1);
     }
 
-    if (node->data.function.opList->next == NULL)
-    {
-        warning("Only one operand passed into remainder!");
-        return NAN_RET_VAL;
-    }
+    FORK_JOIN *join = forkOperands(interp, tree, node);
+    RET_VAL result = operandValue(interp, join, tree, node, 0);
 
-    if (node->data.function.opList->next->next != NULL)
-    {
-        warning("remainder called with extra (ignored) operands!!");
+    for (uint32_t i = 1; i < count; i++) {
+        // the overall type is double if there is any double operand
+        result = numMult(interp, result, operandValue(interp, join, tree, node, i));
     }
 
-    RET_VAL left = eval(node->data.function.opList);
-    RET_VAL right = eval(node->data.function.opList->next);
-
-    if (right.type == DOUBLE_TYPE ) {
-        left.type = DOUBLE_TYPE;
-    } 
-
-    left.value = fmod(left.value, right.value);
-
-    return left;
+    freeForkJoin(join);
+    return result;
 }
 
-RET_VAL evalExpFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalDivFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalExpFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into div!");
+        return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList == NULL)
+    if (tree->nodes[node].count < 2)
     {
-        warning("No operands passed into exp!");
+        warning(interp, "Only one operand passed into div!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next != NULL)
+    if (tree->nodes[node].count > 2)
     {
-        warning("exp called with extra (ignored) operands!!");
+        warning(interp, "div called with extra (ignored) operands!!");
     }
 
-    RET_VAL result = eval(node->data.function.opList);
-    result.value = expf(result.value);
-
-    // Always make the final type a double
-    result.type = DOUBLE_TYPE;
+    RET_VAL left = eval(interp, tree, tree->nodes[node].first);
+    RET_VAL right = eval(interp, tree, tree->nodes[node].first + 1);
 
-    return result;
+    return numDiv(interp, left, right);
 }
 
-RET_VAL evalExp2FuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalRemainderFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalExp2FuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into remainder!");
+        return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList == NULL)
+    if (tree->nodes[node].count < 2)
     {
-        warning("No operands passed into exp2!");
+        warning(interp, "Only one operand passed into remainder!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next != NULL)
+    if (tree->nodes[node].count > 2)
     {
-        warning("exp2 called with extra (ignored) operands!!");
+        warning(interp, "remainder called with extra (ignored) operands!!");
     }
 
-    RET_VAL result = eval(node->data.function.opList);
-
-    // a negative operand means its always a double
-    if (result.value < 0) {
-        result.type = DOUBLE_TYPE;
-    } 
-
-    result.value = exp2f(result.value);
+    RET_VAL left = eval(interp, tree, tree->nodes[node].first);
+    RET_VAL right = eval(interp, tree, tree->nodes[node].first + 1);
 
-    return result;
+    return numRem(interp, left, right);
 }
 
-RET_VAL evalPowFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalExpFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalPowFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into exp!");
+        return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList == NULL)
+    if (tree->nodes[node].count > 1)
     {
-        warning("No operands passed into pow!");
-        return NAN_RET_VAL;
+        warning(interp, "exp called with extra (ignored) operands!!");
     }
 
-    if (node->data.function.opList->next == NULL)
+    // Always make the final type a double
+    return numExp(interp, eval(interp, tree, tree->nodes[node].first));
+}
+
+RET_VAL evalExp2FuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        warning("Only one operand passed into pow!");
+        warning(interp, "No operands passed into exp2!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next->next != NULL)
+    if (tree->nodes[node].count > 1)
     {
-        warning("pow called with extra (ignored) operands!!");
+        warning(interp, "exp2 called with extra (ignored) operands!!");
     }
 
-    RET_VAL left = eval(node->data.function.opList);
-    RET_VAL right = eval(node->data.function.opList->next);
-
-    // if right type is double we ensure left changes to double if needed
-    if (right.type == DOUBLE_TYPE ) {
-        left.type = DOUBLE_TYPE;
-    } 
-
-    left.value = pow(left.value, right.value);
-
-    return left;
+    return numExp2(interp, eval(interp, tree, tree->nodes[node].first));
 }
 
-RET_VAL evalLogFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalPowFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalLogFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into pow!");
+        return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList == NULL)
+    if (tree->nodes[node].count < 2)
     {
-        warning("No operands passed into log!");
+        warning(interp, "Only one operand passed into pow!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next != NULL)
+    if (tree->nodes[node].count > 2)
     {
-        warning("log called with extra (ignored) operands!!");
+        warning(interp, "pow called with extra (ignored) operands!!");
     }
 
-    RET_VAL result = eval(node->data.function.opList);
-    result.value = log(result.value);
-
-    // log always returns a double
-    result.type = DOUBLE_TYPE;
+    RET_VAL left = eval(interp, tree, tree->nodes[node].first);
+    RET_VAL right = eval(interp, tree, tree->nodes[node].first + 1);
 
-    return result;
+    return numPow(interp, left, right);
 }
 
-RET_VAL evalSqrtFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalSqrtFuncNode!");
-        return NAN_RET_VAL; 
-    }
-
-    if (node->data.function.opList == NULL)
+RET_VAL evalLogFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        warning("No operands passed into sqrt!");
+        warning(interp, "No operands passed into log!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next != NULL)
+    if (tree->nodes[node].count > 1)
     {
-        warning("sqrt called with extra (ignored) operands!!");
+        warning(interp, "log called with extra (ignored) operands!!");
     }
 
-    RET_VAL result = eval(node->data.function.opList);
-    result.value = sqrt(result.value);
-
     // log always returns a double
-    result.type = DOUBLE_TYPE;
-
-    return result;
+    return numLog(interp, eval(interp, tree, tree->nodes[node].first));
 }
 
-RET_VAL evalCbrtFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalCbrtFuncNode!");
-        return NAN_RET_VAL; 
-    }
-
-    if (node->data.function.opList == NULL)
+RET_VAL evalSqrtFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        warning("No operands passed into cbrt!");
+        warning(interp, "No operands passed into sqrt!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next != NULL)
+    if (tree->nodes[node].count > 1)
     {
-        warning("cbrt called with extra (ignored) operands!!");
+        warning(interp, "sqrt called with extra (ignored) operands!!");
     }
 
-    RET_VAL result = eval(node->data.function.opList);
-    result.value = cbrt(result.value);
-
-    // log always returns a double
-    result.type = DOUBLE_TYPE;
-
-    return result;
+    // sqrt always returns a double
+    return numSqrt(interp, eval(interp, tree, tree->nodes[node].first));
 }
 
-RET_VAL evalHypotFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalCbrtFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalHypotFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into cbrt!");
+        return NAN_RET_VAL;
     }
 
-    AST_NODE *current = node->data.function.opList;
+    if (tree->nodes[node].count > 1)
+    {
+        warning(interp, "cbrt called with extra (ignored) operands!!");
+    }
+
+    // cbrt always returns a double
+    return numCbrt(interp, eval(interp, tree, tree->nodes[node].first));
+}
 
-    if (current == NULL)
+RET_VAL evalHypotFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
+
+    if (count == 0)
     {
-        warning("No operands passed into hypot!");
+        warning(interp, "No operands passed into hypot!");
         return ZERO_RET_VAL;
     }
 
-    RET_VAL result;
-    result.value = 0.0;
-    result.type = DOUBLE_TYPE;
+    RET_VAL args[count];
 
-    while (current != NULL) {
-        RET_VAL val =  eval(current);
-        result.value += pow(val.value, 2.0);
-        current = current->next;
+    for (uint32_t i = 0; i < count; i++) {
+        args[i] = eval(interp, tree, op + i);
     }
 
-    result.value = sqrt(result.value);
-
-    return result;
+    return numHypot(interp, args, count);
 }
 
-RET_VAL evalMaxFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalMaxFuncNode!");
-        return NAN_RET_VAL; 
-    }
+RET_VAL evalMaxFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t count = tree->nodes[node].count;
 
-    AST_NODE *current = node->data.function.opList;
-
-    if (current == NULL)
+    if (count == 0)
     {
-        warning("No operands passed into max!");
+        warning(interp, "No operands passed into max!");
         return NAN_RET_VAL;
     }
 
-    RET_VAL result = eval(current);
-
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+    FORK_JOIN *join = forkOperands(interp, tree, node);
+    RET_VAL result = operandValue(interp, join, tree, node, 0);
 
-        if (newVal.value > result.value) {
-            result = newVal;
-        }
+    if (count == 1) {
+        // the max of one vector is its largest element
+        result = vecReduce(interp, VEC_MAX, result);
+    }
 
-        current = current->next;
+    for (uint32_t i = 1; i < count; i++) {
+        result = numMax(interp, result, operandValue(interp, join, tree, node, i));
     }
 
+    freeForkJoin(join);
     return result;
 }
 
-RET_VAL evalMinFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalMinFuncNode!");
-        return NAN_RET_VAL; 
-    }
+RET_VAL evalMinFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t count = tree->nodes[node].count;
 
-    AST_NODE *current = node->data.function.opList;
-
-    if (current == NULL)
+    if (count == 0)
     {
-        warning("No operands passed into min!");
+        warning(interp, "No operands passed into min!");
         return NAN_RET_VAL;
     }
 
-    RET_VAL result = eval(current);
+    FORK_JOIN *join = forkOperands(interp, tree, node);
+    RET_VAL result = operandValue(interp, join, tree, node, 0);
 
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+    if (count == 1) {
+        result = vecReduce(interp, VEC_MIN, result);
+    }
 
-        if (newVal.value < result.value) {
-            result = newVal;
-        }
-        current = current->next;
+    for (uint32_t i = 1; i < count; i++) {
+        result = numMin(interp, result, operandValue(interp, join, tree, node, i));
     }
 
+    freeForkJoin(join);
     return result;
 }
 
-RET_VAL evalRandFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalMinFuncNode!");
-        return NAN_RET_VAL; 
-    }
-
-    if (node->data.function.opList != NULL)
+RET_VAL evalRandFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count != 0)
     {
-        warning("rand called with extra (ignored) operands!!");
+        warning(interp, "rand called with extra (ignored) operands!!");
     }
 
-    return (RET_VAL){DOUBLE_TYPE, (double) rand() / (double)RAND_MAX};
+    return DOUBLE_RET_VAL((double) rand() / (double)RAND_MAX);
 }
 
 // Helper to do a strict parse of the character before using strtod
 // strtod can return the reading early on a bad char but still give some value
-RET_VAL parseReadValue(const char *line) {
+RET_VAL parseReadValue(INTERP *interp, const char *line) {
 
     const char* ptr = line;
     size_t i = 0;
@@ -844,7 +783,7 @@ RET_VAL parseReadValue(const char *line) {
 
     // Must have at least one digit
     if (*ptr < '0' || *ptr > '9') {
-        warning("Invalid read entry! Number must start with a digit");
+        warning(interp, "Invalid read entry! Number must start with a digit");
         return NAN_RET_VAL;
     }
 
@@ -856,45 +795,74 @@ RET_VAL parseReadValue(const char *line) {
         while (*ptr >= '0' && *ptr <= '9') ptr++;
 
         if (*ptr != '\0') {
-            warning("Invalid read entry! Non digits detected!");
+            warning(interp, "Invalid read entry! Non digits detected!");
             return NAN_RET_VAL;
         }
 
-        return (RET_VAL){DOUBLE_TYPE, strtod(line, NULL)};
+        return DOUBLE_RET_VAL(strtod(line, NULL));
 
     } else if (*ptr == '\0') {
-        return (RET_VAL){INT_TYPE, strtod(line, NULL)};
+        errno = 0;
+        int64_t integer = strtoll(line, NULL, 10);
+
+        if (errno == ERANGE) {
+            warning(interp, "Integer read entry out of range, reading it as a double");
+            return DOUBLE_RET_VAL(strtod(line, NULL));
+        }
+
+        return INT_RET_VAL(integer);
     }
 
-    warning("Invalid read entry! Non digits detected!");
+    warning(interp, "Invalid read entry! Non digits detected!");
     return NAN_RET_VAL; 
 }
 
+#define READ_SEPARATORS " \t,"
 
-RET_VAL evalReadFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalMinFuncNode!");
-        return NAN_RET_VAL; 
+// Number of fields separated by spaces, tabs or commas on a read line
+static size_t countReadFields(const char *line) {
+    size_t count = 0;
+
+    while (*(line += strspn(line, READ_SEPARATORS)) != '\0') {
+        count++;
+        line += strcspn(line, READ_SEPARATORS);
     }
 
-    if (node->data.function.opList != NULL)
-    {
-        warning("read called with extra (ignored) operands!!");
+    return count;
+}
+
+// Each field is parsed like a single number, an invalid one warns and reads as NaN
+static RET_VAL parseReadVector(INTERP *interp, char *line, size_t count) {
+    VECTOR *vector = createVector(interp, count);
+    char *save;
+    size_t i = 0;
+
+    for (char *field = strtok_r(line, READ_SEPARATORS, &save); field != NULL; field = strtok_r(NULL, READ_SEPARATORS, &save)) {
+        vector->data[i++] = numValue(parseReadValue(interp, field));
     }
 
+    return VECTOR_RET_VAL(vector);
+}
+
+// Reads one line from interp->readTarget and parses it into a number,
+// or a vector when the line holds more than one
+RET_VAL readRetVal(INTERP *interp) {
     // hardcoded maximum line size of 256
     char line[MAX_READ_CHARS + 1];
 
-    fprintf(stdout, "read :: ");
+    outputString(&interp->out, "read :: ");
+    // the prompt and everything before it has to be out before blocking on input
+    flushOutput(&interp->out);
+    fflush(stdout);
 
-    if (fgets(line, sizeof(line), read_target) == NULL) {
-        warning("read could not read line");
+    if (fgets(line, sizeof(line), interp->readTarget) == NULL) {
+        warning(interp, "read could not read line");
         return NAN_RET_VAL; 
     }
 
-    if (read_target != stdin) {
-      fprintf(stdout, "%s\n", line);
+    if (interp->readTarget != stdin) {
+      outputString(&interp->out, line);
+      outputText(&interp->out, "\n", 1);
     }
 
     int end = MAX_READ_CHARS;
@@ -916,551 +884,1227 @@ RET_VAL evalReadFuncNode(AST_NODE *node) {
 
     line[end] = '\0';
 
-    return parseReadValue(line);
-}
+    size_t fields = countReadFields(line);
 
-RET_VAL evalEqualFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalEqualFuncNode!");
-        return NAN_RET_VAL; 
+    if (fields > 1) {
+        return parseReadVector(interp, line, fields);
     }
 
-    AST_NODE *current = node->data.function.opList;
+    return parseReadValue(interp, line);
+}
 
-    if (current == NULL)
+RET_VAL evalReadFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count != 0)
     {
-        warning("No operands passed into equal!");
+        warning(interp, "read called with extra (ignored) operands!!");
+    }
+
+    return readRetVal(interp);
+}
+
+// Prints the allocation counters of the whole process, see mem.c, and
+// returns the bytes still allocated
+RET_VAL memStatsRetVal(INTERP *interp) {
+    char text[MAX_MEM_STATS_CHARS];
+
+    outputText(&interp->out, text, formatMemStats(text, sizeof(text)));
+
+    return INT_RET_VAL((int64_t) memCounters(MEM_CATEGORY_COUNT).live);
+}
+
+RET_VAL evalMemStatsFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count != 0)
+    {
+        warning(interp, "memstats called with extra (ignored) operands!!");
+    }
+
+    return memStatsRetVal(interp);
+}
+
+RET_VAL evalEqualFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
+
+    if (count == 0)
+    {
+        warning(interp, "No operands passed into equal!");
         return ZERO_RET_VAL;
     }
 
-    RET_VAL result = eval(current);
+    RET_VAL result = eval(interp, tree, op);
 
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+    for (uint32_t i = 1; i < count; i++) {
+        RET_VAL newVal = eval(interp, tree, op + i);
 
-        if (newVal.value != result.value) {
+        if (!numEqual(newVal, result)) {
               return ZERO_RET_VAL;
         }
-
-        current = current->next;
     }
 
-    return (RET_VAL){INT_TYPE, 1};
+    return INT_RET_VAL(1);
 }
 
-RET_VAL evalLessFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalLessFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
+
+    if (count == 0)
     {
-        yyerror("NULL ast node passed into evalEqualFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into equal!");
+        return ZERO_RET_VAL;
+    }
+
+    RET_VAL result = eval(interp, tree, op);
+
+    for (uint32_t i = 1; i < count; i++) {
+        RET_VAL newVal = eval(interp, tree, op + i);
+
+        if (numLessEqual(newVal, result)) {
+              return ZERO_RET_VAL;
+        }
     }
 
-    AST_NODE *current = node->data.function.opList;
+    return INT_RET_VAL(1);
+}
+
+RET_VAL evalGreaterFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
 
-    if (current == NULL)
+    if (count == 0)
     {
-        warning("No operands passed into equal!");
+        warning(interp, "No operands passed into equal!");
         return ZERO_RET_VAL;
     }
 
-    RET_VAL result = eval(current);
+    RET_VAL result = eval(interp, tree, op);
 
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+    for (uint32_t i = 1; i < count; i++) {
+        RET_VAL newVal = eval(interp, tree, op + i);
 
-        if (newVal.value <= result.value) {
+        if (numLessEqual(result, newVal)) {
               return ZERO_RET_VAL;
         }
+    }
 
-        current = current->next;
+    return INT_RET_VAL(1);
+}
+
+RET_VAL evalPrintFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
+    {
+        warning(interp, "No operands passed into print");
+        return NAN_RET_VAL;
+    }
+
+    if (tree->nodes[node].count > 1)
+    {
+        warning(interp, "print called with extra (ignored) operands!!");
     }
 
-    return (RET_VAL){INT_TYPE, 1};
+    RET_VAL r = eval(interp, tree, tree->nodes[node].first);
+
+    printRetVal(interp, r);
+
+    return r;
 }
 
-RET_VAL evalGreaterFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalVectorFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
+
+    if (count == 0)
     {
-        yyerror("NULL ast node passed into evalEqualFuncNode!");
-        return NAN_RET_VAL; 
+        return VECTOR_RET_VAL(createVector(interp, 0));
+    }
+
+    RET_VAL args[count];
+
+    for (uint32_t i = 0; i < count; i++) {
+        args[i] = eval(interp, tree, op + i);
     }
 
-    AST_NODE *current = node->data.function.opList;
+    return vecConcat(interp, args, count);
+}
+
+RET_VAL evalRangeFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
 
-    if (current == NULL)
+    if (count == 0)
     {
-        warning("No operands passed into equal!");
-        return ZERO_RET_VAL;
+        warning(interp, "No operands passed into range!");
+        return NAN_RET_VAL;
+    }
+
+    if (count > 3)
+    {
+        warning(interp, "range called with extra (ignored) operands!!");
+        count = 3;
     }
 
-    RET_VAL result = eval(current);
+    RET_VAL args[3];
 
-    while (current->next != NULL) {
-        RET_VAL newVal = eval(current->next);
+    for (uint32_t i = 0; i < count; i++) {
+        args[i] = eval(interp, tree, op + i);
+    }
 
-        if (newVal.value >= result.value) {
-              return ZERO_RET_VAL;
-        }
+    return vecRange(interp, args, count);
+}
+
+RET_VAL evalSumFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
+    {
+        warning(interp, "No operands passed into sum!");
+        return ZERO_RET_VAL;
+    }
 
-        current = current->next;
+    if (tree->nodes[node].count > 1)
+    {
+        warning(interp, "sum called with extra (ignored) operands!!");
     }
 
-    return (RET_VAL){INT_TYPE, 1};
+    return vecReduce(interp, VEC_ADD, eval(interp, tree, tree->nodes[node].first));
 }
 
-RET_VAL evalPrintFuncNode(AST_NODE *node) {
-    if (!node)
+RET_VAL evalDotFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
     {
-        yyerror("NULL ast node passed into evalPrintFuncNode!");
-        return NAN_RET_VAL; 
+        warning(interp, "No operands passed into dot!");
+        return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList == NULL)
+    if (tree->nodes[node].count < 2)
     {
-        warning("No operands passed into print");
+        warning(interp, "Only one operand passed into dot!");
         return NAN_RET_VAL;
     }
 
-    if (node->data.function.opList->next != NULL)
+    if (tree->nodes[node].count > 2)
     {
-        warning("print called with extra (ignored) operands!!");
+        warning(interp, "dot called with extra (ignored) operands!!");
     }
 
-    RET_VAL r = eval(node->data.function.opList);
+    RET_VAL left = eval(interp, tree, tree->nodes[node].first);
+    RET_VAL right = eval(interp, tree, tree->nodes[node].first + 1);
 
-    printRetVal(r);
+    return numDot(interp, left, right);
+}
 
-    return r;
+RET_VAL evalLenFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    if (tree->nodes[node].count == 0)
+    {
+        warning(interp, "No operands passed into len!");
+        return ZERO_RET_VAL;
+    }
+
+    if (tree->nodes[node].count > 1)
+    {
+        warning(interp, "len called with extra (ignored) operands!!");
+    }
+
+    return numLen(eval(interp, tree, tree->nodes[node].first));
 }
 
-STACK_NODE* createStackNode(RET_VAL val) {
-    STACK_NODE *node;
-    size_t nodeSize;
+static void pushEvalValue(INTERP *interp, RET_VAL value)
+{
+    EVAL_STACK *stack = &interp->evalStack;
 
-    nodeSize = sizeof(STACK_NODE);
-    if ((node = calloc(nodeSize, 1)) == NULL)
+    if (stack->valueLen == stack->valueCap)
     {
-        yyerror("Memory allocation failed!");
-        exit(1);
+        stack->valueCap = stack->valueCap ? stack->valueCap * 2 : 256;
+        if ((stack->values = memRealloc(MEM_STACKS, stack->values, stack->valueCap * sizeof(RET_VAL))) == NULL)
+        {
+            yyerror("Memory allocation failed!");
+            exit(1);
+        }
     }
 
-    node->value = val;
-    return node;
+    stack->values[stack->valueLen++] = value;
 }
 
-RET_VAL evalNumNode(AST_NODE *node)
+// Pushes a frame whose args are already on the value stack and fills in its let slots
+static void pushEvalFrame(INTERP *interp, size_t base, size_t link, int frameSize)
 {
-    if (!node)
+    EVAL_STACK *stack = &interp->evalStack;
+
+    while (stack->valueLen < base + frameSize)
     {
-        yyerror("NULL ast node passed into evalNumNode!");
-        return NAN_RET_VAL;
+        pushEvalValue(interp, UNFORCED_SLOT);
     }
 
-    if (node->type != NUM_NODE_TYPE)
+    if (stack->frameLen == stack->frameCap)
+    {
+        stack->frameCap = stack->frameCap ? stack->frameCap * 2 : 64;
+        if ((stack->frames = memRealloc(MEM_STACKS, stack->frames, stack->frameCap * sizeof(EVAL_FRAME))) == NULL)
+        {
+            yyerror("Memory allocation failed!");
+            exit(1);
+        }
+    }
+
+    stack->frames[stack->frameLen] = (EVAL_FRAME){base, link, frameSize};
+    stack->current = stack->frameLen++;
+}
+
+// Evaluates a forked operand above whatever this thread's stack holds, in a
+// copy of the frames it was forked from, with warnings muted and counted
+void evalForkTask(INTERP *interp, FORK_TASK *task)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    const FORK_SCOPE *scope = task->scope;
+    size_t valueLen = stack->valueLen;
+    size_t frameLen = stack->frameLen;
+    size_t current = stack->current;
+    size_t warnings = interp->warningCount;
+    bool muted = interp->muteWarnings;
+    // a cached result would skip the warnings it raised when the call is redone
+    size_t memoLimit = interp->memo.limit;
+
+    for (size_t i = 0; i < scope->valueLen; i++)
+    {
+        pushEvalValue(interp, scope->values[i]);
+    }
+
+    for (size_t i = 0; i < scope->frameLen; i++)
+    {
+        EVAL_FRAME *frame = &scope->frames[i];
+        pushEvalFrame(interp, valueLen + frame->base, frameLen + frame->link, frame->size);
+    }
+
+    interp->muteWarnings = true;
+    interp->memo.limit = 0;
+
+    task->result = eval(interp, task->tree, task->node);
+    task->warnings = interp->warningCount - warnings;
+
+    interp->muteWarnings = muted;
+    interp->memo.limit = memoLimit;
+    interp->warningCount = warnings;
+    stack->valueLen = valueLen;
+    stack->frameLen = frameLen;
+    stack->current = current;
+}
+
+RET_VAL evalNumNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    if (tree->nodes[node].kind != NUM_NODE_TYPE)
     {
         yyerror("Incorrect ast node passed into evalNumNode!");
         return NAN_RET_VAL;
     }
 
-    return node->data.number;
+    return flatNumber(tree, node);
 }
 
-RET_VAL evalSymbolTableNode(SYMBOL_TABLE_NODE *symbol)
+// Evaluates a lamda body (or let value) in the current frame and applies the symbol's cast
+RET_VAL evalSymbolTableNode(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *symbol)
 {   
     if (!symbol || !symbol->value) {
         yyerror("Incorrect ast node passed into evalSymbolTableNode!");
         return NAN_RET_VAL;
     }
 
-    AST_NODE_TYPE start_type = symbol->value->type;
-    RET_VAL result = eval(symbol->value);
+    return castRetVal(interp, eval(interp, tree, symbol->root), symbol->type);
+}
 
-    // first evaluation means we need to swap out the value with a simple number node
-    if (symbol->symbolType != LAMBDA_TYPE && start_type != NUM_NODE_TYPE) {
-        AST_NODE* new_node = createNumberNode(result.value, result.type);
-        freeNode(symbol->value);
-        symbol->value = new_node;
+// Applies the cast of a typed symbol (let or lambda) to an evaluated value
+RET_VAL castRetVal(INTERP *interp, RET_VAL result, NUM_TYPE type)
+{
+    if (type == NO_TYPE || type == result.type) {
+        return result;
     }
 
-    if (symbol->type == NO_TYPE || symbol->type == result.type) {
+    // the elements are doubles already and there are no int vectors
+    if (result.type == VECTOR_TYPE)
+    {
+        if (type == INT_TYPE)
+        {
+            warning(interp, "Can't cast a vector to int, keeping the vector");
+        }
         return result;
     }
 
-    // Symbol type would be int if this is true
-    // since the method would return early if types matched
-    if (result.type == DOUBLE_TYPE)
+    if (type == DOUBLE_TYPE)
     {
-        warning("Precision loss on int cast from %.2lf to %d", 
-            result.value, (int) result.value);
-        result.value = floor(result.value);
-    } 
+        return DOUBLE_RET_VAL(numValue(result));
+    }
 
-    result.type = symbol->type;
+    // Symbol type is int since the method would return early if types matched
+    double value = floor(result.value);
 
-    return result;
+    // NaN and infinities have no int to go to
+    if (!fitsInt64(value))
+    {
+        warning(interp, "Integer overflow on int cast from %.2lf, keeping a double", result.value);
+        return result;
+    }
+
+    warning(interp, "Precision loss on int cast from %.2lf to %lld", result.value, (long long) value);
+
+    return INT_RET_VAL((int64_t) value);
 }
 
-void freeStackNode(STACK_NODE* stack) {
-    STACK_NODE* prev_stack;
+// Evaluates the operands of a lamda call onto the value stack, where they
+// become the first slots of the callee's frame
+static bool pushLamdaArgs(INTERP *interp, const FLAT_TREE *tree, uint32_t node, SYMBOL_TABLE_NODE *lamda)
+{
+    size_t base = interp->evalStack.valueLen;
+    SYMBOL_TABLE_NODE* arg = lamda->arg_list;
+    uint32_t op = tree->nodes[node].first;
+    uint32_t end = op + tree->nodes[node].count;
+
+    while (arg != NULL) {
+        if (op == end) {
+            warning(interp, "Not enough arguments passed into lamda: %s", lamda->id);
+            interp->evalStack.valueLen = base;
+            return false;
+        }
 
-    while (stack != NULL) {
-        prev_stack = stack;
-        stack = stack->next;
-        free(prev_stack);
+        pushEvalValue(interp, eval(interp, tree, op));
+
+        arg = arg->next;
+        op++;
+    }
+
+    if (op != end) {
+        warning(interp, "lamda: %s called with extra (ignored) arguments!!", lamda->id);
     }
+
+    return true;
 }
 
-RET_VAL evalCustomFuncNode(AST_NODE *node) {
-    if (!node)
-    {
-        yyerror("NULL ast node passed into evalCustomFuncNode!");
-        return NAN_RET_VAL; 
+static RET_VAL applyLamda(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *lamda, size_t base, size_t link);
+
+RET_VAL evalCustomFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    EVAL_STACK *stack = &interp->evalStack;
+
+    SYMBOL_TABLE_NODE *lamda = flatBinding(tree, node);
+
+    // undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL) {
+        return NAN_RET_VAL;
+    }
+
+    size_t base = stack->valueLen;
+
+    if (!pushLamdaArgs(interp, tree, node, lamda)) {
+        return NAN_RET_VAL;
     }
 
-    // Search through scopes to find the closest symbol defintion
-    AST_NODE *currentScope = node;
-    SYMBOL_TABLE_NODE *lamda = NULL;
+    return applyLamda(interp, tree, lamda, base, findEvalFrame(interp, tree->refs[tree->nodes[node].value].depth));
+}
+
+// Runs a lamda for applyLamda, the args are popped along with the frame. With
+// --profile mark times the call, tail calls close it and open the callee's.
+static RET_VAL callLamda(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *lamda, size_t base, size_t link, PROFILE_MARK *mark)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    RET_VAL result;
+    MEMO_TABLE *memo = memoTableFor(interp, lamda);
 
-    while (currentScope != NULL) { 
-        if (currentScope->symbolTable != NULL) {
-            SYMBOL_TABLE_NODE *symbol = currentScope->symbolTable;
-            while (symbol != NULL) {
-                if (symbol->symbolType == LAMBDA_TYPE && strcmp(symbol->id, node->data.symbol.id) == 0) {
-                    lamda = symbol;
-                    break;
-                }
-                symbol = symbol->next;
+    if (memo != NULL && memoLookup(interp, memo, stack->values + base, &result)) {
+        stack->valueLen = base;
+        return result;
+    }
+
+    // a result that warned isn't cached, a hit would skip its warnings
+    size_t warnings = interp->warningCount;
+    size_t caller = stack->current;
+    pushEvalFrame(interp, base, link, lamda->frameSize);
+
+    uint32_t body = lamda->root;
+
+    for (;;)
+    {
+        // follow the tail position of the body down through scopes and conds,
+        // a cond's children being its condition and the two branches
+        while (tree->nodes[body].kind == SCOPE_NODE_TYPE || tree->nodes[body].kind == COND_NODE_TYPE)
+        {
+            uint32_t child = tree->nodes[body].first;
+
+            if (tree->nodes[body].kind == SCOPE_NODE_TYPE) {
+                body = child;
+            } else {
+                body = numIsTrue(eval(interp, tree, child)) ? child + 1 : child + 2;
             }
         }
 
-        if (lamda != NULL) {
+        if (tree->nodes[body].kind != FUNC_NODE_TYPE || !tree->nodes[body].tail) {
+            result = eval(interp, tree, body);
             break;
         }
 
-        // Look further up the tree next iteration
-        currentScope = currentScope->parent;
+        // A tail call evaluates its args above the frame, then slides them down
+        // over it and runs the callee in its place instead of nesting.
+        SYMBOL_TABLE_NODE *callee = flatBinding(tree, body);
+        size_t args = stack->valueLen;
+        size_t link = findEvalFrame(interp, tree->refs[tree->nodes[body].value].depth);
+
+        pushLamdaArgs(interp, tree, body, callee);
+
+        // the caller is done once its args are in, the rest is the callee's call.
+        // The call node is run here instead of through profileFuncNode, so it
+        // is counted here, its time is in the call that started the loop.
+        if (mark != NULL) {
+            interp->profile.funcs[CUSTOM_FUNC].calls++;
+            profileLeave(&interp->profile, mark);
+            profileEnter(&interp->profile, profileEntry(&interp->profile.lamdas, callee->id), mark);
+        }
+
+        size_t nargs = stack->valueLen - args;
+        memmove(stack->values + base, stack->values + args, nargs * sizeof(RET_VAL));
+        stack->valueLen = base + nargs;
+        stack->frameLen--;
+        pushEvalFrame(interp, base, link, callee->frameSize);
+
+        lamda = callee;
+        body = callee->root;
+
+        // the args the result would be cached under are gone
+        memo = NULL;
     }
 
-    if (lamda == NULL) {
-        warning("Undefined lamda: %s", node->data.symbol.id);
-        return NAN_RET_VAL;
+    // marked tail calls share the cast of the lamda they replaced
+    result = castRetVal(interp, result, lamda->type);
+
+    if (memo != NULL && interp->warningCount == warnings) {
+        memoStore(interp, memo, stack->values + base, result);
     }
 
-    STACK_NODE* prev_stack = NULL;
-    STACK_NODE* top_stack = NULL;
-    STACK_NODE* stack = top_stack;
-    SYMBOL_TABLE_NODE* arg = lamda->arg_list;
-    AST_NODE* op = node->data.function.opList;
+    // pop the frame along with its args and lets
+    stack->frameLen--;
+    stack->valueLen = base;
+    stack->current = caller;
 
-    // first evaluate arguments to local stack
-    // dont change the lamda stack until all args are handled
-    while (arg != NULL) {
-        if (op == NULL) {
-            warning("Not enough arguments passed into lamda: %s", node->data.symbol.id);
-            return NAN_RET_VAL;
-        }
+    return result;
+}
 
-        RET_VAL r = eval(op);
+static RET_VAL profileLamda(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *lamda, size_t base, size_t link)
+{
+    PROFILE_MARK mark;
 
-        if (stack) {
-            stack->value = r;
-        } else {
-            stack = createStackNode(r);
-            if (prev_stack) prev_stack->next = stack;
-            else top_stack = stack;
-        }
-        
-        arg = arg->next;
-        op = op->next;
-        prev_stack = stack;
-        stack = stack->next;
+    profileEnter(&interp->profile, profileEntry(&interp->profile.lamdas, lamda->id), &mark);
+    RET_VAL result = callLamda(interp, tree, lamda, base, link, &mark);
+    profileLeave(&interp->profile, &mark);
+
+    return result;
+}
+
+// --jit: native code when the lamda has some for the types of its args
+static RET_VAL jitLamda(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *lamda, size_t base, size_t link)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    RET_VAL result;
+
+    if (jitCall(interp, lamda, stack->values + base, stack->valueLen - base, &result)) {
+        stack->valueLen = base;
+        return result;
     }
-    freeStackNode(lamda->stack);
 
-    lamda->stack = top_stack;
+    return callLamda(interp, tree, lamda, base, link, NULL);
+}
+
+// Runs a lamda whose args are on the value stack from base up, link is the
+// frame it was defined in
+static RET_VAL applyLamda(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *lamda, size_t base, size_t link)
+{
+    if (interp->profile.enabled) {
+        return profileLamda(interp, tree, lamda, base, link);
+    }
 
-    if (op != NULL) {
-        warning("lamda: %s called with extra (ignored) arguments!!", node->data.symbol.id);
+    if (interp->jit.enabled) {
+        return jitLamda(interp, tree, lamda, base, link);
     }
 
-    return evalSymbolTableNode(lamda);
+    return callLamda(interp, tree, lamda, base, link, NULL);
 }
 
-RET_VAL evalFuncNode(AST_NODE *node)
+// The lamda a range builtin operand names, NULL if it doesn't name one
+SYMBOL_TABLE_NODE *rangeLoopLamda(AST_NODE *operand)
 {
-    if (!node)
+    if (operand == NULL || operand->type != SYM_NODE_TYPE)
     {
-        yyerror("NULL ast node passed into evalFuncNode!");
-        return NAN_RET_VAL; 
+        return NULL;
+    }
+
+    SYMBOL_TABLE_NODE *lamda = operand->data.symbol.binding;
+    return lamda != NULL && lamda->symbolType == LAMBDA_TYPE ? lamda : NULL;
+}
+
+// rangeLoopLamda of a flattened operand, one with a let section is a scope
+static SYMBOL_TABLE_NODE *flatLoopLamda(const FLAT_TREE *tree, uint32_t operand)
+{
+    if (tree->nodes[operand].kind != SYM_NODE_TYPE)
+    {
+        return NULL;
     }
 
-    if (node->type != FUNC_NODE_TYPE)
+    SYMBOL_TABLE_NODE *lamda = flatBinding(tree, operand);
+    return lamda != NULL && lamda->symbolType == LAMBDA_TYPE ? lamda : NULL;
+}
+
+// sum_range, prod_range, count_range and fold_range call a lamda for every
+// integer in [lo, hi) and combine the results as they go, without building
+// the range. The loop variable goes straight into the lamda's arg slot.
+RET_VAL evalRangeLoopFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node) {
+    EVAL_STACK *stack = &interp->evalStack;
+
+    FUNC_TYPE func = tree->nodes[node].func;
+    const char *name = nameOfFunc(func);
+    uint32_t current = tree->nodes[node].first;
+    size_t needed = func == FOLD_RANGE_FUNC ? 5 : 3;
+    size_t count = tree->nodes[node].count;
+
+    if (count == 0)
     {
-        yyerror("Incorrect ast node passed into evalFuncNode!");
+        warning(interp, "No operands passed into %s!", name);
         return NAN_RET_VAL;
     }
 
-    switch (node->data.function.func)
-    {
-    case NEG_FUNC:
-        return evalNegFuncNode(node);
-    case ABS_FUNC:
-        return evalAbsFuncNode(node);    
-    case ADD_FUNC:
-        return evalAddFuncNode(node);    
-    case SUB_FUNC:
-        return evalSubFuncNode(node);
-    case MULT_FUNC:
-        return evalMultFuncNode(node);    
-    case DIV_FUNC:
-        return evalDivFuncNode(node);
-    case REM_FUNC:
-        return evalRemainderFuncNode(node);
-    case EXP_FUNC:
-        return evalExpFuncNode(node);
-    case EXP2_FUNC:
-        return evalExp2FuncNode(node);    
-    case POW_FUNC:
-        return evalPowFuncNode(node);    
-    case LOG_FUNC:
-        return evalLogFuncNode(node);
-    case SQRT_FUNC:
-        return evalSqrtFuncNode(node);    
-    case CBRT_FUNC:
-        return evalCbrtFuncNode(node);
-    case HYPOT_FUNC:
-        return evalHypotFuncNode(node);
-    case MAX_FUNC:
-        return evalMaxFuncNode(node);
-    case MIN_FUNC:
-        return evalMinFuncNode(node);    
-    case RAND_FUNC:
-        return evalRandFuncNode(node);
-    case READ_FUNC:
-        return evalReadFuncNode(node);
-    case EQUAL_FUNC:
-        return evalEqualFuncNode(node);    
-    case LESS_FUNC:
-        return evalLessFuncNode(node);    
-    case GREATER_FUNC:
-        return evalGreaterFuncNode(node);    
-    case PRINT_FUNC:
-        return evalPrintFuncNode(node);
-    case CUSTOM_FUNC:
-        return evalCustomFuncNode(node);
-    default:
-        yyerror("Invalid function type passed into evalFuncNode!");
+    if (count < needed)
+    {
+        warning(interp, "Not enough operands passed into %s!", name);
+        return NAN_RET_VAL;
     }
 
-    // only reach here if default/error case was hit in switch
-    return NAN_RET_VAL;
-}
+    if (count > needed)
+    {
+        warning(interp, "%s called with extra (ignored) operands!!", name);
+    }
 
-SYMBOL_TABLE_NODE *findSymbolWithinScope(SYMBOL_TABLE_NODE *symbol, const char * id) {
-    if (symbol == NULL) {
-        return NULL;
+    bool folds = func == FOLD_RANGE_FUNC;
+    uint32_t fold = current;
+    if (folds)
+    {
+        current++;
     }
+    uint32_t body = current++;
 
-    while (symbol != NULL) {
-        if (strcmp(symbol->id, id) == 0) {
-            return symbol;
-        }
-        
-        symbol = symbol->next;
+    SYMBOL_TABLE_NODE *lamda = flatLoopLamda(tree, body);
+    SYMBOL_TABLE_NODE *op = folds ? flatLoopLamda(tree, fold) : NULL;
+
+    // bad and undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL || (folds && op == NULL))
+    {
+        return NAN_RET_VAL;
     }
-}
 
-STACK_NODE *findStackArgWithinLamda(SYMBOL_TABLE_NODE *symbol, const char * id) {
-    if (symbol == NULL) {
-        return NULL;
+    if (lamda->arg_list == NULL || lamda->arg_list->next != NULL)
+    {
+        warning(interp, "%s needs a lamda of one argument, %s isn't!", name, lamda->id);
+        return NAN_RET_VAL;
+    }
+
+    if (op != NULL && (op->arg_list == NULL || op->arg_list->next == NULL || op->arg_list->next->next != NULL))
+    {
+        warning(interp, "%s needs a lamda of two arguments, %s isn't!", name, op->id);
+        return NAN_RET_VAL;
+    }
+
+    RET_VAL acc = func == PROD_RANGE_FUNC ? INT_RET_VAL(1) : ZERO_RET_VAL;
+    if (func == FOLD_RANGE_FUNC)
+    {
+        acc = eval(interp, tree, current++);
+    }
+
+    RET_VAL lo = eval(interp, tree, current);
+    RET_VAL hi = eval(interp, tree, current + 1);
+
+    if (lo.type != INT_TYPE || hi.type != INT_TYPE)
+    {
+        warning(interp, "%s bounds must be integers!", name);
+        return NAN_RET_VAL;
     }
 
-    STACK_NODE* stack = symbol->stack;
-    SYMBOL_TABLE_NODE* arg = symbol->arg_list;
+    size_t link = findEvalFrame(interp, tree->nodes[body].depth);
+    size_t opLink = folds ? findEvalFrame(interp, tree->nodes[fold].depth) : 0;
+    size_t base = stack->valueLen;
+    int64_t counted = 0;
 
-    while (stack != NULL && arg != NULL) {
-        if (strcmp(arg->id, id) == 0) {
-            return stack;
+    for (int64_t i = lo.integer; i < hi.integer; i++)
+    {
+        pushEvalValue(interp, INT_RET_VAL(i));
+        RET_VAL result = applyLamda(interp, tree, lamda, base, link);
+
+        switch (func)
+        {
+        case SUM_RANGE_FUNC:
+            acc = numAdd(interp, acc, result);
+            break;
+        case PROD_RANGE_FUNC:
+            acc = numMult(interp, acc, result);
+            break;
+        case COUNT_RANGE_FUNC:
+            counted += numIsTrue(result);
+            break;
+        default:
+            pushEvalValue(interp, acc);
+            pushEvalValue(interp, result);
+            acc = applyLamda(interp, tree, op, base, opLink);
         }
-        
-        stack = stack->next;
-        arg = arg->next;
     }
 
-    return NULL;
+    return func == COUNT_RANGE_FUNC ? INT_RET_VAL(counted) : acc;
 }
 
-RET_VAL evalSymbolNode(AST_NODE *node)
+// The tree walker's evaluator of each builtin, indexed by FUNC_TYPE
+static const NODE_EVAL funcEvaluators[CUSTOM_FUNC + 1] = {
+    [NEG_FUNC] = evalNegFuncNode,
+    [ABS_FUNC] = evalAbsFuncNode,
+    [ADD_FUNC] = evalAddFuncNode,
+    [SUB_FUNC] = evalSubFuncNode,
+    [MULT_FUNC] = evalMultFuncNode,
+    [DIV_FUNC] = evalDivFuncNode,
+    [REM_FUNC] = evalRemainderFuncNode,
+    [EXP_FUNC] = evalExpFuncNode,
+    [EXP2_FUNC] = evalExp2FuncNode,
+    [POW_FUNC] = evalPowFuncNode,
+    [LOG_FUNC] = evalLogFuncNode,
+    [SQRT_FUNC] = evalSqrtFuncNode,
+    [CBRT_FUNC] = evalCbrtFuncNode,
+    [HYPOT_FUNC] = evalHypotFuncNode,
+    [MAX_FUNC] = evalMaxFuncNode,
+    [MIN_FUNC] = evalMinFuncNode,
+    [RAND_FUNC] = evalRandFuncNode,
+    [READ_FUNC] = evalReadFuncNode,
+    [MEMSTATS_FUNC] = evalMemStatsFuncNode,
+    [EQUAL_FUNC] = evalEqualFuncNode,
+    [LESS_FUNC] = evalLessFuncNode,
+    [GREATER_FUNC] = evalGreaterFuncNode,
+    [PRINT_FUNC] = evalPrintFuncNode,
+    [VECTOR_FUNC] = evalVectorFuncNode,
+    [RANGE_FUNC] = evalRangeFuncNode,
+    [SUM_FUNC] = evalSumFuncNode,
+    [DOT_FUNC] = evalDotFuncNode,
+    [LEN_FUNC] = evalLenFuncNode,
+    [SUM_RANGE_FUNC] = evalRangeLoopFuncNode,
+    [PROD_RANGE_FUNC] = evalRangeLoopFuncNode,
+    [COUNT_RANGE_FUNC] = evalRangeLoopFuncNode,
+    [FOLD_RANGE_FUNC] = evalRangeLoopFuncNode,
+    [CUSTOM_FUNC] = evalCustomFuncNode
+};
+
+NODE_EVAL funcEvaluator(FUNC_TYPE func)
 {
-    if (!node)
+    return func >= NEG_FUNC && func <= CUSTOM_FUNC ? funcEvaluators[func] : NULL;
+}
+
+RET_VAL evalFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    if (tree->nodes[node].kind != FUNC_NODE_TYPE)
     {
-        yyerror("NULL ast node passed into evalSymbolNode!");
+        yyerror("Incorrect ast node passed into evalFuncNode!");
         return NAN_RET_VAL;
     }
 
-    if (node->type != SYM_NODE_TYPE)
+    NODE_EVAL evaluator = funcEvaluator(tree->nodes[node].func);
+
+    if (evaluator == NULL)
     {
-        yyerror("Incorrect ast node passed into evalSymbolNode!");
+        yyerror("Invalid function type passed into evalFuncNode!");
         return NAN_RET_VAL;
     }
 
-    // Search through scopes to find the closest symbol defintion
-    const char * id = node->data.symbol.id;
+    return evaluator(interp, tree, node);
+}
 
-    while (node != NULL) { 
-        SYMBOL_TABLE_NODE* symbol = node->symbolTable;
-        while (symbol != NULL) {
-            if (symbol!= NULL && symbol->symbolType == LAMBDA_TYPE) {
-                STACK_NODE* stack = findStackArgWithinLamda(symbol, id);
-                return stack->value;
-            }
+// Returns a let value, evaluating it in the frame that owns it on first use
+RET_VAL evalLetSlot(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *symbol, size_t frame)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    size_t slot = stack->frames[frame].base + symbol->slot;
+    RET_VAL value = stack->values[slot];
 
-            if (strcmp(symbol->id, id) == 0) {
-                return evalSymbolTableNode(symbol);
-            }
-        
-            symbol = symbol->next;
-        
+    if (value.type == NO_TYPE)
+    {
+        if (value.integer != 0)
+        {
+            warning(interp, "Recursive definition of symbol: %s", symbol->id);
+            return NAN_RET_VAL;
         }
-        // Look further up the tree next iteration
-        node = node->parent;
-     }
 
-    warning("Undefined symbol: %s", id);
-    return NAN_RET_VAL;
+        stack->values[slot] = FORCING_SLOT;
+
+        size_t caller = stack->current;
+        stack->current = frame;
+        // a typed let is cast once, when forced
+        value = castRetVal(interp, eval(interp, tree, symbol->root), symbol->type);
+        stack->current = caller;
+
+        stack->values[slot] = value;
+    }
+
+    return value;
 }
 
-RET_VAL evalCondNode(AST_NODE *node)
-{   
-    if (!node)
+RET_VAL evalSymbolNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    if (tree->nodes[node].kind != SYM_NODE_TYPE)
     {
-        yyerror("NULL ast node passed into evalSymbolNode!");
+        yyerror("Incorrect ast node passed into evalSymbolNode!");
         return NAN_RET_VAL;
     }
 
-    if (node->type != COND_NODE_TYPE)
+    SYMBOL_TABLE_NODE *symbol = flatBinding(tree, node);
+
+    // undefined symbols were reported by resolveSymbols
+    if (symbol == NULL) {
+        return NAN_RET_VAL;
+    }
+
+    size_t frame = findEvalFrame(interp, tree->nodes[node].depth);
+
+    if (symbol->symbolType == ARG_TYPE) {
+        return interp->evalStack.values[interp->evalStack.frames[frame].base + symbol->slot];
+    }
+
+    return evalLetSlot(interp, tree, symbol, frame);
+}
+
+// --profile times every builtin (and lamda call) around evalFuncNode. Constant
+// folding calls evalFuncNode directly and is left out.
+RET_VAL profileFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    PROFILE_MARK mark;
+
+    profileEnter(&interp->profile, &interp->profile.funcs[tree->nodes[node].func], &mark);
+    RET_VAL result = evalFuncNode(interp, tree, node);
+    profileLeave(&interp->profile, &mark);
+
+    return result;
+}
+
+// --profile counts lookups per name and the lamda frames they hop, the time
+// of a let includes evaluating it on first use
+RET_VAL profileSymbolNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    // undefined symbols were reported by resolveSymbols
+    if (flatBinding(tree, node) == NULL)
+    {
+        return NAN_RET_VAL;
+    }
+
+    PROFILE_ENTRY *entry = profileEntry(&interp->profile.symbols, flatBinding(tree, node)->id);
+    uint64_t hops = tree->nodes[node].depth;
+    PROFILE_MARK mark;
+
+    entry->hops += hops;
+    if (hops > entry->maxHops)
+    {
+        entry->maxHops = hops;
+    }
+
+    profileEnter(&interp->profile, entry, &mark);
+    RET_VAL result = evalSymbolNode(interp, tree, node);
+    profileLeave(&interp->profile, &mark);
+
+    return result;
+}
+
+RET_VAL evalCondNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{   
+    if (tree->nodes[node].kind != COND_NODE_TYPE)
     {
         yyerror("Incorrect ast node passed into evalSymbolNode!");
         return NAN_RET_VAL;
     }
 
-    RET_VAL result = eval(node->data.cond.contiditonal);
+    // the condition, then the true and false branches
+    uint32_t child = tree->nodes[node].first;
+    RET_VAL result = eval(interp, tree, child);
 
-    if (result.value) {
-        return eval(node->data.cond.true_node);
+    if (numIsTrue(result)) {
+        return eval(interp, tree, child + 1);
     } 
 
-    return eval(node->data.cond.false_node);
+    return eval(interp, tree, child + 2);
 }
 
-RET_VAL eval(AST_NODE *node)
+RET_VAL evalScopeNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
 {
-    if (!node)
+    if (tree->nodes[node].kind != SCOPE_NODE_TYPE)
     {
-        yyerror("NULL ast node passed into eval!");
+        yyerror("Incorrect ast node passed into evalScopeNode!");
         return NAN_RET_VAL;
     }
 
-    switch (node->type)
+    return eval(interp, tree, tree->nodes[node].first);
+}
+
+// Runs a resolved and folded top level expression on the selected engine
+static RET_VAL runEngine(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info)
+{
+    if (interp->engine == TREE_WALK_ENGINE)
     {
-    case NUM_NODE_TYPE:
-        return evalNumNode(node);
-    case FUNC_NODE_TYPE:
-        return evalFuncNode(node);
-    case SYM_NODE_TYPE:
-        return evalSymbolNode(node);
-    case SCOPE_NODE_TYPE:
-        return eval(node->data.scope.child);
-    case COND_NODE_TYPE:
-        return evalCondNode(node);
-    default:
-        yyerror("Incorrect ast node passed into eval!");
+        FLAT_TREE *tree = flattenTree(interp, node);
+        specializeTree(interp, tree);
+        interp->evalStack.valueLen = 0;
+        interp->evalStack.frameLen = 0;
+        pushEvalFrame(interp, 0, 0, info->frameSize);
+
+        RET_VAL result = eval(interp, tree, 0);
+        freeMemoTables(interp);
+
+        return result;
     }
 
-    return NAN_RET_VAL;
+    BYTECODE *code = compileBytecode(interp, node, info);
+
+    if (interp->dumpBytecode)
+    {
+        // the dump goes straight to stdout, after this expression's warnings
+        flushOutput(&interp->out);
+        printBytecode(code);
+    }
+
+    RET_VAL result = runBytecode(interp, code);
+    freeBytecode(code);
+    freeMemoTables(interp);
+
+    return result;
 }
 
-// prints the type and value of a RET_VAL
-void printRetVal(RET_VAL val)
+// --jit=check: an expression that can run twice runs again with the JIT off,
+// its warnings muted but counted, and both results are compared
+static RET_VAL runJitChecked(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info)
 {
-    switch (val.type)
+    size_t warnings = interp->warningCount;
+    RET_VAL native = runEngine(interp, node, info);
+    size_t nativeWarnings = interp->warningCount - warnings;
+
+    bool jit = interp->jit.enabled;
+    bool dump = interp->dumpBytecode;
+    bool muted = interp->muteWarnings;
+    // the lamdas still point at the memo tables of the first run
+    size_t memoLimit = interp->memo.limit;
+    interp->jit.enabled = false;
+    interp->dumpBytecode = false;
+    interp->muteWarnings = true;
+    interp->memo.limit = 0;
+
+    RET_VAL interpreted = runEngine(interp, node, info);
+    size_t interpretedWarnings = interp->warningCount - warnings - nativeWarnings;
+
+    interp->jit.enabled = jit;
+    interp->dumpBytecode = dump;
+    interp->muteWarnings = muted;
+    interp->memo.limit = memoLimit;
+    interp->warningCount = warnings + nativeWarnings;
+
+    // a cached result skips the warnings it raised the first time
+    if (memoLimit > 0)
     {
-        case INT_TYPE:
-            printf("Integer : %.lf\n", val.value);
-            break;
-        case DOUBLE_TYPE:
-            printf("Double : %lf\n", val.value);
-            break;
-        default:
-            printf("No Type : %lf\n", val.value);
-            break;
+        interpretedWarnings = nativeWarnings;
     }
+
+    jitCheck(interp, native, interpreted, nativeWarnings, interpretedWarnings);
+
+    return native;
 }
 
-void freeSymbolTableNode(SYMBOL_TABLE_NODE* symbol) {
-    if (symbol == NULL) {
+// Evaluates a whole top level expression
+static RET_VAL runTopLevel(INTERP *interp, AST_NODE *node)
+{
+    RESOLVE_INFO info;
+    resolveSymbols(interp, node, &info);
+    foldConstants(interp, node);
+    inferTypes(interp, node, &info);
+
+    RET_VAL result;
+
+    if (interp->jit.check && !needsOrder(node))
+    {
+        result = runJitChecked(interp, node, &info);
+    }
+    else
+    {
+        result = runEngine(interp, node, &info);
+    }
+    resetJit(interp);
+
+    return result;
+}
+
+RET_VAL evalTopLevel(INTERP *interp, AST_NODE *node)
+{
+    if (!node)
+    {
+        yyerror("NULL ast node passed into evalTopLevel!");
+        return NAN_RET_VAL;
+    }
+
+    if (!interp->timing.enabled)
+    {
+        return runTopLevel(interp, node);
+    }
+
+    // everything since the last expression was finished is reading and parsing
+    uint64_t start = nowNs();
+    RET_VAL result = runTopLevel(interp, node);
+    uint64_t end = nowNs();
+
+    interp->timing.parseNs += start - interp->timing.mark;
+    interp->timing.evalNs += end - start;
+    interp->timing.exprs++;
+
+    return result;
+}
+
+// Evaluates a parsed top level expression and prints its result, with --jobs
+// queues it for the workers (see jobs.c) and with --emit-c translates it (see aot.c)
+void handleTopLevel(INTERP *interp, AST_NODE *node)
+{
+    if (interp->aot.enabled)
+    {
+        aotTopLevel(interp, node);
         return;
     }
 
-    freeStackNode(symbol->stack);
-    freeSymbolTableNode(symbol->arg_list);
+    if (interp->jobs == NULL)
+    {
+        printRetVal(interp, evalTopLevel(interp, node));
+        return;
+    }
+
+    if (interp->timing.enabled)
+    {
+        interp->timing.parseNs += nowNs() - interp->timing.mark;
+    }
+
+    queueJob(interp, node);
+}
 
-    SYMBOL_TABLE_NODE* prev;
+// One line of key=value pairs so bench/bench.sh can pick it apart
+static void printTimingStats(INTERP *interp)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
 
-    while (symbol != NULL) {
-        prev = symbol;
-        symbol = symbol->next;
-        free(symbol);
+    fprintf(stderr, "timing: exprs=%zu parse_ns=%llu eval_ns=%llu peak_rss_kb=%ld\n",
+        interp->timing.exprs, (unsigned long long) interp->timing.parseNs, (unsigned long long) interp->timing.evalNs, usage.ru_maxrss);
+}
+
+static void printParseArenaStats(INTERP *interp)
+{
+    printArenaStats(&interp->parseArena, "parse");
+    fprintf(stderr, "symbol pool: %zu interned symbols\n", internedSymbolCount(interp));
+}
+
+bool handleOption(INTERP *interp, char *option)
+{
+    if (strcmp(option, "--tree-walk") == 0)
+    {
+        interp->engine = TREE_WALK_ENGINE;
     }
+    else if (strcmp(option, "--dump-bytecode") == 0)
+    {
+        interp->dumpBytecode = true;
+    }
+    else if (strcmp(option, "--timing") == 0)
+    {
+        interp->timing.enabled = true;
+        interp->timing.mark = nowNs();
+    }
+    else if (strcmp(option, "--profile") == 0)
+    {
+        interp->profile.enabled = true;
+    }
+    else if (strcmp(option, "--no-fold") == 0)
+    {
+        interp->foldConstants = false;
+    }
+    else if (strcmp(option, "--arena-stats") == 0)
+    {
+        interp->arenaStats = true;
+    }
+    else if (strcmp(option, "--mem-stats") == 0)
+    {
+        interp->memStats = true;
+    }
+    else if (strncmp(option, "--memoize", 9) == 0 && (option[9] == '\0' || option[9] == '='))
+    {
+        interp->memo.limit = DEFAULT_MEMO_LIMIT;
+        if (option[9] == '=' && (interp->memo.limit = strtoul(option + 10, NULL, 10)) == 0)
+        {
+            return false;
+        }
+    }
+    else if (strcmp(option, "--jit") == 0 || strcmp(option, "--jit=check") == 0)
+    {
+        interp->jit.enabled = true;
+        interp->jit.check = option[5] == '=';
+    }
+    else if (strcmp(option, "--emit-c") == 0)
+    {
+        interp->aot.enabled = true;
+    }
+    else if (strncmp(option, "--fork", 6) == 0 && (option[6] == '\0' || option[6] == '='))
+    {
+        interp->forkThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if (option[6] == '=' && (interp->forkThreads = atoi(option + 7)) <= 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
 }
 
-void freeNode(AST_NODE *node)
+void printInterpStats(INTERP *interp)
 {
-    if (!node)
+    if (interp->timing.enabled)
     {
+        printTimingStats(interp);
+    }
+
+    if (interp->arenaStats)
+    {
+        printParseArenaStats(interp);
+    }
+
+    if (interp->memo.limit > 0)
+    {
+        printMemoStats(interp);
+    }
+
+    if (interp->jit.enabled)
+    {
+        printJitStats(interp);
+    }
+
+    if (interp->memStats)
+    {
+        printMemStats(stderr);
+    }
+
+    if (interp->fork != NULL)
+    {
+        printForkStats(interp);
+    }
+
+    if (interp->profile.enabled)
+    {
+        // the fork workers are idle by now, every task they ran has been joined
+        for (int i = 1; interp->fork != NULL && i < interp->fork->threads; i++)
+        {
+            mergeProfile(&interp->profile, &interp->fork->interps[i]->profile);
+        }
+        printProfile(&interp->profile);
+    }
+}
+
+// A fresh interpreter with the default options, reading from stdin
+INTERP *createInterp(void)
+{
+    INTERP *interp;
+
+    if ((interp = memCalloc(MEM_INTERP, 1, sizeof(INTERP))) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    interp->engine = BYTECODE_ENGINE;
+    interp->foldConstants = true;
+    interp->readTarget = stdin;
+    interp->out.stream = stdout;
+    interp->parseArena.category = MEM_AST;
+    interp->symbols.strings.category = MEM_STRINGS;
+
+    return interp;
+}
+
+// Releases everything the interpreter owns, except its scanner which belongs to the lexer
+void freeInterp(INTERP *interp)
+{
+    if (interp->fork != NULL && interp->forkIndex == 0)
+    {
+        stopForkPool(interp);
+    }
+
+    flushOutput(&interp->out);
+    freeOutput(&interp->out);
+    freeMemoTables(interp);
+    freeProfile(&interp->profile);
+    freeJit(interp);
+    freeArena(&interp->parseArena);
+    freeArena(&interp->symbols.strings);
+    memFree(interp->symbols.symbols);
+    memFree(interp->symbols.hashes);
+    memFree(interp->evalStack.values);
+    memFree(interp->evalStack.frames);
+    memFree(interp->vm.stack);
+    memFree(interp->vm.frames);
+
+    if (interp->readTarget != NULL && interp->readTarget != stdin)
+    {
+        fclose(interp->readTarget);
+    }
+
+    if (interp->logFile != NULL)
+    {
+        fclose(interp->logFile);
+    }
+
+    memFree(interp);
+}
+
+// Long vectors only show their first elements and the length
+#define MAX_PRINTED_ELEMENTS 16
+
+static void printVector(OUTPUT *out, const VECTOR *vector)
+{
+    size_t shown = vector->len > MAX_PRINTED_ELEMENTS ? MAX_PRINTED_ELEMENTS : vector->len;
+
+    outputText(out, "[", 1);
+    for (size_t i = 0; i < shown; i++)
+    {
+        if (i > 0)
+        {
+            outputText(out, ", ", 2);
+        }
+        outputDouble(out, vector->data[i]);
+    }
+
+    if (shown < vector->len)
+    {
+        outputText(out, ", ...] (", 8);
+        outputInt(out, (int64_t) vector->len);
+        outputText(out, " elements)", 10);
         return;
     }
+    outputText(out, "]", 1);
+}
+
+// prints the type and value of a RET_VAL to the interpreter's output
+void printRetVal(INTERP *interp, RET_VAL val)
+{
+    OUTPUT *out = &interp->out;
+
+    switch (val.type)
+    {
+        case INT_TYPE:
+            outputText(out, "Integer : ", 10);
+            outputInt(out, val.integer);
+            break;
+        case DOUBLE_TYPE:
+            outputText(out, "Double : ", 9);
+            outputDouble(out, val.value);
+            break;
+        case VECTOR_TYPE:
+            outputText(out, "Vector : ", 9);
+            printVector(out, val.vector);
+            break;
+        default:
+            outputText(out, "No Type : ", 10);
+            outputDouble(out, val.value);
+            break;
+    }
 
-    // Free specialized data for each type
-    switch (node->type)
-    {
-    // Function has special oplist data to free
-    case FUNC_NODE_TYPE:
-        freeNode(node->data.function.opList);
-        break;
-    
-    // Scope node has a child scope to free
-    case SCOPE_NODE_TYPE:
-        freeNode(node->data.scope.child);
-        break;
-    
-    // Symbol node has an idstring to free
-    case SYM_NODE_TYPE:
-        free(node->data.symbol.id);
-        break;
-
-    // Cond node has conditional and true/false branch nodes
-    case COND_NODE_TYPE:
-        freeNode(node->data.cond.false_node);
-        freeNode(node->data.cond.true_node);
-        freeNode(node->data.cond.contiditonal);
-        break;
-    
-    // Number node has stack allocated numbers which take care of themselves 
-    case NUM_NODE_TYPE:
-    default:
-        break;
-    }
-
-    // Free the possible symbol table
-    freeSymbolTableNode(node->symbolTable);
-
-    // Free siblings
-    if (node->next != NULL) {
-        freeNode(node->next);
-    }
-
-    // Free this node
-    free(node);
-}
\ No newline at end of file
+    outputText(out, "\n", 1);
+}
@@ -7,78 +7,176 @@
 #include <string.h>
 #include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "mem.h"
 
 
-#define NAN_RET_VAL (RET_VAL){DOUBLE_TYPE, NAN}
-#define ZERO_RET_VAL (RET_VAL){INT_TYPE, 0}
+#define INT_RET_VAL(i) (RET_VAL){INT_TYPE, .integer = (i)}
+#define DOUBLE_RET_VAL(d) (RET_VAL){DOUBLE_TYPE, .value = (d)}
+#define NAN_RET_VAL DOUBLE_RET_VAL(NAN)
+#define ZERO_RET_VAL INT_RET_VAL(0)
+#define VECTOR_RET_VAL(v) (RET_VAL){VECTOR_TYPE, .vector = (v)}
+
+// Let slots in a frame start out unforced and hold their value once evaluated.
+// Evaluated values are always INT_TYPE, DOUBLE_TYPE or VECTOR_TYPE so NO_TYPE is free to mark them.
+#define UNFORCED_SLOT (RET_VAL){NO_TYPE, .integer = 0}
+#define FORCING_SLOT (RET_VAL){NO_TYPE, .integer = 1}
 
 
 #define BISON_FLEX_LOG_PATH "bison_flex.log"
-// Use extern to work with Makefile building
-extern FILE* read_target;
-extern FILE* flex_bison_log_file;
+
+// Which evaluator runs top level expressions.
+// The tree walker is kept so results can be diffed against the bytecode VM.
+typedef enum {
+    BYTECODE_ENGINE,
+    TREE_WALK_ENGINE
+} EVAL_ENGINE;
+
+// All state of one interpreter, see interp.h
+typedef struct interp INTERP;
+
 size_t yyreadline(char **lineptr, size_t *n, FILE *stream, size_t n_terminate);
 
 
-int yyparse(void);
-int yylex(void);
-void yyerror(char *, ...);
-void warning(char*, ...);
+// FNV-1a, shared by the symbol pool and the generated keyword tables
+static inline uint32_t hashString(const char *text, size_t len, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= (unsigned char) text[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 
+int yyparse(INTERP *interp);
+void yyerror(char *, ...);
+void warning(INTERP *interp, char*, ...);
+
+
+// Builtin functions and their names in the language, in FUNC_TYPE order.
+// mkkeywords generates the perfect hash used by resolveFunc from this list,
+// so adding a builtin here is all the lexer needs.
+#define FUNC_LIST(X) \
+    X(NEG_FUNC, "neg") \
+    X(ABS_FUNC, "abs") \
+    X(ADD_FUNC, "add") \
+    X(SUB_FUNC, "sub") \
+    X(MULT_FUNC, "mult") \
+    X(DIV_FUNC, "div") \
+    X(REM_FUNC, "remainder") \
+    X(EXP_FUNC, "exp") \
+    X(EXP2_FUNC, "exp2") \
+    X(POW_FUNC, "pow") \
+    X(LOG_FUNC, "log") \
+    X(SQRT_FUNC, "sqrt") \
+    X(CBRT_FUNC, "cbrt") \
+    X(HYPOT_FUNC, "hypot") \
+    X(MAX_FUNC, "max") \
+    X(MIN_FUNC, "min") \
+    X(RAND_FUNC, "rand") \
+    X(READ_FUNC, "read") \
+    X(MEMSTATS_FUNC, "memstats") \
+    X(EQUAL_FUNC, "equal") \
+    X(LESS_FUNC, "less") \
+    X(GREATER_FUNC, "greater") \
+    X(PRINT_FUNC, "print") \
+    X(VECTOR_FUNC, "vector") \
+    X(RANGE_FUNC, "range") \
+    X(SUM_FUNC, "sum") \
+    X(DOT_FUNC, "dot") \
+    X(LEN_FUNC, "len") \
+    X(SUM_RANGE_FUNC, "sum_range") \
+    X(PROD_RANGE_FUNC, "prod_range") \
+    X(COUNT_RANGE_FUNC, "count_range") \
+    X(FOLD_RANGE_FUNC, "fold_range")
+
+#define TYPE_LIST(X) \
+    X(INT_TYPE, "int") \
+    X(DOUBLE_TYPE, "double")
+
+#define LIST_ENUM(value, name) value,
 
 typedef enum func_type {
-    NEG_FUNC,
-    ABS_FUNC,
-    ADD_FUNC,
-    SUB_FUNC,
-    MULT_FUNC,
-    DIV_FUNC,
-    REM_FUNC,
-    EXP_FUNC,
-    EXP2_FUNC,
-    POW_FUNC,
-    LOG_FUNC,
-    SQRT_FUNC,
-    CBRT_FUNC,
-    HYPOT_FUNC,
-    MAX_FUNC,
-    MIN_FUNC,
-    RAND_FUNC,
-    READ_FUNC,
-    EQUAL_FUNC,
-    LESS_FUNC,
-    GREATER_FUNC,
-    PRINT_FUNC,
+    FUNC_LIST(LIST_ENUM)
     CUSTOM_FUNC
 } FUNC_TYPE;
 
 
 FUNC_TYPE resolveFunc(char *);
-
-// helper to copy a string to a new dynamically allocated char array
-char * cloneString(char *);
-
+const char *nameOfFunc(FUNC_TYPE func);
+
+// Leading operands of a builtin that name a lamda instead of being evaluated,
+// f in (sum_range f lo hi) and op and f in (fold_range op f init lo hi)
+static inline int lamdaOperandCount(FUNC_TYPE func)
+{
+    switch (func)
+    {
+    case SUM_RANGE_FUNC:
+    case PROD_RANGE_FUNC:
+    case COUNT_RANGE_FUNC:
+        return 1;
+    case FOLD_RANGE_FUNC:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+// helper to copy a string into the parse arena
+char * cloneString(INTERP *interp, char *);
+
+// Returns the one shared copy of an identifier, so interned ids can be compared
+// by pointer. The pool lives as long as the interpreter.
+char *internSymbol(INTERP *interp, const char *text, size_t len);
+size_t internedSymbolCount(INTERP *interp);
+
+// VECTOR_TYPE is a value type only, symbols can't be declared with it
 typedef enum num_type {
-    INT_TYPE,
-    DOUBLE_TYPE,
+    TYPE_LIST(LIST_ENUM)
+    VECTOR_TYPE,
     NO_TYPE
 } NUM_TYPE;
 
 NUM_TYPE resolveType(char *);
 
+// The NUM_TYPEs a value can have, a bit each, see types.h
+typedef uint8_t TYPE_SET;
+#define TYPE_BIT(type) ((TYPE_SET) (1u << (type)))
+
 
 typedef struct {
     NUM_TYPE type;
-    double value;
+    // INT_TYPE numbers are exact 64 bit integers, see number.h
+    union {
+        double value;
+        int64_t integer;
+        // VECTOR_TYPE values, see vector.h
+        struct vector *vector;
+    };
 } AST_NUMBER;
 
 typedef AST_NUMBER RET_VAL;
 
 
 typedef struct ast_function {
-    char *id;
     FUNC_TYPE func;
+    // how many lamda frames up the called lamda was defined, filled in by resolveSymbols
+    int depth;
+    // call in tail position of a lamda body that can reuse the caller's frame
+    bool tail;
     struct ast_node *opList;
+    union {
+        // name of the lamda a CUSTOM_FUNC node calls, replaced by resolveSymbols
+        // with the lamda itself (NULL if undefined)
+        char *id;
+        struct symbol_table_node *binding;
+        // operands of add, mult, max or min (bit i for the i-th) that are pure
+        // lamda calls worth evaluating on other threads with --fork, see resolve.c
+        uint64_t forkable;
+    };
 } AST_FUNCTION;
 
 
@@ -91,11 +189,20 @@ typedef enum {
 } AST_NODE_TYPE;
 
 typedef struct {
-    char* id;
+    // the name, replaced by resolveSymbols with the let var or lamda arg
+    // referenced (NULL if undefined)
+    union {
+        char *id;
+        struct symbol_table_node *binding;
+    };
+    // how many lamda frames up it lives (its slot is binding->slot)
+    int depth;
 } AST_SYMBOL;
 
+// let section and the expression it applies to
 typedef struct {
     struct ast_node *child;
+    struct symbol_table_node *symbols;
 } AST_SCOPE;
 
 typedef struct {
@@ -106,8 +213,8 @@ typedef struct {
 
 typedef struct ast_node {
     AST_NODE_TYPE type;
-    struct ast_node *parent;
-    struct symbol_table_node *symbolTable;
+    // what the node can evaluate to, filled in by inferTypes
+    TYPE_SET types;
     union {
         AST_NUMBER number;
         AST_FUNCTION function;
@@ -118,6 +225,18 @@ typedef struct ast_node {
     struct ast_node *next;
 } AST_NODE;
 
+// Length of an operand list
+static inline size_t countOperands(AST_NODE *op)
+{
+    size_t count = 0;
+    while (op != NULL)
+    {
+        count++;
+        op = op->next;
+    }
+    return count;
+}
+
 typedef enum {
     VAR_TYPE,
     LAMBDA_TYPE,
@@ -129,39 +248,83 @@ typedef struct symbol_table_node {
     AST_NODE *value;
     SYMBOL_TYPE symbolType;
     NUM_TYPE type;
-    struct stack_node *stack;
     // if the symbol is a lamda we store args in a child symbol table
     struct symbol_table_node *arg_list;
     struct symbol_table_node *next;
+    // filled in by resolveSymbols:
+    // frame slot of a var or arg
+    int slot;
+    // thunk number of a var, function number of a lamda (the top level is 0)
+    int index;
+    // slots in a lamda's frame, args first
+    int frameSize;
+    // lamda nesting level of the frame a symbol lives in, 0 is the top level
+    int level;
+    // node of a let value or lamda body in the flattened expression, see flat.h
+    uint32_t root;
+    // filled in by inferTypes: what a let value or lamda body can evaluate
+    // to before its cast, or the values passed for an arg
+    TYPE_SET types;
+    // a lamda whose result only depends on its args (and top level lets)
+    bool pure;
+    // result cache of a pure lamda, see memo.h
+    struct memo_table *memo;
+    // native code of a lamda by arg types, see jit.h
+    struct jit_unit *jit;
 } SYMBOL_TABLE_NODE;
 
-typedef struct stack_node {
-    RET_VAL value;
-    struct stack_node *next;
-} STACK_NODE;
-
-STACK_NODE* createStackNode(RET_VAL val);
-
-AST_NODE *createNumberNode(double value, NUM_TYPE type);
-AST_NODE *createCondNode(AST_NODE *conditional, AST_NODE *true_node, AST_NODE *false_node);
-AST_NODE *createFunctionNode(FUNC_TYPE func, AST_NODE *opList, char* identifer);
-AST_NODE *createCoreFunctionNode(FUNC_TYPE func, AST_NODE *opList);
-AST_NODE *createLamdaFunctionNode(char* identifer, AST_NODE *opList);
+AST_NODE *createNumberNode(INTERP *interp, RET_VAL value);
+AST_NODE *createCondNode(INTERP *interp, AST_NODE *conditional, AST_NODE *true_node, AST_NODE *false_node);
+AST_NODE *createFunctionNode(INTERP *interp, FUNC_TYPE func, AST_NODE *opList, char* identifer);
+AST_NODE *createCoreFunctionNode(INTERP *interp, FUNC_TYPE func, AST_NODE *opList);
+AST_NODE *createLamdaFunctionNode(INTERP *interp, char* identifer, AST_NODE *opList);
 AST_NODE *addExpressionToList(AST_NODE *newExpr, AST_NODE *exprList);
-AST_NODE *createSymbolReferenceNode(char* id);
-AST_NODE *createScopeNode(SYMBOL_TABLE_NODE *symbol, AST_NODE *child);
-
-SYMBOL_TABLE_NODE *createTypecastSymbolVarNode(char* value, AST_NODE *s_expr, NUM_TYPE type);
-SYMBOL_TABLE_NODE *createSymbolVarNode(char* value, AST_NODE *s_expr);
-SYMBOL_TABLE_NODE *createTypecastSymbolLamdaNode(char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr, NUM_TYPE type);
-SYMBOL_TABLE_NODE *createSymbolLamdaNode(char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr);
-SYMBOL_TABLE_NODE *createSymbolArgNode(char* value);
+AST_NODE *createSymbolReferenceNode(INTERP *interp, char* id);
+AST_NODE *createScopeNode(INTERP *interp, SYMBOL_TABLE_NODE *symbol, AST_NODE *child);
+
+SYMBOL_TABLE_NODE *createTypecastSymbolVarNode(INTERP *interp, char* value, AST_NODE *s_expr, NUM_TYPE type);
+SYMBOL_TABLE_NODE *createSymbolVarNode(INTERP *interp, char* value, AST_NODE *s_expr);
+SYMBOL_TABLE_NODE *createTypecastSymbolLamdaNode(INTERP *interp, char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr, NUM_TYPE type);
+SYMBOL_TABLE_NODE *createSymbolLamdaNode(INTERP *interp, char* value, SYMBOL_TABLE_NODE *arg_list, AST_NODE *s_expr);
+SYMBOL_TABLE_NODE *createSymbolArgNode(INTERP *interp, char* value);
 SYMBOL_TABLE_NODE *addSymbolToList(SYMBOL_TABLE_NODE *newSymbol, SYMBOL_TABLE_NODE *symbolList);
 
-RET_VAL eval(AST_NODE *node);
-
-void printRetVal(RET_VAL val);
-
-void freeNode(AST_NODE *node);
+// The tree walker runs on expressions flattened into arrays, see flat.h
+typedef struct flat_tree FLAT_TREE;
+
+// Tree walker function evaluating one node
+typedef RET_VAL (*NODE_EVAL)(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+
+// the generic evaluators of each node type, checking everything they are given
+RET_VAL evalNumNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+RET_VAL evalFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+RET_VAL evalSymbolNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+RET_VAL evalScopeNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+RET_VAL evalCondNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+// a builtin's own eval*FuncNode, or evalCustomFuncNode for CUSTOM_FUNC
+NODE_EVAL funcEvaluator(FUNC_TYPE func);
+// --profile versions of evalFuncNode and evalSymbolNode that time the call
+RET_VAL profileFuncNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+RET_VAL profileSymbolNode(INTERP *interp, const FLAT_TREE *tree, uint32_t node);
+RET_VAL evalLetSlot(INTERP *interp, const FLAT_TREE *tree, SYMBOL_TABLE_NODE *symbol, size_t frame);
+RET_VAL evalTopLevel(INTERP *interp, AST_NODE *node);
+void handleTopLevel(INTERP *interp, AST_NODE *node);
+
+// helpers shared by the tree walker and the bytecode VM
+RET_VAL castRetVal(INTERP *interp, RET_VAL result, NUM_TYPE type);
+RET_VAL readRetVal(INTERP *interp);
+RET_VAL memStatsRetVal(INTERP *interp);
+SYMBOL_TABLE_NODE *rangeLoopLamda(AST_NODE *operand);
+
+// handles a "--flag" command line option, returns false if it is unknown
+bool handleOption(INTERP *interp, char *option);
+
+void printRetVal(INTERP *interp, RET_VAL val);
+
+// releases everything allocated for the last top level expression
+void resetParseArena(INTERP *interp);
+
+// the --timing, --arena-stats, --mem-stats and --memoize summaries, printed to stderr at exit
+void printInterpStats(INTERP *interp);
 
 #endif
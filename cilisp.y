@@ -1,11 +1,20 @@
 %{
     #include "cilisp.h"
+    #include "interp.h"
     #define ylog(r, p) { /*printf("BISON: %s ::= %s \n", #r, #p); */}
-    int yylex();
-    void yyerror(char*, ...);
+    // parses nested past the initial stack depth grow it on the heap
+    #define YYMALLOC(size) memAlloc(MEM_STACKS, size)
+    #define YYFREE memFree
 %}
 
+// Pure parser: semantic values live on yyparse's own stack and every action
+// works for the interpreter passed in
+%define api.pure full
+%parse-param {INTERP *interp}
+%lex-param {INTERP *interp}
+
 %union {
+    int64_t lval;
     double dval;
     int ival;
     char *sval;
@@ -14,31 +23,39 @@
 };
 
 %token <ival> FUNC TYPE
-%token <dval> INT DOUBLE
+%token <lval> INT
+%token <dval> DOUBLE
 %token <sval> SYMBOL
 %token QUIT EOL EOFT LPAREN RPAREN LET COND LAMBDA
 
 %type <astNode> s_expr f_expr s_expr_section s_expr_list number 
 %type <symbolNode> let_section let_list let_elem arg_list
 
+%{
+    int yylex(YYSTYPE *lvalp, INTERP *interp);
+    // syntax errors come with the parse param in front and still end the run
+    #define yyerror(interp, message) yyerror("%s", message)
+%}
+
 %%
 
 program:
     s_expr EOL {
         ylog(program, s_expr EOL);
         if ($1) {
-            printRetVal(eval($1));
-            freeNode($1);
+            handleTopLevel(interp, $1);
         }
+        resetParseArena(interp);
         YYACCEPT;
     }
     | s_expr EOFT {
         ylog(program, s_expr EOFT);
         if ($1) {
-            printRetVal(eval($1));
-            freeNode($1);
+            handleTopLevel(interp, $1);
         }
-        exit(EXIT_SUCCESS);
+        resetParseArena(interp);
+        interp->done = true;
+        YYACCEPT;
     }
     | EOL {
         ylog(program, EOL);
@@ -46,13 +63,14 @@ program:
     }
     | EOFT {
         ylog(program, EOFT);
-        exit(EXIT_SUCCESS);
+        interp->done = true;
+        YYACCEPT;
     };
 
 s_expr:
     LPAREN COND s_expr s_expr s_expr RPAREN  {
         ylog(s_expr, LPAREN COND s_expr s_expr s_expr RPAREN);
-        $$ = createCondNode($3, $4, $5); 
+        $$ = createCondNode(interp, $3, $4, $5); 
     } | f_expr {
         ylog(s_expr, f_expr);
         $$ = $1; 
@@ -61,32 +79,34 @@ s_expr:
         $$ = $1; 
     } | SYMBOL {
         ylog(s_expr, SYMBOL);
-        $$ = createSymbolReferenceNode($1);
+        $$ = createSymbolReferenceNode(interp, $1);
     } | LPAREN let_section s_expr RPAREN  {
         ylog(s_expr, LPAREN let_section s_expr RPAREN);
-        $$ = createScopeNode($2, $3); 
+        $$ = createScopeNode(interp, $2, $3); 
     } | QUIT {
         ylog(s_expr, QUIT);
-        exit(EXIT_SUCCESS);
+        // drops the rest of the expression along with the parse
+        interp->done = true;
+        YYABORT;
     } | error {
         ylog(s_expr, error);
-        yyerror("unexpected token");
+        yyerror(interp, "unexpected token");
         $$ = NULL;
     };
     
 f_expr:
     LPAREN FUNC s_expr_section RPAREN  { 
         ylog(f_expr, LPAREN FUNC s_expr_section RPAREN);
-        $$ = createCoreFunctionNode($2, $3); 
+        $$ = createCoreFunctionNode(interp, $2, $3); 
     } |  LPAREN SYMBOL s_expr_section RPAREN  { 
         ylog(f_expr, LPAREN FUNC s_expr_section RPAREN);
-        $$ = createLamdaFunctionNode($2, $3); 
+        $$ = createLamdaFunctionNode(interp, $2, $3); 
     };
 
 arg_list:
      SYMBOL arg_list {
         ylog(arg_list, SYMBOL arg_list);
-        $$ = addSymbolToList(createSymbolArgNode($1), $2);
+        $$ = addSymbolToList(createSymbolArgNode(interp, $1), $2);
     } | {
         ylog(arg_list, );
         $$ = NULL;
@@ -110,16 +130,16 @@ let_list:
 let_elem:
     LPAREN SYMBOL s_expr RPAREN  { 
         ylog(LPAREN, SYMBOL s_expr RPAREN);
-        $$ = createSymbolVarNode($2, $3);
+        $$ = createSymbolVarNode(interp, $2, $3);
     } | LPAREN TYPE SYMBOL s_expr RPAREN  { 
         ylog(LPAREN, SYMBOL s_expr RPAREN);
-        $$ = createTypecastSymbolVarNode($3, $4, $2);
+        $$ = createTypecastSymbolVarNode(interp, $3, $4, $2);
     } | LPAREN SYMBOL LAMBDA LPAREN arg_list RPAREN s_expr RPAREN {
         ylog(LPAREN, PAREN SYMBOL LAMBDA s_expr LPAREN arg_list RPAREN RPAREN);
-        $$ = createSymbolLamdaNode($2, $5, $7) ;
+        $$ = createSymbolLamdaNode(interp, $2, $5, $7) ;
     } | LPAREN TYPE SYMBOL LAMBDA LPAREN arg_list RPAREN s_expr RPAREN {
         ylog(LPAREN, PAREN TYPE SYMBOL LAMBDA s_expr LPAREN arg_list RPAREN RPAREN);
-        $$ = createTypecastSymbolLamdaNode($3, $6, $8, $2);
+        $$ = createTypecastSymbolLamdaNode(interp, $3, $6, $8, $2);
     };
 
 s_expr_section:
@@ -143,11 +163,11 @@ s_expr_list:
 number:
     INT {
         ylog(number, INT);
-        $$ = createNumberNode($1, INT_TYPE);
+        $$ = createNumberNode(interp, INT_RET_VAL($1));
     };
     | DOUBLE {
         ylog(number, DOUBLE);
-        $$ = createNumberNode($1, DOUBLE_TYPE);
+        $$ = createNumberNode(interp, DOUBLE_RET_VAL($1));
     };
 %%
 
@@ -0,0 +1,333 @@
+#include "closure.h"
+#include "flat.h"
+#include "interp.h"
+#include "number.h"
+#include "types.h"
+
+// The tree walker calls the evaluator of every node it visits. The generic
+// eval*Node functions a node starts out with check what they are given and
+// switch on the builtin; the closures here are picked once per node by
+// specializeTree for what it already knows (node kind, arity, where a symbol
+// lives, a constant operand), so they skip straight to the work.
+
+static RET_VAL evalConstClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    (void) interp;
+    return flatNumber(tree, node);
+}
+
+// undefined symbols were reported by resolveSymbols
+static RET_VAL evalUndefinedClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    (void) interp;
+    (void) tree;
+    (void) node;
+    return NAN_RET_VAL;
+}
+
+static inline RET_VAL localArg(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    return stack->values[stack->frames[stack->current].base + tree->nodes[node].slot];
+}
+
+// an arg of the lamda being run
+static RET_VAL evalLocalArgClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    return localArg(interp, tree, node);
+}
+
+// an arg of a lamda the running one was defined in
+static RET_VAL evalOuterArgClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    EVAL_STACK *stack = &interp->evalStack;
+    size_t frame = findEvalFrame(interp, tree->nodes[node].depth);
+    return stack->values[stack->frames[frame].base + tree->nodes[node].slot];
+}
+
+static RET_VAL evalLetClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    return evalLetSlot(interp, tree, flatBinding(tree, node), findEvalFrame(interp, tree->nodes[node].depth));
+}
+
+static RET_VAL evalScopeClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    return eval(interp, tree, tree->nodes[node].first);
+}
+
+static RET_VAL evalCondClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    uint32_t child = tree->nodes[node].first;
+    return eval(interp, tree, numIsTrue(eval(interp, tree, child)) ? child + 1 : child + 2);
+}
+
+// neg and abs ignore extra operands without a warning
+static RET_VAL evalNegClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    return numNeg(interp, eval(interp, tree, tree->nodes[node].first));
+}
+
+static RET_VAL evalAbsClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    return numAbs(interp, eval(interp, tree, tree->nodes[node].first));
+}
+
+// Comparisons of two operands, the same tests the eval*FuncNode loops make
+static inline RET_VAL equalValues(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return numEqual(right, left) ? INT_RET_VAL(1) : ZERO_RET_VAL;
+}
+
+static inline RET_VAL lessValues(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return numLessEqual(right, left) ? ZERO_RET_VAL : INT_RET_VAL(1);
+}
+
+static inline RET_VAL greaterValues(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return numLessEqual(left, right) ? ZERO_RET_VAL : INT_RET_VAL(1);
+}
+
+// A builtin called with exactly two operands, which none of them warns about:
+// any two operands, a constant right one, and an arg of the running lamda
+// with a constant, like (sub n 1) or (less n 2)
+#define BINARY_CLOSURES(name, apply) \
+    static RET_VAL eval##name##Closure(INTERP *interp, const FLAT_TREE *tree, uint32_t node) \
+    { \
+        uint32_t op = tree->nodes[node].first; \
+        RET_VAL left = eval(interp, tree, op); \
+        return apply(interp, left, eval(interp, tree, op + 1)); \
+    } \
+    static RET_VAL eval##name##ConstClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node) \
+    { \
+        uint32_t op = tree->nodes[node].first; \
+        return apply(interp, eval(interp, tree, op), flatNumber(tree, op + 1)); \
+    } \
+    static RET_VAL eval##name##ArgConstClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node) \
+    { \
+        uint32_t op = tree->nodes[node].first; \
+        return apply(interp, localArg(interp, tree, op), flatNumber(tree, op + 1)); \
+    }
+
+BINARY_CLOSURES(Add, numAdd)
+BINARY_CLOSURES(Sub, numSub)
+BINARY_CLOSURES(Mult, numMult)
+BINARY_CLOSURES(Div, numDiv)
+BINARY_CLOSURES(Rem, numRem)
+BINARY_CLOSURES(Pow, numPow)
+BINARY_CLOSURES(Max, numMax)
+BINARY_CLOSURES(Min, numMin)
+BINARY_CLOSURES(Equal, equalValues)
+BINARY_CLOSURES(Less, lessValues)
+BINARY_CLOSURES(Greater, greaterValues)
+
+// The comparisons again for two ints or two doubles, a NaN compares the way
+// numLessEqual has it
+static inline RET_VAL equalInts(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return INT_RET_VAL(left.integer == right.integer);
+}
+
+static inline RET_VAL lessInts(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return INT_RET_VAL(left.integer < right.integer);
+}
+
+static inline RET_VAL greaterInts(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return INT_RET_VAL(left.integer > right.integer);
+}
+
+static inline RET_VAL equalDoubles(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return INT_RET_VAL(left.value == right.value);
+}
+
+static inline RET_VAL lessDoubles(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return INT_RET_VAL(!(right.value <= left.value));
+}
+
+static inline RET_VAL greaterDoubles(INTERP *interp, RET_VAL left, RET_VAL right)
+{
+    (void) interp;
+    return INT_RET_VAL(!(left.value <= right.value));
+}
+
+BINARY_CLOSURES(AddInt, intAdd)
+BINARY_CLOSURES(SubInt, intSub)
+BINARY_CLOSURES(MultInt, intMult)
+BINARY_CLOSURES(DivInt, intDiv)
+BINARY_CLOSURES(EqualInt, equalInts)
+BINARY_CLOSURES(LessInt, lessInts)
+BINARY_CLOSURES(GreaterInt, greaterInts)
+BINARY_CLOSURES(AddDouble, doubleAdd)
+BINARY_CLOSURES(SubDouble, doubleSub)
+BINARY_CLOSURES(MultDouble, doubleMult)
+BINARY_CLOSURES(DivDouble, doubleDiv)
+BINARY_CLOSURES(EqualDouble, equalDoubles)
+BINARY_CLOSURES(LessDouble, lessDoubles)
+BINARY_CLOSURES(GreaterDouble, greaterDoubles)
+
+typedef struct {
+    NODE_EVAL any;
+    NODE_EVAL constRight;
+    NODE_EVAL argConst;
+} BINARY_CLOSURE;
+
+#define BINARY_CLOSURE_ENTRY(name) {eval##name##Closure, eval##name##ConstClosure, eval##name##ArgConstClosure}
+
+// Indexed by FUNC_TYPE, builtins without an entry are left to their eval*FuncNode
+static const BINARY_CLOSURE binaryClosures[CUSTOM_FUNC] = {
+    [ADD_FUNC] = BINARY_CLOSURE_ENTRY(Add),
+    [SUB_FUNC] = BINARY_CLOSURE_ENTRY(Sub),
+    [MULT_FUNC] = BINARY_CLOSURE_ENTRY(Mult),
+    [DIV_FUNC] = BINARY_CLOSURE_ENTRY(Div),
+    [REM_FUNC] = BINARY_CLOSURE_ENTRY(Rem),
+    [POW_FUNC] = BINARY_CLOSURE_ENTRY(Pow),
+    [MAX_FUNC] = BINARY_CLOSURE_ENTRY(Max),
+    [MIN_FUNC] = BINARY_CLOSURE_ENTRY(Min),
+    [EQUAL_FUNC] = BINARY_CLOSURE_ENTRY(Equal),
+    [LESS_FUNC] = BINARY_CLOSURE_ENTRY(Less),
+    [GREATER_FUNC] = BINARY_CLOSURE_ENTRY(Greater)
+};
+
+// The kernels for two operands inferTypes knows are both ints or both doubles
+static const BINARY_CLOSURE intClosures[CUSTOM_FUNC] = {
+    [ADD_FUNC] = BINARY_CLOSURE_ENTRY(AddInt),
+    [SUB_FUNC] = BINARY_CLOSURE_ENTRY(SubInt),
+    [MULT_FUNC] = BINARY_CLOSURE_ENTRY(MultInt),
+    [DIV_FUNC] = BINARY_CLOSURE_ENTRY(DivInt),
+    [EQUAL_FUNC] = BINARY_CLOSURE_ENTRY(EqualInt),
+    [LESS_FUNC] = BINARY_CLOSURE_ENTRY(LessInt),
+    [GREATER_FUNC] = BINARY_CLOSURE_ENTRY(GreaterInt)
+};
+
+static const BINARY_CLOSURE doubleClosures[CUSTOM_FUNC] = {
+    [ADD_FUNC] = BINARY_CLOSURE_ENTRY(AddDouble),
+    [SUB_FUNC] = BINARY_CLOSURE_ENTRY(SubDouble),
+    [MULT_FUNC] = BINARY_CLOSURE_ENTRY(MultDouble),
+    [DIV_FUNC] = BINARY_CLOSURE_ENTRY(DivDouble),
+    [EQUAL_FUNC] = BINARY_CLOSURE_ENTRY(EqualDouble),
+    [LESS_FUNC] = BINARY_CLOSURE_ENTRY(LessDouble),
+    [GREATER_FUNC] = BINARY_CLOSURE_ENTRY(GreaterDouble)
+};
+
+// The closures of a builtin with two operands, the typed ones when there are
+static const BINARY_CLOSURE *pickBinaryClosures(FUNC_TYPE func, NUM_TYPE type)
+{
+    if (type == INT_TYPE && intClosures[func].any != NULL)
+    {
+        return &intClosures[func];
+    }
+    if (type == DOUBLE_TYPE && doubleClosures[func].any != NULL)
+    {
+        return &doubleClosures[func];
+    }
+    return &binaryClosures[func];
+}
+
+static bool isLocalArg(const FLAT_TREE *tree, uint32_t node)
+{
+    return tree->nodes[node].kind == SYM_NODE_TYPE && flatBinding(tree, node) != NULL
+        && flatBinding(tree, node)->symbolType == ARG_TYPE && tree->nodes[node].depth == 0;
+}
+
+static NODE_EVAL symbolClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    SYMBOL_TABLE_NODE *symbol = flatBinding(tree, node);
+
+    if (interp->profile.enabled)
+    {
+        return profileSymbolNode;
+    }
+
+    if (symbol == NULL)
+    {
+        return evalUndefinedClosure;
+    }
+
+    switch (symbol->symbolType)
+    {
+    case ARG_TYPE:
+        return tree->nodes[node].depth == 0 ? evalLocalArgClosure : evalOuterArgClosure;
+    case VAR_TYPE:
+        return evalLetClosure;
+    default:
+        return evalSymbolNode;
+    }
+}
+
+static NODE_EVAL functionClosure(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    FUNC_TYPE func = tree->nodes[node].func;
+    uint32_t op = tree->nodes[node].first;
+    uint32_t count = tree->nodes[node].count;
+
+    if (interp->profile.enabled)
+    {
+        return profileFuncNode;
+    }
+
+    // the generic add, mult, max and min fork their operands
+    bool forks = interp->fork != NULL && func != CUSTOM_FUNC && tree->forkable[tree->nodes[node].value] != 0;
+
+    if (func < CUSTOM_FUNC && binaryClosures[func].any != NULL && !forks && count == 2)
+    {
+        const BINARY_CLOSURE *closures = pickBinaryClosures(func,
+            kernelType(tree->nodes[op].types, tree->nodes[op + 1].types));
+
+        if (tree->nodes[op + 1].kind != NUM_NODE_TYPE)
+        {
+            return closures->any;
+        }
+        return isLocalArg(tree, op) ? closures->argConst : closures->constRight;
+    }
+
+    if (count > 0 && func == NEG_FUNC)
+    {
+        return evalNegClosure;
+    }
+
+    if (count > 0 && func == ABS_FUNC)
+    {
+        return evalAbsClosure;
+    }
+
+    return funcEvaluator(func);
+}
+
+// What a node gets only depends on its own entry and its operands', so one
+// pass over the nodes does
+void specializeTree(INTERP *interp, FLAT_TREE *tree)
+{
+    for (uint32_t node = 0; node < tree->count; node++)
+    {
+        switch (tree->nodes[node].kind)
+        {
+        case NUM_NODE_TYPE:
+            setNodeEval(tree, node, evalConstClosure);
+            break;
+        case FUNC_NODE_TYPE:
+            setNodeEval(tree, node, functionClosure(interp, tree, node));
+            break;
+        case SYM_NODE_TYPE:
+            setNodeEval(tree, node, symbolClosure(interp, tree, node));
+            break;
+        case SCOPE_NODE_TYPE:
+            setNodeEval(tree, node, evalScopeClosure);
+            break;
+        case COND_NODE_TYPE:
+            setNodeEval(tree, node, evalCondClosure);
+            break;
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef __closure_h_
+#define __closure_h_
+
+#include "cilisp.h"
+
+// Points every node of a flattened expression, its let values and lamda
+// bodies included, at the tree walker function made for it
+void specializeTree(INTERP *interp, FLAT_TREE *tree);
+
+#endif
@@ -0,0 +1,294 @@
+#include "flat.h"
+#include "interp.h"
+
+#define MIN_REF_TABLE_SIZE 16
+
+// Nodes are laid out one level at a time: a node's entry is filled in where
+// its parent reserved it, then a block for all its operands is reserved at the
+// end and each of them is laid out in turn. Let values and lamda bodies are
+// queued as their let sections are met and laid out after the expression.
+typedef struct {
+    FLAT_TREE *tree;
+    // first node not reserved yet
+    uint32_t next;
+    SYMBOL_TABLE_NODE **queue;
+    uint32_t queued;
+    // refs being collected, found again through an open addressing table of
+    // their index + 1 (0 is a free entry)
+    FLAT_REF *refs;
+    uint32_t refCount;
+    uint32_t *refTable;
+    uint32_t refMask;
+    uint32_t forkCount;
+} FLATTENER;
+
+typedef struct {
+    uint32_t nodes;
+    uint32_t symbols;
+    // symbol and lamda call nodes, the most refs there can be
+    uint32_t refs;
+    // builtin calls with forkable operands
+    uint32_t forks;
+} FLAT_COUNTS;
+
+static void countNodes(AST_NODE *node, FLAT_COUNTS *counts)
+{
+    counts->nodes++;
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        if (node->data.function.func == CUSTOM_FUNC)
+        {
+            counts->refs++;
+        }
+        else if (node->data.function.forkable != 0)
+        {
+            counts->forks++;
+        }
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            countNodes(op, counts);
+        }
+        break;
+    case SYM_NODE_TYPE:
+        counts->refs++;
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (symbol->value != NULL)
+            {
+                counts->symbols++;
+                countNodes(symbol->value, counts);
+            }
+        }
+        countNodes(node->data.scope.child, counts);
+        break;
+    case COND_NODE_TYPE:
+        countNodes(node->data.cond.contiditonal, counts);
+        countNodes(node->data.cond.true_node, counts);
+        countNodes(node->data.cond.false_node, counts);
+        break;
+    default:
+        break;
+    }
+}
+
+static FLAT_TREE *allocFlatTree(ARENA *arena, uint32_t nodes)
+{
+    FLAT_TREE *tree = allocFromArena(arena, sizeof(FLAT_TREE) + nodes * sizeof(FLAT_NODE));
+
+    tree->count = nodes;
+
+    return tree;
+}
+
+void setNodeEval(FLAT_TREE *tree, uint32_t node, NODE_EVAL f)
+{
+    uint32_t i = 0;
+
+    while (i < tree->evalCount && tree->evals[i] != f)
+    {
+        i++;
+    }
+
+    if (i == tree->evalCount)
+    {
+        if (i == MAX_FLAT_EVALS)
+        {
+            yyerror("Too many node evaluators in one expression!");
+            exit(1);
+        }
+        tree->evals[tree->evalCount++] = f;
+    }
+
+    tree->nodes[node].eval = (uint8_t) i;
+}
+
+// Index of the ref to binding from depth frames up, added if it is new
+static uint32_t findRef(FLATTENER *flat, SYMBOL_TABLE_NODE *binding, uint32_t depth)
+{
+    uint32_t hash = (uint32_t) (((uintptr_t) binding >> 4) * 2654435761u) ^ depth;
+
+    for (uint32_t i = hash & flat->refMask;; i = (i + 1) & flat->refMask)
+    {
+        uint32_t entry = flat->refTable[i];
+
+        if (entry == 0)
+        {
+            flat->refs[flat->refCount] = (FLAT_REF){binding, depth};
+            flat->refTable[i] = ++flat->refCount;
+            return flat->refCount - 1;
+        }
+
+        FLAT_REF *ref = &flat->refs[entry - 1];
+        if (ref->binding == binding && ref->depth == depth)
+        {
+            return entry - 1;
+        }
+    }
+}
+
+// Reserves the block of count operands of node at, returns the first
+static uint32_t reserveOperands(FLATTENER *flat, uint32_t at, uint32_t count)
+{
+    uint32_t first = flat->next;
+
+    flat->next += count;
+    flat->tree->nodes[at].first = first;
+    flat->tree->nodes[at].count = count;
+
+    return first;
+}
+
+static void layoutNode(FLATTENER *flat, AST_NODE *node, uint32_t at)
+{
+    FLAT_TREE *tree = flat->tree;
+    FLAT_NODE *entry = &tree->nodes[at];
+    uint32_t child;
+
+    entry->kind = node->type;
+    entry->types = node->types;
+
+    switch (node->type)
+    {
+    case NUM_NODE_TYPE:
+        setNodeEval(tree, at, evalNumNode);
+        entry->value = node->data.number.type;
+        entry->bits = node->data.number.integer;
+        break;
+    case FUNC_NODE_TYPE:
+        setNodeEval(tree, at, evalFuncNode);
+        entry->func = node->data.function.func;
+        entry->tail = node->data.function.tail;
+
+        if (node->data.function.func == CUSTOM_FUNC)
+        {
+            entry->value = findRef(flat, node->data.function.binding, node->data.function.depth);
+        }
+        else if (node->data.function.forkable != 0)
+        {
+            entry->value = ++flat->forkCount;
+            tree->forkable[entry->value] = node->data.function.forkable;
+        }
+
+        child = reserveOperands(flat, at, countOperands(node->data.function.opList));
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            layoutNode(flat, op, child++);
+        }
+        break;
+    case SYM_NODE_TYPE:
+        setNodeEval(tree, at, evalSymbolNode);
+        entry->value = findRef(flat, node->data.symbol.binding, node->data.symbol.depth);
+        entry->depth = node->data.symbol.depth;
+        entry->slot = node->data.symbol.binding != NULL ? node->data.symbol.binding->slot : 0;
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (symbol->value != NULL)
+            {
+                flat->queue[flat->queued++] = symbol;
+            }
+        }
+
+        setNodeEval(tree, at, evalScopeNode);
+        child = reserveOperands(flat, at, 1);
+        layoutNode(flat, node->data.scope.child, child);
+        break;
+    case COND_NODE_TYPE:
+        setNodeEval(tree, at, evalCondNode);
+        child = reserveOperands(flat, at, 3);
+        layoutNode(flat, node->data.cond.contiditonal, child);
+        layoutNode(flat, node->data.cond.true_node, child + 1);
+        layoutNode(flat, node->data.cond.false_node, child + 2);
+        break;
+    }
+}
+
+FLAT_TREE *flattenTree(INTERP *interp, AST_NODE *node)
+{
+    FLAT_COUNTS counts = {0};
+    uint32_t tableSize = MIN_REF_TABLE_SIZE;
+
+    countNodes(node, &counts);
+
+    while (tableSize < counts.refs * 2)
+    {
+        tableSize *= 2;
+    }
+
+    FLATTENER flat = {
+        .tree = allocFlatTree(&interp->parseArena, counts.nodes),
+        .next = 1,
+        .queue = allocFromArena(&interp->parseArena, counts.symbols * sizeof(SYMBOL_TABLE_NODE *)),
+        .refs = memAlloc(MEM_AST, (counts.refs + 1) * sizeof(FLAT_REF)),
+        .refTable = memCalloc(MEM_AST, tableSize, sizeof(uint32_t)),
+        .refMask = tableSize - 1
+    };
+
+    if (flat.refs == NULL || flat.refTable == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    flat.tree->forkable = allocFromArena(&interp->parseArena, (counts.forks + 1) * sizeof(uint64_t));
+
+    layoutNode(&flat, node, 0);
+
+    // laying out a lamda body can queue the lets and lamdas declared in it
+    for (uint32_t i = 0; i < flat.queued; i++)
+    {
+        SYMBOL_TABLE_NODE *symbol = flat.queue[i];
+
+        symbol->root = flat.next++;
+        layoutNode(&flat, symbol->value, symbol->root);
+    }
+
+    // only the distinct refs are kept
+    flat.tree->refs = allocFromArena(&interp->parseArena, flat.refCount * sizeof(FLAT_REF));
+    memcpy(flat.tree->refs, flat.refs, flat.refCount * sizeof(FLAT_REF));
+    memFree(flat.refs);
+    memFree(flat.refTable);
+
+    return flat.tree;
+}
+
+RET_VAL evalConstantCall(INTERP *interp, AST_NODE *node)
+{
+    AST_NODE *op = node->data.function.opList;
+    uint32_t count = countOperands(op);
+    uint64_t noForks = 0;
+    // short lived, it stays out of the parse arena
+    FLAT_TREE *tree = memCalloc(MEM_AST, 1, sizeof(FLAT_TREE) + (count + 1) * sizeof(FLAT_NODE));
+
+    if (tree == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    tree->count = count + 1;
+    tree->forkable = &noForks;
+    tree->nodes[0].kind = FUNC_NODE_TYPE;
+    tree->nodes[0].func = node->data.function.func;
+    tree->nodes[0].first = 1;
+    tree->nodes[0].count = count;
+    setNodeEval(tree, 0, evalFuncNode);
+
+    for (uint32_t i = 1; i <= count; i++, op = op->next)
+    {
+        tree->nodes[i].kind = NUM_NODE_TYPE;
+        tree->nodes[i].value = op->data.number.type;
+        tree->nodes[i].bits = op->data.number.integer;
+        setNodeEval(tree, i, evalNumNode);
+    }
+
+    RET_VAL result = evalFuncNode(interp, tree, 0);
+    memFree(tree);
+
+    return result;
+}
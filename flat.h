@@ -0,0 +1,87 @@
+#ifndef __flat_h_
+#define __flat_h_
+
+#include "cilisp.h"
+
+// evaluators one flattened expression can use, FLAT_NODE eval is a byte
+#define MAX_FLAT_EVALS 256
+
+// A node of a flattened expression, 16 bytes so four share a cache line
+typedef struct {
+    // index of its evaluator in the tree's evals
+    uint8_t eval;
+    // AST_NODE_TYPE
+    uint8_t kind;
+    // FUNC_TYPE of a call
+    uint8_t func;
+    // lamda call in tail position of a lamda body, see resolve.c
+    uint8_t tail : 1;
+    // TYPE_SET inferTypes found for it
+    uint8_t types : 3;
+    // NUM_TYPE of a number, refs index of a symbol or lamda call, forkable
+    // index of a builtin call
+    uint32_t value;
+    union {
+        // operands of a call, the condition and branches of a cond, the child of a scope
+        struct {
+            uint32_t first;
+            uint32_t count;
+        };
+        // how many lamda frames up a symbol lives and its slot in that frame
+        struct {
+            uint32_t depth;
+            uint32_t slot;
+        };
+        // the number itself, held like the union of a RET_VAL (vectors too)
+        int64_t bits;
+    };
+} FLAT_NODE;
+
+// Symbol referenced or lamda called (NULL if undefined) and how many lamda
+// frames up it was defined, shared by the nodes naming it from the same depth
+typedef struct {
+    SYMBOL_TABLE_NODE *binding;
+    uint32_t depth;
+} FLAT_REF;
+
+// A resolved and folded expression laid out for the tree walker in one array.
+// The operands of a call, the condition and branches of a cond and the child
+// of a scope are the count nodes from first on, so they sit next to each
+// other, right after the nodes of the level above. The expression itself is
+// node 0, its let values and lamda bodies come after it (see SYMBOL_TABLE_NODE
+// root).
+struct flat_tree {
+    uint32_t count;
+    uint32_t evalCount;
+    // the generic eval*Node of each kind until specializeTree picks closures
+    NODE_EVAL evals[MAX_FLAT_EVALS];
+    FLAT_REF *refs;
+    // operands of a variadic builtin worth forking, see AST_FUNCTION, entry 0 has none
+    uint64_t *forkable;
+    FLAT_NODE nodes[];
+};
+
+// Lays the expression out in the parse arena, its AST stays as it is
+FLAT_TREE *flattenTree(INTERP *interp, AST_NODE *node);
+// Makes a node evaluate with f, adding f to the tree's evaluators if it is new
+void setNodeEval(FLAT_TREE *tree, uint32_t node, NODE_EVAL f);
+// Evaluates a builtin call whose operands are all numbers, for constant folding
+RET_VAL evalConstantCall(INTERP *interp, AST_NODE *node);
+
+// Two loads and an indirect call, every node knows how it is evaluated
+static inline RET_VAL eval(INTERP *interp, const FLAT_TREE *tree, uint32_t node)
+{
+    return tree->evals[tree->nodes[node].eval](interp, tree, node);
+}
+
+static inline RET_VAL flatNumber(const FLAT_TREE *tree, uint32_t node)
+{
+    return (RET_VAL){(NUM_TYPE) tree->nodes[node].value, .integer = tree->nodes[node].bits};
+}
+
+static inline SYMBOL_TABLE_NODE *flatBinding(const FLAT_TREE *tree, uint32_t node)
+{
+    return tree->refs[tree->nodes[node].value].binding;
+}
+
+#endif
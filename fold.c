@@ -0,0 +1,111 @@
+#include "fold.h"
+#include "interp.h"
+#include "flat.h"
+#include "number.h"
+
+static bool isFoldableFunc(FUNC_TYPE func)
+{
+    return func != RAND_FUNC && func != READ_FUNC && func != MEMSTATS_FUNC && func != PRINT_FUNC && func != CUSTOM_FUNC;
+}
+
+// Evaluates a builtin whose operands are all numbers with the tree walker's own
+// eval*FuncNode, so the result is typed exactly as at run time. Calls that would
+// warn are left alone so the warning still shows up each time they are reached.
+static void foldFunction(INTERP *interp, AST_NODE *node)
+{
+    if (!isFoldableFunc(node->data.function.func))
+    {
+        return;
+    }
+
+    for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+    {
+        if (op->type != NUM_NODE_TYPE)
+        {
+            return;
+        }
+    }
+
+    size_t warnings = interp->warningCount;
+    interp->muteWarnings = true;
+    RET_VAL result = evalConstantCall(interp, node);
+    interp->muteWarnings = false;
+
+    if (interp->warningCount != warnings)
+    {
+        interp->warningCount = warnings;
+        return;
+    }
+
+    // --emit-c would have to spell out every element in the C program
+    if (result.type == VECTOR_TYPE && interp->aot.enabled)
+    {
+        return;
+    }
+
+    node->type = NUM_NODE_TYPE;
+    node->data.number = result;
+}
+
+// Replaces a cond with a constant condition by the branch it takes, as a
+// scope without a let section so the node keeps its place in the tree
+static void foldCond(AST_NODE *node)
+{
+    AST_NODE *conditional = node->data.cond.contiditonal;
+
+    if (conditional->type != NUM_NODE_TYPE)
+    {
+        return;
+    }
+
+    AST_NODE *taken = numIsTrue(conditional->data.number) ? node->data.cond.true_node : node->data.cond.false_node;
+
+    if (taken->type == NUM_NODE_TYPE)
+    {
+        node->type = NUM_NODE_TYPE;
+        node->data.number = taken->data.number;
+        return;
+    }
+
+    node->type = SCOPE_NODE_TYPE;
+    node->data.scope.child = taken;
+    // shares its place with the true branch
+    node->data.scope.symbols = NULL;
+}
+
+// Folds constant builtin calls and conds bottom up, in let values and lamda
+// bodies too. Runs after resolveSymbols so undefined names in branches that
+// get folded away are still reported.
+void foldConstants(INTERP *interp, AST_NODE *node)
+{
+    if (node == NULL || !interp->foldConstants)
+    {
+        return;
+    }
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            foldConstants(interp, op);
+        }
+        foldFunction(interp, node);
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            foldConstants(interp, symbol->value);
+        }
+        foldConstants(interp, node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        foldConstants(interp, node->data.cond.contiditonal);
+        foldConstants(interp, node->data.cond.true_node);
+        foldConstants(interp, node->data.cond.false_node);
+        foldCond(node);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,8 @@
+#ifndef __fold_h_
+#define __fold_h_
+
+#include "cilisp.h"
+
+void foldConstants(INTERP *interp, AST_NODE *node);
+
+#endif
@@ -0,0 +1,260 @@
+#include <sched.h>
+#include "fork.h"
+#include "interp.h"
+
+#define INITIAL_DEQUE_SIZE 64
+
+static void pushDeque(FORK_DEQUE *deque, FORK_TASK *task)
+{
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom == deque->cap)
+    {
+        // slide what is left down before growing
+        size_t len = deque->bottom - deque->top;
+        // tasks is still NULL before the first grow
+        if (len > 0)
+        {
+            memmove(deque->tasks, deque->tasks + deque->top, len * sizeof(FORK_TASK *));
+        }
+        deque->top = 0;
+        deque->bottom = len;
+
+        if (len == deque->cap)
+        {
+            deque->cap = deque->cap ? deque->cap * 2 : INITIAL_DEQUE_SIZE;
+            if ((deque->tasks = memRealloc(MEM_THREADS, deque->tasks, deque->cap * sizeof(FORK_TASK *))) == NULL)
+            {
+                yyerror("Memory allocation failed!");
+                exit(1);
+            }
+        }
+    }
+
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static FORK_TASK *stealFromDeque(FORK_DEQUE *deque)
+{
+    FORK_TASK *task = NULL;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom)
+    {
+        task = deque->tasks[deque->top++];
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    return task;
+}
+
+// Steals from the other threads' deques, starting with the next one along
+static FORK_TASK *stealForkTask(FORK_POOL *pool, int self)
+{
+    if (atomic_load(&pool->pending) == 0)
+    {
+        return NULL;
+    }
+
+    for (int i = 1; i < pool->threads; i++)
+    {
+        FORK_TASK *task = stealFromDeque(&pool->deques[(self + i) % pool->threads]);
+        if (task != NULL)
+        {
+            atomic_fetch_sub(&pool->pending, 1);
+            atomic_fetch_add(&pool->steals, 1);
+            return task;
+        }
+    }
+
+    return NULL;
+}
+
+static void runForkTask(INTERP *interp, FORK_TASK *task)
+{
+    evalForkTask(interp, task);
+    atomic_store_explicit(&task->done, true, memory_order_release);
+}
+
+static void *runForkWorker(void *arg)
+{
+    INTERP *interp = arg;
+    FORK_POOL *pool = interp->fork;
+
+    for (;;)
+    {
+        FORK_TASK *task = stealForkTask(pool, interp->forkIndex);
+        if (task != NULL)
+        {
+            runForkTask(interp, task);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        atomic_fetch_add(&pool->idle, 1);
+        while (!pool->stop && atomic_load(&pool->pending) == 0)
+        {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        atomic_fetch_sub(&pool->idle, 1);
+        bool stop = pool->stop;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (stop)
+        {
+            return NULL;
+        }
+    }
+}
+
+// Starts threads - 1 workers next to the interpreter's own thread
+void startForkPool(INTERP *interp, int threads)
+{
+    FORK_POOL *pool;
+
+    if ((pool = memCalloc(MEM_THREADS, 1, sizeof(FORK_POOL))) == NULL
+        || (pool->deques = memCalloc(MEM_THREADS, threads, sizeof(FORK_DEQUE))) == NULL
+        || (pool->interps = memCalloc(MEM_THREADS, threads, sizeof(INTERP *))) == NULL
+        || (pool->workers = memCalloc(MEM_THREADS, threads, sizeof(pthread_t))) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    interp->fork = pool;
+    interp->forkIndex = 0;
+    pool->interps[0] = interp;
+
+    for (int i = 1; i < threads; i++)
+    {
+        INTERP *worker = createInterp();
+
+        worker->engine = interp->engine;
+        worker->profile.enabled = interp->profile.enabled;
+        worker->out.stream = NULL;
+        worker->fork = pool;
+        worker->forkIndex = i;
+        pool->interps[i] = worker;
+
+        if (pthread_create(&pool->workers[i], NULL, runForkWorker, worker) != 0)
+        {
+            yyerror("Could not start fork worker %d", i);
+        }
+    }
+}
+
+void stopForkPool(INTERP *interp)
+{
+    FORK_POOL *pool = interp->fork;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 1; i < pool->threads; i++)
+    {
+        pthread_join(pool->workers[i], NULL);
+        freeInterp(pool->interps[i]);
+    }
+
+    for (int i = 0; i < pool->threads; i++)
+    {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        memFree(pool->deques[i].tasks);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    memFree(pool->deques);
+    memFree(pool->interps);
+    memFree(pool->workers);
+    memFree(pool);
+    interp->fork = NULL;
+}
+
+bool forkWorkersIdle(INTERP *interp)
+{
+    FORK_POOL *pool = interp->fork;
+
+    // more sleepers than tasks already waiting for them
+    return atomic_load_explicit(&pool->idle, memory_order_relaxed)
+        > (int) atomic_load_explicit(&pool->pending, memory_order_relaxed);
+}
+
+void pushForkTask(INTERP *interp, FORK_TASK *task)
+{
+    FORK_POOL *pool = interp->fork;
+
+    // counted before it can be stolen, so pending never drops below zero
+    atomic_fetch_add(&pool->pending, 1);
+    atomic_fetch_add(&pool->tasks, 1);
+    pushDeque(&pool->deques[interp->forkIndex], task);
+
+    if (atomic_load(&pool->idle) > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_signal(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+bool popForkTask(INTERP *interp, FORK_TASK *task)
+{
+    FORK_POOL *pool = interp->fork;
+    FORK_DEQUE *deque = &pool->deques[interp->forkIndex];
+    bool popped = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top < deque->bottom && deque->tasks[deque->bottom - 1] == task)
+    {
+        deque->bottom--;
+        popped = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+
+    if (popped)
+    {
+        atomic_fetch_sub(&pool->pending, 1);
+    }
+
+    return popped;
+}
+
+void joinForkTask(INTERP *interp, FORK_TASK *task)
+{
+    FORK_POOL *pool = interp->fork;
+
+    while (!atomic_load_explicit(&task->done, memory_order_acquire))
+    {
+        FORK_TASK *other = stealForkTask(pool, interp->forkIndex);
+
+        if (other != NULL)
+        {
+            runForkTask(interp, other);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+void printForkStats(INTERP *interp)
+{
+    FORK_POOL *pool = interp->fork;
+
+    fprintf(stderr, "fork: %d threads, %zu forks, %zu tasks, %zu steals, %zu redone in order\n",
+        pool->threads, atomic_load(&pool->forks), atomic_load(&pool->tasks),
+        atomic_load(&pool->steals), atomic_load(&pool->redone));
+}
@@ -0,0 +1,73 @@
+#ifndef __fork_h_
+#define __fork_h_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "cilisp.h"
+
+// The lamda frames an operand can see (the current frame and its links out to
+// the top level), copied when it is forked. Outermost frame first, bases and
+// links are relative to these arrays.
+typedef struct fork_scope {
+    RET_VAL *values;
+    size_t valueLen;
+    struct eval_frame *frames;
+    size_t frameLen;
+} FORK_SCOPE;
+
+// One operand of a variadic builtin evaluated apart from its siblings
+typedef struct {
+    const FLAT_TREE *tree;
+    uint32_t node;
+    const FORK_SCOPE *scope;
+    RET_VAL result;
+    // warnings it raised with warnings muted, the whole call is redone in order if any
+    size_t warnings;
+    atomic_bool done;
+} FORK_TASK;
+
+// Work stealing deque: its owner pushes and pops at the bottom, other threads
+// steal the oldest task from the top
+typedef struct {
+    pthread_mutex_t lock;
+    FORK_TASK **tasks;
+    size_t cap;
+    size_t top;
+    size_t bottom;
+} FORK_DEQUE;
+
+// --fork[=N]: N threads, the interpreter's own being number 0, each with a
+// deque and an INTERP to evaluate stolen operands on
+typedef struct fork_pool {
+    int threads;
+    FORK_DEQUE *deques;
+    INTERP **interps;
+    pthread_t *workers;
+    // sleeping workers wait here for a push
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_int idle;
+    atomic_size_t pending;
+    bool stop;
+    // counters since startup
+    atomic_size_t forks;
+    atomic_size_t tasks;
+    atomic_size_t steals;
+    atomic_size_t redone;
+} FORK_POOL;
+
+void startForkPool(INTERP *interp, int threads);
+void stopForkPool(INTERP *interp);
+// A fork is only worth it while some thread has nothing to do
+bool forkWorkersIdle(INTERP *interp);
+void pushForkTask(INTERP *interp, FORK_TASK *task);
+// Takes task back off the bottom of this thread's deque, false if it was stolen
+bool popForkTask(INTERP *interp, FORK_TASK *task);
+// Waits for a stolen task, running other threads' tasks meanwhile
+void joinForkTask(INTERP *interp, FORK_TASK *task);
+void printForkStats(INTERP *interp);
+
+// Evaluates a forked operand on interp, in cilisp.c with the rest of the tree walker
+void evalForkTask(INTERP *interp, FORK_TASK *task);
+
+#endif
@@ -0,0 +1,77 @@
+#include "cilisp.h"
+#include "interp.h"
+
+#define INITIAL_POOL_SIZE 1024
+
+static void growSymbolPool(SYMBOL_POOL *pool)
+{
+    size_t cap = pool->cap ? pool->cap * 2 : INITIAL_POOL_SIZE;
+    char **symbols = memCalloc(MEM_SYMBOLS, cap, sizeof(char *));
+    uint32_t *hashes = memCalloc(MEM_SYMBOLS, cap, sizeof(uint32_t));
+
+    if (symbols == NULL || hashes == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < pool->cap; i++)
+    {
+        if (pool->symbols[i] == NULL)
+        {
+            continue;
+        }
+
+        size_t slot = pool->hashes[i] & (cap - 1);
+        while (symbols[slot] != NULL)
+        {
+            slot = (slot + 1) & (cap - 1);
+        }
+        symbols[slot] = pool->symbols[i];
+        hashes[slot] = pool->hashes[i];
+    }
+
+    memFree(pool->symbols);
+    memFree(pool->hashes);
+    pool->symbols = symbols;
+    pool->hashes = hashes;
+    pool->cap = cap;
+}
+
+char *internSymbol(INTERP *interp, const char *text, size_t len)
+{
+    SYMBOL_POOL *pool = &interp->symbols;
+
+    // keep the load factor at or below one half
+    if ((pool->count + 1) * 2 > pool->cap)
+    {
+        growSymbolPool(pool);
+    }
+
+    uint32_t hash = hashString(text, len, 0);
+    size_t slot = hash & (pool->cap - 1);
+
+    while (pool->symbols[slot] != NULL)
+    {
+        char *symbol = pool->symbols[slot];
+        if (pool->hashes[slot] == hash && strncmp(symbol, text, len) == 0 && symbol[len] == '\0')
+        {
+            return symbol;
+        }
+        slot = (slot + 1) & (pool->cap - 1);
+    }
+
+    char *symbol = allocFromArena(&pool->strings, len + 1);
+    memcpy(symbol, text, len);
+
+    pool->symbols[slot] = symbol;
+    pool->hashes[slot] = hash;
+    pool->count++;
+
+    return symbol;
+}
+
+size_t internedSymbolCount(INTERP *interp)
+{
+    return interp->symbols.count;
+}
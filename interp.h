@@ -0,0 +1,130 @@
+#ifndef __interp_h_
+#define __interp_h_
+
+#include "cilisp.h"
+#include "arena.h"
+#include "bytecode.h"
+#include "memo.h"
+#include "output.h"
+#include "jobs.h"
+#include "fork.h"
+#include "profile.h"
+#include "jit.h"
+#include "aot.h"
+
+// Open addressing table of every identifier seen by the lexer, see intern.c.
+// The strings live in an arena that is never reset.
+typedef struct {
+    char **symbols;
+    uint32_t *hashes;
+    size_t cap;
+    size_t count;
+    ARENA strings;
+} SYMBOL_POOL;
+
+// A lamda call (or the top level expression) in the tree walker
+typedef struct eval_frame {
+    // first slot on the value stack, args come first then let values
+    size_t base;
+    // frame of the lamda (or top level) the called lamda was defined in
+    size_t link;
+    size_t size;
+} EVAL_FRAME;
+
+// Contiguous value stack shared by all tree walker frames, calls push their
+// args and let slots on top and pop them on return.
+typedef struct {
+    RET_VAL *values;
+    size_t valueLen;
+    size_t valueCap;
+    EVAL_FRAME *frames;
+    size_t frameLen;
+    size_t frameCap;
+    // frame symbols are currently evaluated in
+    size_t current;
+} EVAL_STACK;
+
+// --timing: wall clock time split between reading/parsing and evaluating
+// (resolving, folding, compiling and running) top level expressions
+typedef struct {
+    bool enabled;
+    // end of the last expression, or when timing was turned on
+    uint64_t mark;
+    uint64_t parseNs;
+    uint64_t evalNs;
+    size_t exprs;
+} TIMING;
+
+// --batch: the whole input file is mapped and scanned in place. Line breaks
+// are whitespace and a top level expression ends when its parens balance.
+typedef struct {
+    bool enabled;
+    int depth;
+    // the current top level expression is complete, the parser is owed an EOL
+    bool complete;
+    // source of the current top level expression, echoed like a line in file mode
+    const char *start;
+    const char *end;
+} BATCH_STATE;
+
+// Everything one interpreter reads and writes besides its input. The parser
+// and scanner are reentrant and every pass takes the INTERP it works for, so
+// independent interpreters can run side by side on different threads.
+struct interp {
+    EVAL_ENGINE engine;
+    bool dumpBytecode;
+    // cleared by --no-fold to evaluate expressions exactly as they were written
+    bool foldConstants;
+    bool arenaStats;
+    // --mem-stats: the allocation counters of mem.c are printed at exit
+    bool memStats;
+    // where read takes its lines from
+    FILE *readTarget;
+    FILE *logFile;
+    // warning() counts every warning and prints it unless muted
+    bool muteWarnings;
+    size_t warningCount;
+    // reentrant flex scanner, its yyextra is this interpreter
+    void *scanner;
+    BATCH_STATE batch;
+    // set when the input ran out or quit was parsed
+    bool done;
+    // --jobs: parsed expressions are queued here instead of being evaluated,
+    // workers point at the queue they take jobs from
+    JOB_QUEUE *jobs;
+    // --fork: threads asked for, and once started the pool shared by the
+    // interpreter (thread 0) and its workers
+    int forkThreads;
+    FORK_POOL *fork;
+    int forkIndex;
+    // everything allocated while parsing and evaluating one top level expression
+    ARENA parseArena;
+    SYMBOL_POOL symbols;
+    EVAL_STACK evalStack;
+    VM_STACK vm;
+    MEMO_STATE memo;
+    TIMING timing;
+    PROFILE_STATE profile;
+    JIT_STATE jit;
+    AOT_STATE aot;
+    // buffered stdout, flushed after every top level expression and before reading input
+    OUTPUT out;
+};
+
+// Follows the links from the current tree walker frame out to the frame a symbol lives in
+static inline size_t findEvalFrame(INTERP *interp, int depth)
+{
+    size_t frame = interp->evalStack.current;
+
+    while (depth-- > 0)
+    {
+        frame = interp->evalStack.frames[frame].link;
+    }
+
+    return frame;
+}
+
+INTERP *createInterp(void);
+void freeInterp(INTERP *interp);
+
+#endif
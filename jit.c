@@ -0,0 +1,1391 @@
+#include <sys/mman.h>
+
+#include "jit.h"
+#include "interp.h"
+#include "vector.h"
+
+// The JIT turns lamdas that only do arithmetic, comparisons and conds on
+// their own int and double args, and call other such lamdas, into x86-64
+// machine code. Everything else stays with the interpreter.
+//
+// A lamda is compiled the first time it is called with a given combination
+// of arg types (its signature), along with every lamda that call can reach.
+// The result type of each of these units is inferred first, over all of them
+// at once since they can be recursive; a unit that could return either an
+// int or a double, or uses anything the JIT doesn't know, is left to the
+// interpreter. The code is then emitted from templates, one per AST node.
+//
+// Compiled code keeps every value in rax (ints) or xmm0 (doubles) and saves
+// intermediate ones on the native stack. Args are pushed by the caller, last
+// one first, so arg i is at [rbp + 16 + 8 * i] in the callee, and the caller
+// pops them. A call in tail position overwrites the caller's args and jumps.
+// Ints behave exactly like number.h; whenever number.h would give a double
+// result or warn (overflow, div or rem by 0) the native code bails out: the
+// shared bail stub drops the native frames and the interpreter runs the call
+// again from its args. That is safe as long as compiled code has no side
+// effects, which is why read, print, rand and friends are never compiled.
+#if defined(__x86_64__) && !defined(CILISP_NO_JIT)
+
+// Mapped once and never moved, so the rel32 of a call or jump reaches
+// anything in it
+#define JIT_CODE_SIZE (16 << 20)
+// Native stack compiled code may use below the C frame calling it, deeper
+// recursion bails out to the interpreter
+#define JIT_STACK_BUDGET (1 << 20)
+// Overflows and divisions by 0 a unit may bail out on before the
+// interpreter keeps its calls
+#define MAX_JIT_BAILS 16
+#define INITIAL_UNITS_SIZE 16
+
+// r15 points here while compiled code runs
+typedef struct {
+    // rsp of the entry stub once it saved its registers, the bail stub goes back to it
+    uint64_t savedRsp;
+    uint64_t stackLimit;
+    uint64_t reason;
+} JIT_CONTEXT;
+
+typedef enum {
+    BAIL_ARITH = 1,
+    BAIL_STACK
+} BAIL_REASON;
+
+typedef int (*JIT_ENTRY)(const RET_VAL *args, int64_t *result, JIT_CONTEXT *context);
+
+// rel32 of a call to a unit placed after the caller, filled in once every unit is emitted
+typedef struct {
+    size_t at;
+    JIT_UNIT *target;
+} JIT_PATCH;
+
+typedef struct {
+    INTERP *interp;
+    JIT_STATE *jit;
+    // units created for this compile, inferred and emitted together
+    JIT_UNIT **units;
+    size_t unitCount;
+    size_t unitCap;
+    JIT_PATCH *patches;
+    size_t patchCount;
+    size_t patchCap;
+    // unit being inferred or emitted
+    JIT_UNIT *unit;
+    // start of the unit's body past the prologue, where a self tail call jumps to
+    size_t body;
+    // an inference pass learned something, another one is needed
+    bool changed;
+    // the code buffer ran out, or emitting met a type inference didn't predict
+    bool failed;
+} JIT_COMPILER;
+
+static void *jitGrow(void *array, size_t *cap, size_t len, size_t elemSize)
+{
+    if (len < *cap)
+    {
+        return array;
+    }
+
+    *cap = *cap ? *cap * 2 : INITIAL_UNITS_SIZE;
+    if ((array = memRealloc(MEM_JIT, array, *cap * elemSize)) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    return array;
+}
+
+// ---- type inference ----
+
+static uint32_t countArgs(SYMBOL_TABLE_NODE *lamda)
+{
+    uint32_t count = 0;
+
+    for (SYMBOL_TABLE_NODE *arg = lamda->arg_list; arg != NULL; arg = arg->next)
+    {
+        count++;
+    }
+
+    return count;
+}
+
+// Typed lamdas cast their results and memoized ones go through their
+// tables, both stay with the interpreter
+static bool canCompile(INTERP *interp, SYMBOL_TABLE_NODE *lamda)
+{
+    return lamda != NULL && lamda->symbolType == LAMBDA_TYPE && lamda->type == NO_TYPE &&
+        lamda->value != NULL && countArgs(lamda) <= MAX_JIT_ARGS &&
+        !(interp->memo.limit > 0 && lamda->pure);
+}
+
+static JIT_UNIT *findUnit(JIT_COMPILER *jc, SYMBOL_TABLE_NODE *lamda, uint32_t signature)
+{
+    JIT_UNIT *unit;
+
+    for (unit = lamda->jit; unit != NULL; unit = unit->next)
+    {
+        if (unit->signature == signature)
+        {
+            return unit;
+        }
+    }
+
+    unit = allocFromArena(&jc->interp->parseArena, sizeof(JIT_UNIT));
+    *unit = (JIT_UNIT){lamda, signature, countArgs(lamda), JIT_UNKNOWN, false, 0, 0, 0, lamda->jit};
+    lamda->jit = unit;
+
+    jc->units = jitGrow(jc->units, &jc->unitCap, jc->unitCount, sizeof(JIT_UNIT *));
+    jc->units[jc->unitCount++] = unit;
+    jc->changed = true;
+
+    return unit;
+}
+
+static JIT_TYPE joinTypes(JIT_TYPE a, JIT_TYPE b)
+{
+    if (a == JIT_UNKNOWN)
+    {
+        return b;
+    }
+    if (b == JIT_UNKNOWN || a == b)
+    {
+        return a;
+    }
+    return JIT_FAIL;
+}
+
+// Type of an arg of the unit's own lamda, FAIL for any other symbol
+static JIT_TYPE symbolType(JIT_COMPILER *jc, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *binding = node->data.symbol.binding;
+
+    if (binding == NULL || binding->symbolType != ARG_TYPE || node->data.symbol.depth != 0)
+    {
+        return JIT_FAIL;
+    }
+
+    return (jc->unit->signature >> binding->slot) & 1 ? JIT_DOUBLE : JIT_INT;
+}
+
+static JIT_TYPE numberType(AST_NODE *node)
+{
+    switch (node->data.number.type)
+    {
+    case INT_TYPE:
+        return JIT_INT;
+    case DOUBLE_TYPE:
+        return JIT_DOUBLE;
+    default:
+        return JIT_FAIL;
+    }
+}
+
+static JIT_TYPE inferNode(JIT_COMPILER *jc, AST_NODE *node);
+
+// What arithmetic on the operands gives: int when they all are, double
+// otherwise, or FAIL when same is set and they differ
+static JIT_TYPE inferOperands(JIT_COMPILER *jc, AST_NODE *op, bool same)
+{
+    JIT_TYPE result = JIT_INT;
+    bool known = true;
+    bool mixed = false;
+    JIT_TYPE first = JIT_UNKNOWN;
+
+    for (; op != NULL; op = op->next)
+    {
+        JIT_TYPE type = inferNode(jc, op);
+
+        if (type == JIT_FAIL)
+        {
+            return JIT_FAIL;
+        }
+        if (type == JIT_UNKNOWN)
+        {
+            known = false;
+            continue;
+        }
+        if (type == JIT_DOUBLE)
+        {
+            result = JIT_DOUBLE;
+        }
+        mixed |= first != JIT_UNKNOWN && first != type;
+        first = type;
+    }
+
+    if (same && mixed)
+    {
+        return JIT_FAIL;
+    }
+
+    return known ? result : JIT_UNKNOWN;
+}
+
+// A call to a lamda needs the unit for the types of its args, created here
+// and inferred in a later pass if it is new
+static JIT_TYPE inferLamdaCall(JIT_COMPILER *jc, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *lamda = node->data.function.binding;
+    uint32_t signature = 0;
+    uint32_t i = 0;
+    bool known = true;
+
+    if (!canCompile(jc->interp, lamda) || countOperands(node->data.function.opList) != countArgs(lamda))
+    {
+        return JIT_FAIL;
+    }
+
+    for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next, i++)
+    {
+        JIT_TYPE type = inferNode(jc, op);
+
+        if (type == JIT_FAIL)
+        {
+            return JIT_FAIL;
+        }
+        known &= type != JIT_UNKNOWN;
+        signature |= (uint32_t) (type == JIT_DOUBLE) << i;
+    }
+
+    if (!known)
+    {
+        return JIT_UNKNOWN;
+    }
+
+    JIT_UNIT *unit = findUnit(jc, lamda, signature);
+    return unit->failed ? JIT_FAIL : unit->result;
+}
+
+// The builtins the JIT knows, with the operand counts they don't warn on
+static JIT_TYPE inferCall(JIT_COMPILER *jc, AST_NODE *node)
+{
+    AST_NODE *ops = node->data.function.opList;
+    uint32_t count = countOperands(ops);
+    JIT_TYPE type;
+
+    switch (node->data.function.func)
+    {
+    case CUSTOM_FUNC:
+        return inferLamdaCall(jc, node);
+    case ADD_FUNC:
+    case MULT_FUNC:
+        return count >= 1 ? inferOperands(jc, ops, false) : JIT_FAIL;
+    case SUB_FUNC:
+    case DIV_FUNC:
+        return count == 2 ? inferOperands(jc, ops, false) : JIT_FAIL;
+    case REM_FUNC:
+        // the double one is fmod
+        type = count == 2 ? inferOperands(jc, ops, false) : JIT_FAIL;
+        return type == JIT_DOUBLE ? JIT_FAIL : type;
+    case NEG_FUNC:
+    case ABS_FUNC:
+        return count == 1 ? inferNode(jc, ops) : JIT_FAIL;
+    case SQRT_FUNC:
+        type = count == 1 ? inferNode(jc, ops) : JIT_FAIL;
+        return type == JIT_FAIL ? JIT_FAIL : JIT_DOUBLE;
+    case MAX_FUNC:
+    case MIN_FUNC:
+        // the result is one of the operands, so its type depends on the values when they differ
+        return count >= 2 ? inferOperands(jc, ops, true) : JIT_FAIL;
+    case EQUAL_FUNC:
+    case LESS_FUNC:
+    case GREATER_FUNC:
+        type = count == 2 ? inferOperands(jc, ops, false) : JIT_FAIL;
+        return type == JIT_FAIL ? JIT_FAIL : JIT_INT;
+    default:
+        return JIT_FAIL;
+    }
+}
+
+static JIT_TYPE inferNode(JIT_COMPILER *jc, AST_NODE *node)
+{
+    JIT_TYPE type;
+
+    switch (node->type)
+    {
+    case NUM_NODE_TYPE:
+        return numberType(node);
+    case SYM_NODE_TYPE:
+        return symbolType(jc, node);
+    case FUNC_NODE_TYPE:
+        return inferCall(jc, node);
+    case SCOPE_NODE_TYPE:
+        // lets are lazy frame slots the native code has none of
+        return node->data.scope.symbols == NULL ? inferNode(jc, node->data.scope.child) : JIT_FAIL;
+    case COND_NODE_TYPE:
+        if (inferNode(jc, node->data.cond.contiditonal) == JIT_FAIL)
+        {
+            return JIT_FAIL;
+        }
+        type = inferNode(jc, node->data.cond.true_node);
+        return type == JIT_FAIL ? JIT_FAIL : joinTypes(type, inferNode(jc, node->data.cond.false_node));
+    default:
+        return JIT_FAIL;
+    }
+}
+
+// Infers every unit until nothing changes. A unit whose result is still
+// unknown then can't return without calling itself forever, it fails like
+// the units calling it.
+static void inferUnits(JIT_COMPILER *jc)
+{
+    do
+    {
+        do
+        {
+            jc->changed = false;
+
+            // inferring can append units, they are visited in the same pass
+            for (size_t i = 0; i < jc->unitCount; i++)
+            {
+                JIT_UNIT *unit = jc->units[i];
+
+                if (unit->failed)
+                {
+                    continue;
+                }
+
+                jc->unit = unit;
+                JIT_TYPE type = joinTypes(unit->result, inferNode(jc, unit->lamda->value));
+
+                if (type == JIT_FAIL)
+                {
+                    unit->failed = true;
+                    jc->changed = true;
+                }
+                else if (type != unit->result)
+                {
+                    unit->result = type;
+                    jc->changed = true;
+                }
+            }
+        } while (jc->changed);
+
+        for (size_t i = 0; i < jc->unitCount; i++)
+        {
+            if (!jc->units[i]->failed && jc->units[i]->result == JIT_UNKNOWN)
+            {
+                jc->units[i]->failed = true;
+                jc->changed = true;
+            }
+        }
+    } while (jc->changed);
+}
+
+// ---- code emission ----
+
+static void emitBytes(JIT_COMPILER *jc, const uint8_t *bytes, size_t n)
+{
+    JIT_STATE *jit = jc->jit;
+
+    if (jit->codeLen + n > JIT_CODE_SIZE)
+    {
+        jc->failed = true;
+        return;
+    }
+
+    memcpy(jit->code + jit->codeLen, bytes, n);
+    jit->codeLen += n;
+}
+
+#define EMIT(jc, ...) do { \
+        static const uint8_t bytes_[] = {__VA_ARGS__}; \
+        emitBytes(jc, bytes_, sizeof(bytes_)); \
+    } while (0)
+
+static void emit32(JIT_COMPILER *jc, int32_t value)
+{
+    emitBytes(jc, (const uint8_t *) &value, sizeof(value));
+}
+
+static void emit64(JIT_COMPILER *jc, int64_t value)
+{
+    emitBytes(jc, (const uint8_t *) &value, sizeof(value));
+}
+
+static void patchRel32(JIT_COMPILER *jc, size_t at, size_t target)
+{
+    if (at + 4 <= jc->jit->codeLen)
+    {
+        int32_t rel = (int32_t) ((int64_t) target - (int64_t) (at + 4));
+        memcpy(jc->jit->code + at, &rel, sizeof(rel));
+    }
+}
+
+// A jump whose target comes later, returns where its rel32 goes for patchRel32
+static size_t emitForwardJump(JIT_COMPILER *jc, const uint8_t *opcode, size_t n)
+{
+    emitBytes(jc, opcode, n);
+    emit32(jc, 0);
+
+    return jc->jit->codeLen - 4;
+}
+
+static void emitJumpTo(JIT_COMPILER *jc, const uint8_t *opcode, size_t n, size_t target)
+{
+    patchRel32(jc, emitForwardJump(jc, opcode, n), target);
+}
+
+static const uint8_t CALL[] = {0xE8};
+static const uint8_t JMP[] = {0xE9};
+static const uint8_t JE[] = {0x0F, 0x84};
+static const uint8_t JNE[] = {0x0F, 0x85};
+static const uint8_t JO[] = {0x0F, 0x80};
+static const uint8_t JB[] = {0x0F, 0x82};
+static const uint8_t JAE[] = {0x0F, 0x83};
+static const uint8_t JP[] = {0x0F, 0x8A};
+static const uint8_t JNS[] = {0x0F, 0x89};
+static const uint8_t JGE[] = {0x0F, 0x8D};
+static const uint8_t JLE[] = {0x0F, 0x8E};
+
+static void emitBailIfOverflow(JIT_COMPILER *jc)
+{
+    emitJumpTo(jc, JO, sizeof(JO), jc->jit->bailArith);
+}
+
+static int32_t argOffset(uint32_t slot)
+{
+    return 16 + 8 * (int32_t) slot;
+}
+
+// rax or xmm0 onto the native stack and back
+static void emitPush(JIT_COMPILER *jc, JIT_TYPE type)
+{
+    if (type == JIT_DOUBLE)
+    {
+        EMIT(jc, 0x66, 0x48, 0x0F, 0x7E, 0xC0);     // movq rax, xmm0
+    }
+    EMIT(jc, 0x50);                                 // push rax
+}
+
+static void emitPop(JIT_COMPILER *jc, JIT_TYPE type)
+{
+    EMIT(jc, 0x58);                                 // pop rax
+    if (type == JIT_DOUBLE)
+    {
+        EMIT(jc, 0x66, 0x48, 0x0F, 0x6E, 0xC0);     // movq xmm0, rax
+    }
+}
+
+// Numbers and args are loaded straight into the register they are used
+// from, anything else is computed into rax or xmm0 first
+static bool isLeaf(JIT_COMPILER *jc, AST_NODE *node)
+{
+    return (node->type == NUM_NODE_TYPE && numberType(node) != JIT_FAIL) ||
+        (node->type == SYM_NODE_TYPE && symbolType(jc, node) != JIT_FAIL);
+}
+
+// Loads a number or arg into rax or xmm0, or with second set into rcx or xmm1
+static JIT_TYPE emitLeaf(JIT_COMPILER *jc, AST_NODE *node, bool second)
+{
+    JIT_TYPE type;
+
+    if (node->type == NUM_NODE_TYPE)
+    {
+        type = numberType(node);
+        if (second)
+        {
+            EMIT(jc, 0x48, 0xB9);                   // mov rcx, imm64
+            emit64(jc, node->data.number.integer);
+            if (type == JIT_DOUBLE)
+            {
+                EMIT(jc, 0x66, 0x48, 0x0F, 0x6E, 0xC9); // movq xmm1, rcx
+            }
+        }
+        else
+        {
+            EMIT(jc, 0x48, 0xB8);                   // mov rax, imm64
+            emit64(jc, node->data.number.integer);
+            if (type == JIT_DOUBLE)
+            {
+                EMIT(jc, 0x66, 0x48, 0x0F, 0x6E, 0xC0); // movq xmm0, rax
+            }
+        }
+        return type;
+    }
+
+    type = symbolType(jc, node);
+    if (type == JIT_INT)
+    {
+        if (second)
+        {
+            EMIT(jc, 0x48, 0x8B, 0x8D);             // mov rcx, [rbp + disp32]
+        }
+        else
+        {
+            EMIT(jc, 0x48, 0x8B, 0x85);             // mov rax, [rbp + disp32]
+        }
+    }
+    else if (second)
+    {
+        EMIT(jc, 0xF2, 0x0F, 0x10, 0x8D);           // movsd xmm1, [rbp + disp32]
+    }
+    else
+    {
+        EMIT(jc, 0xF2, 0x0F, 0x10, 0x85);           // movsd xmm0, [rbp + disp32]
+    }
+    emit32(jc, argOffset(node->data.symbol.binding->slot));
+
+    return type;
+}
+
+static JIT_TYPE emitNode(JIT_COMPILER *jc, AST_NODE *node, bool tail);
+
+// Puts the right operand of a binary op in rcx or xmm1, keeping the left one
+// (of type left) in rax or xmm0, and returns the right one's type
+static JIT_TYPE emitRight(JIT_COMPILER *jc, JIT_TYPE left, AST_NODE *node)
+{
+    if (isLeaf(jc, node))
+    {
+        return emitLeaf(jc, node, true);
+    }
+
+    emitPush(jc, left);
+    JIT_TYPE right = emitNode(jc, node, false);
+
+    if (right == JIT_INT)
+    {
+        EMIT(jc, 0x48, 0x89, 0xC1);                 // mov rcx, rax
+    }
+    else
+    {
+        EMIT(jc, 0x66, 0x0F, 0x28, 0xC8);           // movapd xmm1, xmm0
+    }
+    emitPop(jc, left);
+
+    return right;
+}
+
+// Converts the int operand of a mixed pair to double like numValue, returns
+// the type the op works on
+static JIT_TYPE emitUnify(JIT_COMPILER *jc, JIT_TYPE left, JIT_TYPE right)
+{
+    if (left == JIT_INT && right == JIT_INT)
+    {
+        return JIT_INT;
+    }
+    if (left == JIT_INT)
+    {
+        EMIT(jc, 0xF2, 0x48, 0x0F, 0x2A, 0xC0);     // cvtsi2sd xmm0, rax
+    }
+    if (right == JIT_INT)
+    {
+        EMIT(jc, 0xF2, 0x48, 0x0F, 0x2A, 0xC9);     // cvtsi2sd xmm1, rcx
+    }
+    return JIT_DOUBLE;
+}
+
+// numDiv on ints: rounds toward negative infinity, bails on a division by 0
+// and on INT64_MIN / -1
+static void emitIntDiv(JIT_COMPILER *jc)
+{
+    EMIT(jc, 0x48, 0x85, 0xC9);                     // test rcx, rcx
+    emitJumpTo(jc, JE, sizeof(JE), jc->jit->bailArith);
+    EMIT(jc, 0x48, 0x83, 0xF9, 0xFF);               // cmp rcx, -1
+    size_t divide = emitForwardJump(jc, JNE, sizeof(JNE));
+    EMIT(jc, 0x48, 0xF7, 0xD8);                     // neg rax
+    emitBailIfOverflow(jc);
+    size_t negated = emitForwardJump(jc, JMP, sizeof(JMP));
+
+    patchRel32(jc, divide, jc->jit->codeLen);
+    EMIT(jc, 0x48, 0x99,                            // cqo
+        0x48, 0xF7, 0xF9,                           // idiv rcx
+        0x48, 0x85, 0xD2);                          // test rdx, rdx
+    size_t exact = emitForwardJump(jc, JE, sizeof(JE));
+    // the remainder has the dividend's sign, round down when the divisor's differs
+    EMIT(jc, 0x48, 0x31, 0xCA);                     // xor rdx, rcx
+    size_t sameSign = emitForwardJump(jc, JNS, sizeof(JNS));
+    EMIT(jc, 0x48, 0xFF, 0xC8);                     // dec rax
+
+    patchRel32(jc, negated, jc->jit->codeLen);
+    patchRel32(jc, exact, jc->jit->codeLen);
+    patchRel32(jc, sameSign, jc->jit->codeLen);
+}
+
+// numRem on ints: remainder by -1 is 0 (idiv would trap on INT64_MIN), by 0 NaN so it bails
+static void emitIntRem(JIT_COMPILER *jc)
+{
+    EMIT(jc, 0x48, 0x85, 0xC9);                     // test rcx, rcx
+    emitJumpTo(jc, JE, sizeof(JE), jc->jit->bailArith);
+    EMIT(jc, 0x48, 0x83, 0xF9, 0xFF);               // cmp rcx, -1
+    size_t divide = emitForwardJump(jc, JNE, sizeof(JNE));
+    EMIT(jc, 0x31, 0xC0);                           // xor eax, eax
+    size_t zero = emitForwardJump(jc, JMP, sizeof(JMP));
+
+    patchRel32(jc, divide, jc->jit->codeLen);
+    EMIT(jc, 0x48, 0x99,                            // cqo
+        0x48, 0xF7, 0xF9,                           // idiv rcx
+        0x48, 0x89, 0xD0);                          // mov rax, rdx
+    patchRel32(jc, zero, jc->jit->codeLen);
+}
+
+// One step of add, sub, mult, div or rem with its operands in place
+static void emitArithmetic(JIT_COMPILER *jc, FUNC_TYPE func, JIT_TYPE type)
+{
+    if (type == JIT_DOUBLE)
+    {
+        switch (func)
+        {
+        case ADD_FUNC:
+            EMIT(jc, 0xF2, 0x0F, 0x58, 0xC1);       // addsd xmm0, xmm1
+            break;
+        case SUB_FUNC:
+            EMIT(jc, 0xF2, 0x0F, 0x5C, 0xC1);       // subsd xmm0, xmm1
+            break;
+        case MULT_FUNC:
+            EMIT(jc, 0xF2, 0x0F, 0x59, 0xC1);       // mulsd xmm0, xmm1
+            break;
+        case DIV_FUNC:
+            EMIT(jc, 0xF2, 0x0F, 0x5E, 0xC1);       // divsd xmm0, xmm1
+            break;
+        default:
+            jc->failed = true;
+            break;
+        }
+        return;
+    }
+
+    switch (func)
+    {
+    case ADD_FUNC:
+        EMIT(jc, 0x48, 0x01, 0xC8);                 // add rax, rcx
+        emitBailIfOverflow(jc);
+        break;
+    case SUB_FUNC:
+        EMIT(jc, 0x48, 0x29, 0xC8);                 // sub rax, rcx
+        emitBailIfOverflow(jc);
+        break;
+    case MULT_FUNC:
+        EMIT(jc, 0x48, 0x0F, 0xAF, 0xC1);           // imul rax, rcx
+        emitBailIfOverflow(jc);
+        break;
+    case DIV_FUNC:
+        emitIntDiv(jc);
+        break;
+    case REM_FUNC:
+        emitIntRem(jc);
+        break;
+    default:
+        jc->failed = true;
+        break;
+    }
+}
+
+// max and min keep the left operand unless the right one is strictly
+// greater (less), NaN never is
+static void emitMaxMin(JIT_COMPILER *jc, FUNC_TYPE func, JIT_TYPE type)
+{
+    if (type == JIT_INT)
+    {
+        if (func == MAX_FUNC)
+        {
+            EMIT(jc, 0x48, 0x39, 0xC8);             // cmp rax, rcx
+        }
+        else
+        {
+            EMIT(jc, 0x48, 0x39, 0xC1);             // cmp rcx, rax
+        }
+        EMIT(jc, 0x48, 0x0F, 0x4C, 0xC1);           // cmovl rax, rcx
+        return;
+    }
+
+    if (func == MAX_FUNC)
+    {
+        EMIT(jc, 0x66, 0x0F, 0x2E, 0xC8);           // ucomisd xmm1, xmm0
+    }
+    else
+    {
+        EMIT(jc, 0x66, 0x0F, 0x2E, 0xC1);           // ucomisd xmm0, xmm1
+    }
+    EMIT(jc, 0x76, 0x04,                            // jbe past the move
+        0x66, 0x0F, 0x28, 0xC1);                    // movapd xmm0, xmm1
+}
+
+static JIT_TYPE emitOperands(JIT_COMPILER *jc, FUNC_TYPE func, AST_NODE *op)
+{
+    JIT_TYPE type = emitNode(jc, op, false);
+
+    for (op = op->next; op != NULL; op = op->next)
+    {
+        JIT_TYPE right = emitRight(jc, type, op);
+
+        if (func == MAX_FUNC || func == MIN_FUNC)
+        {
+            emitMaxMin(jc, func, type);
+        }
+        else
+        {
+            type = emitUnify(jc, type, right);
+            emitArithmetic(jc, func, type);
+        }
+    }
+
+    return type;
+}
+
+static JIT_TYPE emitUnary(JIT_COMPILER *jc, FUNC_TYPE func, AST_NODE *op)
+{
+    JIT_TYPE type = emitNode(jc, op, false);
+
+    switch (func)
+    {
+    case NEG_FUNC:
+        if (type == JIT_INT)
+        {
+            EMIT(jc, 0x48, 0xF7, 0xD8);             // neg rax
+            emitBailIfOverflow(jc);
+        }
+        else
+        {
+            // times -1.0 like numNeg, which also flips the sign of a NaN
+            EMIT(jc, 0x48, 0xB9);                   // mov rcx, -1.0
+            emit64(jc, (int64_t) 0xBFF0000000000000ULL);
+            EMIT(jc, 0x66, 0x48, 0x0F, 0x6E, 0xC9,  // movq xmm1, rcx
+                0xF2, 0x0F, 0x59, 0xC1);            // mulsd xmm0, xmm1
+        }
+        return type;
+    case ABS_FUNC:
+        if (type == JIT_INT)
+        {
+            EMIT(jc, 0x48, 0x89, 0xC1,              // mov rcx, rax
+                0x48, 0xF7, 0xD9);                  // neg rcx
+            emitBailIfOverflow(jc);
+            EMIT(jc, 0x48, 0x85, 0xC0,              // test rax, rax
+                0x48, 0x0F, 0x4C, 0xC1);            // cmovl rax, rcx
+        }
+        else
+        {
+            EMIT(jc, 0x48, 0xB9);                   // mov rcx, sign bit mask
+            emit64(jc, INT64_MAX);
+            EMIT(jc, 0x66, 0x48, 0x0F, 0x6E, 0xC9,  // movq xmm1, rcx
+                0x66, 0x0F, 0x54, 0xC1);            // andpd xmm0, xmm1
+        }
+        return type;
+    case SQRT_FUNC:
+        if (type == JIT_INT)
+        {
+            EMIT(jc, 0xF2, 0x48, 0x0F, 0x2A, 0xC0); // cvtsi2sd xmm0, rax
+        }
+        EMIT(jc, 0xF2, 0x0F, 0x51, 0xC0);           // sqrtsd xmm0, xmm0
+        return JIT_DOUBLE;
+    default:
+        jc->failed = true;
+        return JIT_FAIL;
+    }
+}
+
+// Compares two operands, leaving the flags for a jump. Returns the type
+// compared, see emitCompare and emitCondJump for reading the flags.
+static JIT_TYPE emitComparison(JIT_COMPILER *jc, FUNC_TYPE func, AST_NODE *op)
+{
+    JIT_TYPE left = emitNode(jc, op, false);
+    JIT_TYPE type = emitUnify(jc, left, emitRight(jc, left, op->next));
+
+    if (type == JIT_INT)
+    {
+        EMIT(jc, 0x48, 0x39, 0xC8);                 // cmp rax, rcx
+    }
+    else if (func == GREATER_FUNC)
+    {
+        // greater is !(a <= b), unordered sets CF like b < a
+        EMIT(jc, 0x66, 0x0F, 0x2E, 0xC8);           // ucomisd xmm1, xmm0
+    }
+    else
+    {
+        // less is !(b <= a): CF set for a < b or unordered; equal wants ZF without PF
+        EMIT(jc, 0x66, 0x0F, 0x2E, 0xC1);           // ucomisd xmm0, xmm1
+    }
+
+    return type;
+}
+
+// equal, less and greater as int 1 or 0 in rax
+static void emitCompare(JIT_COMPILER *jc, FUNC_TYPE func, AST_NODE *op)
+{
+    JIT_TYPE type = emitComparison(jc, func, op);
+
+    if (type == JIT_INT)
+    {
+        switch (func)
+        {
+        case EQUAL_FUNC:
+            EMIT(jc, 0x0F, 0x94, 0xC0);             // sete al
+            break;
+        case LESS_FUNC:
+            EMIT(jc, 0x0F, 0x9C, 0xC0);             // setl al
+            break;
+        default:
+            EMIT(jc, 0x0F, 0x9F, 0xC0);             // setg al
+            break;
+        }
+    }
+    else if (func == EQUAL_FUNC)
+    {
+        EMIT(jc, 0x0F, 0x94, 0xC0,                  // sete al
+            0x0F, 0x9B, 0xC1,                       // setnp cl
+            0x20, 0xC8);                            // and al, cl
+    }
+    else
+    {
+        EMIT(jc, 0x0F, 0x92, 0xC0);                 // setb al
+    }
+
+    EMIT(jc, 0x0F, 0xB6, 0xC0);                     // movzx eax, al
+}
+
+static bool isComparison(AST_NODE *node)
+{
+    if (node->type != FUNC_NODE_TYPE)
+    {
+        return false;
+    }
+
+    FUNC_TYPE func = node->data.function.func;
+    return func == EQUAL_FUNC || func == LESS_FUNC || func == GREATER_FUNC;
+}
+
+// Jumps to the false branch unless the condition holds like numIsTrue, a
+// comparison jumps on its own flags. Returns how many jumps were put in falseJumps.
+static size_t emitCondJump(JIT_COMPILER *jc, AST_NODE *condition, size_t falseJumps[2])
+{
+    if (isComparison(condition))
+    {
+        FUNC_TYPE func = condition->data.function.func;
+        JIT_TYPE type = emitComparison(jc, func, condition->data.function.opList);
+
+        if (type == JIT_INT)
+        {
+            switch (func)
+            {
+            case EQUAL_FUNC:
+                falseJumps[0] = emitForwardJump(jc, JNE, sizeof(JNE));
+                break;
+            case LESS_FUNC:
+                falseJumps[0] = emitForwardJump(jc, JGE, sizeof(JGE));
+                break;
+            default:
+                falseJumps[0] = emitForwardJump(jc, JLE, sizeof(JLE));
+                break;
+            }
+            return 1;
+        }
+
+        if (func == EQUAL_FUNC)
+        {
+            falseJumps[0] = emitForwardJump(jc, JP, sizeof(JP));
+            falseJumps[1] = emitForwardJump(jc, JNE, sizeof(JNE));
+            return 2;
+        }
+
+        falseJumps[0] = emitForwardJump(jc, JAE, sizeof(JAE));
+        return 1;
+    }
+
+    if (emitNode(jc, condition, false) == JIT_INT)
+    {
+        EMIT(jc, 0x48, 0x85, 0xC0);                 // test rax, rax
+    }
+    else
+    {
+        // NaN is true: unordered skips the jump to the false branch
+        EMIT(jc, 0x66, 0x0F, 0x57, 0xC9,            // xorpd xmm1, xmm1
+            0x66, 0x0F, 0x2E, 0xC1,                 // ucomisd xmm0, xmm1
+            0x7A, 0x06);                            // jp past the je
+    }
+    falseJumps[0] = emitForwardJump(jc, JE, sizeof(JE));
+
+    return 1;
+}
+
+static JIT_TYPE emitCond(JIT_COMPILER *jc, AST_NODE *node, bool tail)
+{
+    size_t falseJumps[2];
+    size_t count = emitCondJump(jc, node->data.cond.contiditonal, falseJumps);
+
+    JIT_TYPE type = emitNode(jc, node->data.cond.true_node, tail);
+    size_t end = emitForwardJump(jc, JMP, sizeof(JMP));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        patchRel32(jc, falseJumps[i], jc->jit->codeLen);
+    }
+
+    if (emitNode(jc, node->data.cond.false_node, tail) != type)
+    {
+        jc->failed = true;
+    }
+    patchRel32(jc, end, jc->jit->codeLen);
+
+    return type;
+}
+
+// A call pushes the args last first and pops them after. In tail position,
+// when the callee takes no more args than the running lamda, they replace
+// its own args and the callee is jumped to instead.
+static JIT_TYPE emitLamdaCall(JIT_COMPILER *jc, AST_NODE *node, bool tail)
+{
+    AST_NODE *args[MAX_JIT_ARGS];
+    uint32_t count = 0;
+    uint32_t signature = 0;
+
+    for (AST_NODE *op = node->data.function.opList; op != NULL && count < MAX_JIT_ARGS; op = op->next)
+    {
+        args[count++] = op;
+    }
+
+    bool replace = tail && count <= jc->unit->nargs;
+
+    for (uint32_t n = 0; n < count; n++)
+    {
+        uint32_t i = replace ? n : count - 1 - n;
+        JIT_TYPE type = emitNode(jc, args[i], false);
+
+        signature |= (uint32_t) (type == JIT_DOUBLE) << i;
+        emitPush(jc, type);
+    }
+
+    SYMBOL_TABLE_NODE *lamda = node->data.function.binding;
+    JIT_UNIT *callee = lamda->jit;
+
+    while (callee != NULL && callee->signature != signature)
+    {
+        callee = callee->next;
+    }
+
+    if (callee == NULL || callee->failed)
+    {
+        jc->failed = true;
+        return JIT_FAIL;
+    }
+
+    if (replace)
+    {
+        for (uint32_t i = count; i-- > 0;)
+        {
+            EMIT(jc, 0x58,                          // pop rax
+                0x48, 0x89, 0x85);                  // mov [rbp + disp32], rax
+            emit32(jc, argOffset(i));
+        }
+
+        if (callee == jc->unit)
+        {
+            emitJumpTo(jc, JMP, sizeof(JMP), jc->body);
+            return callee->result;
+        }
+
+        EMIT(jc, 0x5D);                             // pop rbp
+    }
+
+    jc->patches = jitGrow(jc->patches, &jc->patchCap, jc->patchCount, sizeof(JIT_PATCH));
+    jc->patches[jc->patchCount++] = (JIT_PATCH){emitForwardJump(jc, replace ? JMP : CALL, 1), callee};
+
+    if (!replace && count > 0)
+    {
+        EMIT(jc, 0x48, 0x81, 0xC4);                 // add rsp, imm32
+        emit32(jc, 8 * (int32_t) count);
+    }
+
+    return callee->result;
+}
+
+static JIT_TYPE emitCall(JIT_COMPILER *jc, AST_NODE *node, bool tail)
+{
+    FUNC_TYPE func = node->data.function.func;
+    AST_NODE *ops = node->data.function.opList;
+
+    switch (func)
+    {
+    case CUSTOM_FUNC:
+        return emitLamdaCall(jc, node, tail);
+    case ADD_FUNC:
+    case SUB_FUNC:
+    case MULT_FUNC:
+    case DIV_FUNC:
+    case REM_FUNC:
+    case MAX_FUNC:
+    case MIN_FUNC:
+        return emitOperands(jc, func, ops);
+    case NEG_FUNC:
+    case ABS_FUNC:
+    case SQRT_FUNC:
+        return emitUnary(jc, func, ops);
+    case EQUAL_FUNC:
+    case LESS_FUNC:
+    case GREATER_FUNC:
+        emitCompare(jc, func, ops);
+        return JIT_INT;
+    default:
+        jc->failed = true;
+        return JIT_FAIL;
+    }
+}
+
+// Leaves the value of node in rax or xmm0 and returns which
+static JIT_TYPE emitNode(JIT_COMPILER *jc, AST_NODE *node, bool tail)
+{
+    if (isLeaf(jc, node))
+    {
+        return emitLeaf(jc, node, false);
+    }
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        return emitCall(jc, node, tail);
+    case SCOPE_NODE_TYPE:
+        return emitNode(jc, node->data.scope.child, tail);
+    case COND_NODE_TYPE:
+        return emitCond(jc, node, tail);
+    default:
+        jc->failed = true;
+        return JIT_FAIL;
+    }
+}
+
+// The body checks the stack budget and runs with its args above rbp. The
+// entry stub after it is what jitCall calls: it saves the registers it
+// uses, points r15 at the JIT_CONTEXT, pushes the payloads of the RET_VAL
+// args and stores the result.
+static void emitUnit(JIT_COMPILER *jc, JIT_UNIT *unit)
+{
+    JIT_STATE *jit = jc->jit;
+
+    jc->unit = unit;
+    unit->code = jit->codeLen;
+
+    EMIT(jc, 0x55,                                  // push rbp
+        0x48, 0x89, 0xE5,                           // mov rbp, rsp
+        0x49, 0x3B, 0x67, offsetof(JIT_CONTEXT, stackLimit)); // cmp rsp, [r15 + stackLimit]
+    emitJumpTo(jc, JB, sizeof(JB), jit->bailStack);
+
+    jc->body = jit->codeLen;
+    if (emitNode(jc, unit->lamda->value, true) != unit->result)
+    {
+        jc->failed = true;
+    }
+    EMIT(jc, 0x5D,                                  // pop rbp
+        0xC3);                                      // ret
+
+    unit->entry = jit->codeLen;
+    EMIT(jc, 0x55,                                  // push rbp
+        0x48, 0x89, 0xE5,                           // mov rbp, rsp
+        0x41, 0x56,                                 // push r14
+        0x41, 0x57,                                 // push r15
+        0x49, 0x89, 0xD7,                           // mov r15, rdx
+        0x49, 0x89, 0xF6,                           // mov r14, rsi
+        0x49, 0x89, 0x27);                          // mov [r15 + savedRsp], rsp
+
+    for (uint32_t i = unit->nargs; i-- > 0;)
+    {
+        EMIT(jc, 0xFF, 0xB7);                       // push qword [rdi + disp32]
+        emit32(jc, (int32_t) (i * sizeof(RET_VAL) + offsetof(RET_VAL, integer)));
+    }
+
+    emitJumpTo(jc, CALL, sizeof(CALL), unit->code);
+
+    EMIT(jc, 0x49, 0x8B, 0x27);                     // mov rsp, [r15 + savedRsp]
+    if (unit->result == JIT_INT)
+    {
+        EMIT(jc, 0x49, 0x89, 0x06);                 // mov [r14], rax
+    }
+    else
+    {
+        EMIT(jc, 0xF2, 0x41, 0x0F, 0x11, 0x06);     // movsd [r14], xmm0
+    }
+    EMIT(jc, 0xB8, 0x01, 0x00, 0x00, 0x00,          // mov eax, 1
+        0x41, 0x5F,                                 // pop r15
+        0x41, 0x5E,                                 // pop r14
+        0x5D,                                       // pop rbp
+        0xC3);                                      // ret
+}
+
+// The bail stubs record why and return 0 from the entry stub, whatever
+// native frames are below it
+static void emitBailStubs(JIT_COMPILER *jc)
+{
+    JIT_STATE *jit = jc->jit;
+
+    jit->bailArith = jit->codeLen;
+    EMIT(jc, 0x49, 0xC7, 0x47, offsetof(JIT_CONTEXT, reason), BAIL_ARITH, 0, 0, 0); // mov qword [r15 + reason], imm32
+    size_t arith = emitForwardJump(jc, JMP, sizeof(JMP));
+
+    jit->bailStack = jit->codeLen;
+    EMIT(jc, 0x49, 0xC7, 0x47, offsetof(JIT_CONTEXT, reason), BAIL_STACK, 0, 0, 0);
+
+    patchRel32(jc, arith, jit->codeLen);
+    EMIT(jc, 0x49, 0x8B, 0x27,                      // mov rsp, [r15 + savedRsp]
+        0x31, 0xC0,                                 // xor eax, eax
+        0x41, 0x5F,                                 // pop r15
+        0x41, 0x5E,                                 // pop r14
+        0x5D,                                       // pop rbp
+        0xC3);                                      // ret
+}
+
+// ---- compiling and calling ----
+
+static bool mapJitCode(INTERP *interp)
+{
+    JIT_STATE *jit = &interp->jit;
+
+    if (jit->code != NULL)
+    {
+        return true;
+    }
+
+    void *code = mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (code == MAP_FAILED)
+    {
+        warning(interp, "Can't map memory for native code, the JIT is off");
+        jit->enabled = false;
+        return false;
+    }
+
+    JIT_COMPILER jc = {.interp = interp, .jit = jit};
+
+    jit->code = code;
+    emitBailStubs(&jc);
+    jit->codeStart = jit->codeLen;
+    mprotect(jit->code, JIT_CODE_SIZE, PROT_READ | PROT_EXEC);
+
+    return true;
+}
+
+// Infers and emits the unit for lamda and signature with every unit it
+// calls that isn't compiled yet. Returns the unit, failed if it can't be run natively.
+static JIT_UNIT *compileUnit(INTERP *interp, SYMBOL_TABLE_NODE *lamda, uint32_t signature)
+{
+    JIT_STATE *jit = &interp->jit;
+    JIT_COMPILER jc = {.interp = interp, .jit = jit};
+    JIT_UNIT *unit = findUnit(&jc, lamda, signature);
+
+    if (!canCompile(interp, lamda) || !mapJitCode(interp))
+    {
+        unit->failed = true;
+        jit->rejected++;
+        memFree(jc.units);
+        return unit;
+    }
+
+    inferUnits(&jc);
+
+    size_t start = jit->codeLen;
+    mprotect(jit->code, JIT_CODE_SIZE, PROT_READ | PROT_WRITE);
+
+    for (size_t i = 0; i < jc.unitCount && !jc.failed; i++)
+    {
+        if (!jc.units[i]->failed)
+        {
+            emitUnit(&jc, jc.units[i]);
+        }
+    }
+
+    for (size_t i = 0; i < jc.patchCount; i++)
+    {
+        patchRel32(&jc, jc.patches[i].at, jc.patches[i].target->code);
+    }
+
+    mprotect(jit->code, JIT_CODE_SIZE, PROT_READ | PROT_EXEC);
+
+    for (size_t i = 0; i < jc.unitCount; i++)
+    {
+        jc.units[i]->failed |= jc.failed;
+        if (jc.units[i]->failed)
+        {
+            jit->rejected++;
+        }
+        else
+        {
+            jit->compiled++;
+        }
+    }
+
+    if (jc.failed)
+    {
+        jit->codeLen = start;
+    }
+
+    memFree(jc.units);
+    memFree(jc.patches);
+
+    return unit;
+}
+
+bool jitCall(INTERP *interp, SYMBOL_TABLE_NODE *lamda, const RET_VAL *args, size_t nargs, RET_VAL *result)
+{
+    JIT_STATE *jit = &interp->jit;
+    uint32_t signature = 0;
+
+    // profiled calls are timed by the interpreter
+    if (nargs > MAX_JIT_ARGS || interp->profile.enabled)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < nargs; i++)
+    {
+        if (args[i].type == DOUBLE_TYPE)
+        {
+            signature |= 1u << i;
+        }
+        else if (args[i].type != INT_TYPE)
+        {
+            return false;
+        }
+    }
+
+    JIT_UNIT *unit = lamda->jit;
+
+    while (unit != NULL && unit->signature != signature)
+    {
+        unit = unit->next;
+    }
+
+    if (unit == NULL)
+    {
+        unit = compileUnit(interp, lamda, signature);
+    }
+
+    if (unit->failed || unit->nargs != nargs)
+    {
+        return false;
+    }
+
+    JIT_CONTEXT context = {0, (uintptr_t) __builtin_frame_address(0) - JIT_STACK_BUDGET, 0};
+    JIT_ENTRY entry = (JIT_ENTRY) (void *) (jit->code + unit->entry);
+    int64_t bits;
+
+    if (!entry(args, &bits, &context))
+    {
+        jit->bails++;
+
+        // recursion too deep for the budget will be again
+        if (context.reason == BAIL_STACK || ++unit->bails >= MAX_JIT_BAILS)
+        {
+            unit->failed = true;
+        }
+        return false;
+    }
+
+    jit->calls++;
+    *result = unit->result == JIT_INT ? INT_RET_VAL(bits) : (RET_VAL){DOUBLE_TYPE, .integer = bits};
+
+    return true;
+}
+
+void resetJit(INTERP *interp)
+{
+    interp->jit.codeLen = interp->jit.codeStart;
+}
+
+void freeJit(INTERP *interp)
+{
+    if (interp->jit.code != NULL)
+    {
+        munmap(interp->jit.code, JIT_CODE_SIZE);
+        interp->jit.code = NULL;
+    }
+}
+
+#else
+
+// No code generator for this machine, every call stays with the interpreter
+bool jitCall(INTERP *interp, SYMBOL_TABLE_NODE *lamda, const RET_VAL *args, size_t nargs, RET_VAL *result)
+{
+    return false;
+}
+
+void resetJit(INTERP *interp)
+{
+}
+
+void freeJit(INTERP *interp)
+{
+}
+
+#endif
+
+// Same type and value, any two NaNs being the same; vectors compare elementwise
+static bool sameResult(RET_VAL a, RET_VAL b)
+{
+    if (a.type != b.type)
+    {
+        return false;
+    }
+
+    switch (a.type)
+    {
+    case INT_TYPE:
+        return a.integer == b.integer;
+    case DOUBLE_TYPE:
+        return (isnan(a.value) && isnan(b.value)) || memcmp(&a.value, &b.value, sizeof(double)) == 0;
+    case VECTOR_TYPE:
+        return a.vector->len == b.vector->len &&
+            memcmp(a.vector->data, b.vector->data, a.vector->len * sizeof(double)) == 0;
+    default:
+        return true;
+    }
+}
+
+static void describeResult(char *text, size_t size, RET_VAL value)
+{
+    switch (value.type)
+    {
+    case INT_TYPE:
+        snprintf(text, size, "Integer %lld", (long long) value.integer);
+        break;
+    case DOUBLE_TYPE:
+        snprintf(text, size, "Double %.17g", value.value);
+        break;
+    case VECTOR_TYPE:
+        snprintf(text, size, "Vector of %zu", value.vector->len);
+        break;
+    default:
+        snprintf(text, size, "nothing");
+        break;
+    }
+}
+
+void jitCheck(INTERP *interp, RET_VAL native, RET_VAL interpreted, size_t nativeWarnings, size_t interpretedWarnings)
+{
+    JIT_STATE *jit = &interp->jit;
+
+    jit->checks++;
+
+    if (!sameResult(native, interpreted))
+    {
+        char nativeText[64];
+        char interpretedText[64];
+
+        describeResult(nativeText, sizeof(nativeText), native);
+        describeResult(interpretedText, sizeof(interpretedText), interpreted);
+        jit->mismatches++;
+        warning(interp, "jit check: %s with the JIT, %s without", nativeText, interpretedText);
+    }
+    else if (nativeWarnings != interpretedWarnings)
+    {
+        jit->mismatches++;
+        warning(interp, "jit check: %zu warnings with the JIT, %zu without", nativeWarnings, interpretedWarnings);
+    }
+}
+
+void mergeJitStats(JIT_STATE *into, const JIT_STATE *from)
+{
+    into->compiled += from->compiled;
+    into->rejected += from->rejected;
+    into->calls += from->calls;
+    into->bails += from->bails;
+    into->checks += from->checks;
+    into->mismatches += from->mismatches;
+}
+
+void printJitStats(INTERP *interp)
+{
+    JIT_STATE *jit = &interp->jit;
+
+    fprintf(stderr, "jit: %zu compiled, %zu left to the interpreter, %zu native calls, %zu bail outs\n",
+        jit->compiled, jit->rejected, jit->calls, jit->bails);
+
+    if (jit->check)
+    {
+        fprintf(stderr, "jit check: %zu expressions compared, %zu mismatches\n", jit->checks, jit->mismatches);
+    }
+}
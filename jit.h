@@ -0,0 +1,70 @@
+#ifndef __jit_h_
+#define __jit_h_
+
+#include "cilisp.h"
+
+// Args a lamda may take to be compiled, one bit of a signature each
+#define MAX_JIT_ARGS 32
+
+// What a compiled expression leaves in rax or xmm0. UNKNOWN is a result not
+// worked out yet (a call to a lamda still being inferred), FAIL one that
+// can't be compiled.
+typedef enum {
+    JIT_UNKNOWN,
+    JIT_INT,
+    JIT_DOUBLE,
+    JIT_FAIL
+} JIT_TYPE;
+
+// Native code of a lamda for one combination of arg types, see jit.c.
+// Units live for one top level expression, like the lamdas they belong to,
+// and hang off the lamda's SYMBOL_TABLE_NODE.
+typedef struct jit_unit {
+    SYMBOL_TABLE_NODE *lamda;
+    // bit i is set when arg i is a double, clear when it is an int
+    uint32_t signature;
+    uint32_t nargs;
+    JIT_TYPE result;
+    // the body can't be compiled, or it bailed out too often to be worth calling
+    bool failed;
+    // offsets into the code buffer of the body and of the stub C calls it through
+    size_t code;
+    size_t entry;
+    size_t bails;
+    struct jit_unit *next;
+} JIT_UNIT;
+
+// --jit state of one interpreter
+typedef struct {
+    bool enabled;
+    // --jit=check: expressions without side effects are run again with the
+    // JIT off and the two results compared
+    bool check;
+    // mapped on first use, the bail out stubs come first and the code of the
+    // current top level expression from codeStart on
+    uint8_t *code;
+    size_t codeLen;
+    size_t codeStart;
+    size_t bailArith;
+    size_t bailStack;
+    // counters since startup
+    size_t compiled;
+    size_t rejected;
+    size_t calls;
+    size_t bails;
+    size_t checks;
+    size_t mismatches;
+} JIT_STATE;
+
+// Runs a lamda natively when it is or can be compiled for the types of its
+// args, false when the interpreter has to run the call
+bool jitCall(INTERP *interp, SYMBOL_TABLE_NODE *lamda, const RET_VAL *args, size_t nargs, RET_VAL *result);
+// Compares the result of an expression run with the JIT to the interpreter's
+void jitCheck(INTERP *interp, RET_VAL native, RET_VAL interpreted, size_t nativeWarnings, size_t interpretedWarnings);
+// Drops the code of the current top level expression
+void resetJit(INTERP *interp);
+void freeJit(INTERP *interp);
+void mergeJitStats(JIT_STATE *into, const JIT_STATE *from);
+void printJitStats(INTERP *interp);
+
+#endif
@@ -0,0 +1,252 @@
+#include "jobs.h"
+#include "interp.h"
+
+#define INITIAL_JOBS_SIZE 64
+
+bool needsOrder(AST_NODE *node)
+{
+    if (node == NULL)
+    {
+        return false;
+    }
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+    {
+        FUNC_TYPE func = node->data.function.func;
+
+        if (func == RAND_FUNC || func == READ_FUNC || func == MEMSTATS_FUNC || func == PRINT_FUNC)
+        {
+            return true;
+        }
+
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            if (needsOrder(op))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (needsOrder(symbol->value))
+            {
+                return true;
+            }
+        }
+        return needsOrder(node->data.scope.child);
+    case COND_NODE_TYPE:
+        return needsOrder(node->data.cond.contiditonal)
+            || needsOrder(node->data.cond.true_node)
+            || needsOrder(node->data.cond.false_node);
+    default:
+        return false;
+    }
+}
+
+static void runJob(INTERP *interp, JOB *job)
+{
+    // starting from a reset arena keeps the wait for the job out of the parse time
+    resetParseArena(interp);
+    printRetVal(interp, evalTopLevel(interp, job->node));
+    resetParseArena(interp);
+}
+
+static void *runWorker(void *arg)
+{
+    INTERP *interp = arg;
+    JOB_QUEUE *queue = interp->jobs;
+
+    pthread_mutex_lock(&queue->lock);
+
+    for (;;)
+    {
+        while (queue->next < queue->len && queue->jobs[queue->next]->ordered)
+        {
+            queue->next++;
+        }
+
+        if (queue->next < queue->len)
+        {
+            JOB *job = queue->jobs[queue->next++];
+            pthread_mutex_unlock(&queue->lock);
+
+            moveOutput(&job->out, &interp->out);
+            runJob(interp, job);
+            moveOutput(&interp->out, &job->out);
+
+            pthread_mutex_lock(&queue->lock);
+            job->done = true;
+            pthread_cond_broadcast(&queue->finished);
+        }
+        else if (queue->parsed)
+        {
+            break;
+        }
+        else
+        {
+            pthread_cond_wait(&queue->queued, &queue->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+// Starts threads workers with the evaluation options of interp
+void startJobs(INTERP *interp, int threads)
+{
+    JOB_QUEUE *queue;
+
+    if ((queue = memCalloc(MEM_THREADS, 1, sizeof(JOB_QUEUE))) == NULL
+        || (queue->workers = memCalloc(MEM_THREADS, threads, sizeof(pthread_t))) == NULL
+        || (queue->interps = memCalloc(MEM_THREADS, threads, sizeof(INTERP *))) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->queued, NULL);
+    pthread_cond_init(&queue->finished, NULL);
+    queue->threads = threads;
+    interp->jobs = queue;
+
+    for (int i = 0; i < threads; i++)
+    {
+        INTERP *worker = createInterp();
+
+        worker->engine = interp->engine;
+        worker->foldConstants = interp->foldConstants;
+        worker->memo.limit = interp->memo.limit;
+        worker->timing.enabled = interp->timing.enabled;
+        worker->profile.enabled = interp->profile.enabled;
+        worker->jit.enabled = interp->jit.enabled;
+        worker->jit.check = interp->jit.check;
+        // output is collected per job and printed by the main thread
+        worker->out.stream = NULL;
+        worker->jobs = queue;
+        queue->interps[i] = worker;
+
+        if (pthread_create(&queue->workers[i], NULL, runWorker, worker) != 0)
+        {
+            yyerror("Could not start worker thread %d", i);
+        }
+    }
+}
+
+// Takes over a parsed expression, its arena and what was printed while parsing it
+void queueJob(INTERP *interp, AST_NODE *node)
+{
+    JOB_QUEUE *queue = interp->jobs;
+    JOB *job;
+
+    if ((job = memCalloc(MEM_THREADS, 1, sizeof(JOB))) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    job->node = node;
+    // a bytecode dump goes straight to stdout, so it has to happen in order too
+    job->ordered = interp->dumpBytecode || needsOrder(node);
+    moveArena(&interp->parseArena, &job->arena);
+    moveOutput(&interp->out, &job->out);
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->len == queue->cap)
+    {
+        queue->cap = queue->cap ? queue->cap * 2 : INITIAL_JOBS_SIZE;
+        if ((queue->jobs = memRealloc(MEM_THREADS, queue->jobs, queue->cap * sizeof(JOB *))) == NULL)
+        {
+            yyerror("Memory allocation failed!");
+            exit(1);
+        }
+    }
+
+    queue->jobs[queue->len++] = job;
+    pthread_cond_signal(&queue->queued);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void finishJobs(INTERP *interp)
+{
+    JOB_QUEUE *queue = interp->jobs;
+    // printed after the last expression was parsed, like the batch EOF echo
+    OUTPUT tail = {0};
+    moveOutput(&interp->out, &tail);
+
+    pthread_mutex_lock(&queue->lock);
+    queue->parsed = true;
+    pthread_cond_broadcast(&queue->queued);
+    pthread_mutex_unlock(&queue->lock);
+
+    // no more jobs are queued, so the array stays put
+    for (size_t i = 0; i < queue->len; i++)
+    {
+        JOB *job = queue->jobs[i];
+
+        if (job->ordered)
+        {
+            outputText(&interp->out, job->out.data, job->out.len);
+            runJob(interp, job);
+        }
+        else
+        {
+            pthread_mutex_lock(&queue->lock);
+            while (!job->done)
+            {
+                pthread_cond_wait(&queue->finished, &queue->lock);
+            }
+            pthread_mutex_unlock(&queue->lock);
+
+            outputText(&interp->out, job->out.data, job->out.len);
+        }
+
+        flushOutput(&interp->out);
+        freeArena(&job->arena);
+        freeOutput(&job->out);
+    }
+
+    outputText(&interp->out, tail.data, tail.len);
+    freeOutput(&tail);
+
+    // the workers' counters go into the main interpreter's summaries
+    for (int i = 0; i < queue->threads; i++)
+    {
+        INTERP *worker = queue->interps[i];
+        pthread_join(queue->workers[i], NULL);
+
+        interp->warningCount += worker->warningCount;
+        interp->timing.evalNs += worker->timing.evalNs;
+        interp->timing.exprs += worker->timing.exprs;
+        interp->memo.hits += worker->memo.hits;
+        interp->memo.misses += worker->memo.misses;
+        interp->memo.evictions += worker->memo.evictions;
+        interp->memo.tables += worker->memo.tables;
+        mergeProfile(&interp->profile, &worker->profile);
+        mergeJitStats(&interp->jit, &worker->jit);
+
+        freeInterp(worker);
+    }
+
+    // workers still skipping past ordered jobs read them until they are joined
+    for (size_t i = 0; i < queue->len; i++)
+    {
+        memFree(queue->jobs[i]);
+    }
+
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->queued);
+    pthread_cond_destroy(&queue->finished);
+    memFree(queue->jobs);
+    memFree(queue->workers);
+    memFree(queue->interps);
+    memFree(queue);
+    interp->jobs = NULL;
+}
@@ -0,0 +1,49 @@
+#ifndef __jobs_h_
+#define __jobs_h_
+
+#include <pthread.h>
+#include "cilisp.h"
+#include "arena.h"
+#include "output.h"
+
+// A parsed top level expression waiting to be evaluated
+typedef struct {
+    AST_NODE *node;
+    // chunks the AST was parsed into, taken over from the parse arena
+    ARENA arena;
+    // the batch echo and parse warnings, then everything its evaluation prints
+    OUTPUT out;
+    // uses read, print or rand, so it runs on the main thread in source order
+    bool ordered;
+    bool done;
+} JOB;
+
+// --jobs N: the whole file is parsed up front while N worker threads, each
+// with an INTERP of its own, evaluate the expressions that don't depend on
+// the order they run in. Output is printed in source order.
+typedef struct job_queue {
+    pthread_mutex_t lock;
+    // signalled when a job is queued or parsing is over
+    pthread_cond_t queued;
+    // signalled when a worker finishes a job
+    pthread_cond_t finished;
+    JOB **jobs;
+    size_t len;
+    size_t cap;
+    // first job no worker has taken yet
+    size_t next;
+    bool parsed;
+    int threads;
+    pthread_t *workers;
+    INTERP **interps;
+} JOB_QUEUE;
+
+// read, print, rand or memstats anywhere in the expression, lamda bodies
+// included, so it has to run once and in source order
+bool needsOrder(AST_NODE *node);
+void startJobs(INTERP *interp, int threads);
+void queueJob(INTERP *interp, AST_NODE *node);
+// Prints every job's output in order once it is evaluated and stops the workers
+void finishJobs(INTERP *interp);
+
+#endif
@@ -0,0 +1,167 @@
+#include "mem.h"
+#include "cilisp.h"
+#include <stdatomic.h>
+
+// Kept in front of every allocation so memFree knows what to take off the
+// counters, sized to keep the memory after it aligned like malloc's
+typedef union {
+    struct {
+        size_t size;
+        MEM_CATEGORY category;
+    } info;
+    max_align_t align;
+} MEM_HEADER;
+
+// Relaxed atomics: the counters are statistics, nothing is ordered by them.
+// The extra row holds the totals.
+static _Atomic size_t memLive[MEM_CATEGORY_COUNT + 1];
+static _Atomic size_t memPeak[MEM_CATEGORY_COUNT + 1];
+static _Atomic size_t memAllocs[MEM_CATEGORY_COUNT + 1];
+static _Atomic size_t memFrees[MEM_CATEGORY_COUNT + 1];
+
+static const char *memNames[MEM_CATEGORY_COUNT + 1] = {
+    [MEM_AST] = "ast", [MEM_SYMBOLS] = "symbols", [MEM_STRINGS] = "strings",
+    [MEM_STACKS] = "stacks", [MEM_IO] = "io", [MEM_BYTECODE] = "bytecode",
+    [MEM_MEMO] = "memo", [MEM_PROFILE] = "profile", [MEM_JIT] = "jit",
+    [MEM_THREADS] = "threads", [MEM_INTERP] = "interp", [MEM_CATEGORY_COUNT] = "total"
+};
+
+static void raisePeak(int row, size_t live)
+{
+    size_t peak = atomic_load_explicit(&memPeak[row], memory_order_relaxed);
+    while (live > peak && !atomic_compare_exchange_weak_explicit(&memPeak[row], &peak, live,
+        memory_order_relaxed, memory_order_relaxed));
+}
+
+// Moves size bytes into (grow) or out of a category and the total
+static void countBytes(MEM_CATEGORY category, size_t size, bool grow)
+{
+    int rows[2] = {category, MEM_CATEGORY_COUNT};
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (grow)
+        {
+            raisePeak(rows[i], atomic_fetch_add_explicit(&memLive[rows[i]], size, memory_order_relaxed) + size);
+        }
+        else
+        {
+            atomic_fetch_sub_explicit(&memLive[rows[i]], size, memory_order_relaxed);
+        }
+    }
+}
+
+static void countCall(_Atomic size_t *counter, MEM_CATEGORY category)
+{
+    atomic_fetch_add_explicit(&counter[category], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counter[MEM_CATEGORY_COUNT], 1, memory_order_relaxed);
+}
+
+static void *trackHeader(MEM_HEADER *header, MEM_CATEGORY category, size_t size)
+{
+    if (header == NULL)
+    {
+        return NULL;
+    }
+
+    header->info.size = size;
+    header->info.category = category;
+    countBytes(category, size, true);
+    countCall(memAllocs, category);
+
+    return header + 1;
+}
+
+void *memAlloc(MEM_CATEGORY category, size_t size)
+{
+    return trackHeader(malloc(sizeof(MEM_HEADER) + size), category, size);
+}
+
+void *memCalloc(MEM_CATEGORY category, size_t count, size_t size)
+{
+    if (size != 0 && count > (SIZE_MAX - sizeof(MEM_HEADER)) / size)
+    {
+        return NULL;
+    }
+
+    return trackHeader(calloc(1, sizeof(MEM_HEADER) + count * size), category, count * size);
+}
+
+// A resize counts as neither an allocation nor a free, only the bytes move
+void *memRealloc(MEM_CATEGORY category, void *memory, size_t size)
+{
+    if (memory == NULL)
+    {
+        return memAlloc(category, size);
+    }
+
+    MEM_HEADER *header = (MEM_HEADER *) memory - 1;
+    size_t old = header->info.size;
+    category = header->info.category;
+
+    if ((header = realloc(header, sizeof(MEM_HEADER) + size)) == NULL)
+    {
+        return NULL;
+    }
+
+    header->info.size = size;
+    if (size > old)
+    {
+        countBytes(category, size - old, true);
+    }
+    else
+    {
+        countBytes(category, old - size, false);
+    }
+
+    return header + 1;
+}
+
+void memFree(void *memory)
+{
+    if (memory == NULL)
+    {
+        return;
+    }
+
+    MEM_HEADER *header = (MEM_HEADER *) memory - 1;
+    countBytes(header->info.category, header->info.size, false);
+    countCall(memFrees, header->info.category);
+    free(header);
+}
+
+MEM_COUNTERS memCounters(MEM_CATEGORY category)
+{
+    return (MEM_COUNTERS) {
+        .live = atomic_load_explicit(&memLive[category], memory_order_relaxed),
+        .peak = atomic_load_explicit(&memPeak[category], memory_order_relaxed),
+        .allocs = atomic_load_explicit(&memAllocs[category], memory_order_relaxed),
+        .frees = atomic_load_explicit(&memFrees[category], memory_order_relaxed)
+    };
+}
+
+// Categories nothing was allocated for are left out
+size_t formatMemStats(char *buffer, size_t size)
+{
+    size_t len = snprintf(buffer, size, "%-10s %12s %12s %10s %10s\n", "memory", "live_bytes", "peak_bytes", "allocs", "frees");
+
+    for (int i = 0; i <= MEM_CATEGORY_COUNT && len < size; i++)
+    {
+        MEM_COUNTERS counters = memCounters(i);
+        if (counters.allocs == 0 && i != MEM_CATEGORY_COUNT)
+        {
+            continue;
+        }
+
+        len += snprintf(buffer + len, size - len, "%-10s %12zu %12zu %10zu %10zu\n", memNames[i],
+            counters.live, counters.peak, counters.allocs, counters.frees);
+    }
+
+    return len < size ? len : size - 1;
+}
+
+void printMemStats(FILE *stream)
+{
+    char text[MAX_MEM_STATS_CHARS];
+    fwrite(text, 1, formatMemStats(text, sizeof(text)), stream);
+}
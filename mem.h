@@ -0,0 +1,50 @@
+#ifndef __mem_h_
+#define __mem_h_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Longest text formatMemStats writes, with its terminator
+#define MAX_MEM_STATS_CHARS 2048
+
+// What an allocation is for, each category keeps its own counters
+typedef enum {
+    MEM_AST,        // parse arena chunks: nodes, vectors and names of one expression
+    MEM_SYMBOLS,    // symbol pool tables
+    MEM_STRINGS,    // interned identifier text
+    MEM_STACKS,     // tree walker, VM, parser and --fork scope stacks
+    MEM_IO,         // output buffers, input lines and scanner buffers
+    MEM_BYTECODE,   // compiled top level expressions
+    MEM_MEMO,       // --memoize tables
+    MEM_PROFILE,    // --profile tables
+    MEM_JIT,        // --jit compiler tables, the code itself is mapped separately
+    MEM_THREADS,    // --jobs queue and --fork pool
+    MEM_INTERP,     // the interpreters themselves
+    MEM_CATEGORY_COUNT
+} MEM_CATEGORY;
+
+// Counters of one category, shared by every interpreter and thread of the process
+typedef struct {
+    size_t live;
+    size_t peak;
+    size_t allocs;
+    size_t frees;
+} MEM_COUNTERS;
+
+// malloc, calloc, realloc and free that keep the counters of the category
+// they allocate for. memRealloc and memFree take any pointer these returned
+// (or NULL), the category is remembered in front of the memory. They return
+// NULL when the system allocator does, callers report it as usual.
+void *memAlloc(MEM_CATEGORY category, size_t size);
+void *memCalloc(MEM_CATEGORY category, size_t count, size_t size);
+void *memRealloc(MEM_CATEGORY category, void *memory, size_t size);
+void memFree(void *memory);
+
+// Snapshot of a category's counters, MEM_CATEGORY_COUNT for the whole process
+MEM_COUNTERS memCounters(MEM_CATEGORY category);
+// Table of every category and the total, printed for --mem-stats and (memstats)
+size_t formatMemStats(char *buffer, size_t size);
+void printMemStats(FILE *stream);
+
+#endif
@@ -0,0 +1,180 @@
+#include "memo.h"
+#include "interp.h"
+
+#define INITIAL_MEMO_SIZE 16
+
+// Returns the cache of a pure lamda, creating it on first use.
+// NULL when memoization is off or the lamda is not pure.
+MEMO_TABLE *memoTableFor(INTERP *interp, SYMBOL_TABLE_NODE *lamda)
+{
+    if (interp->memo.limit == 0 || !lamda->pure)
+    {
+        return NULL;
+    }
+
+    if (lamda->memo != NULL)
+    {
+        return lamda->memo;
+    }
+
+    MEMO_TABLE *table = memCalloc(MEM_MEMO, 1, sizeof(MEMO_TABLE));
+    if (table == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    for (SYMBOL_TABLE_NODE *arg = lamda->arg_list; arg != NULL; arg = arg->next)
+    {
+        table->nargs++;
+    }
+
+    table->next = interp->memo.live;
+    interp->memo.live = table;
+    interp->memo.tables++;
+
+    return lamda->memo = table;
+}
+
+// Hashes the type and value bits of the arguments, so 0 and -0 or two NaNs
+// with different payloads are different keys
+static uint32_t hashArgs(const RET_VAL *args, size_t nargs)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (size_t i = 0; i < nargs; i++)
+    {
+        uint64_t bits;
+        memcpy(&bits, &args[i].value, sizeof(bits));
+        hash = (hash ^ args[i].type) * 0x100000001b3ULL;
+        hash = (hash ^ bits) * 0x100000001b3ULL;
+        hash ^= hash >> 29;
+    }
+
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+static bool sameArgs(const RET_VAL *a, const RET_VAL *b, size_t nargs)
+{
+    for (size_t i = 0; i < nargs; i++)
+    {
+        if (a[i].type != b[i].type || memcmp(&a[i].value, &b[i].value, sizeof(double)) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Finds the slot holding args, or the empty slot they would go in
+static size_t findMemoSlot(MEMO_TABLE *table, const RET_VAL *args)
+{
+    size_t slot = hashArgs(args, table->nargs) & (table->cap - 1);
+
+    while (table->used[slot] && !sameArgs(table->keys + slot * table->nargs, args, table->nargs))
+    {
+        slot = (slot + 1) & (table->cap - 1);
+    }
+
+    return slot;
+}
+
+bool memoLookup(INTERP *interp, MEMO_TABLE *table, const RET_VAL *args, RET_VAL *result)
+{
+    if (table->count > 0)
+    {
+        size_t slot = findMemoSlot(table, args);
+        if (table->used[slot])
+        {
+            interp->memo.hits++;
+            *result = table->results[slot];
+            return true;
+        }
+    }
+
+    interp->memo.misses++;
+    return false;
+}
+
+static void resizeMemoTable(INTERP *interp, MEMO_TABLE *table, size_t cap)
+{
+    MEMO_TABLE old = *table;
+
+    table->cap = cap;
+    table->count = 0;
+    table->keys = memAlloc(MEM_MEMO, cap * (table->nargs ? table->nargs : 1) * sizeof(RET_VAL));
+    table->results = memAlloc(MEM_MEMO, cap * sizeof(RET_VAL));
+    table->used = memCalloc(MEM_MEMO, cap, sizeof(bool));
+
+    if (table->keys == NULL || table->results == NULL || table->used == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < old.cap; i++)
+    {
+        if (old.used[i])
+        {
+            memoStore(interp, table, old.keys + i * old.nargs, old.results[i]);
+        }
+    }
+
+    memFree(old.keys);
+    memFree(old.results);
+    memFree(old.used);
+}
+
+void memoStore(INTERP *interp, MEMO_TABLE *table, const RET_VAL *args, RET_VAL result)
+{
+    // a full table is emptied rather than tracking recency per entry
+    if (table->count >= interp->memo.limit)
+    {
+        interp->memo.evictions += table->count;
+        memset(table->used, 0, table->cap * sizeof(bool));
+        table->count = 0;
+    }
+
+    // keep the load factor at or below one half
+    if ((table->count + 1) * 2 > table->cap)
+    {
+        resizeMemoTable(interp, table, table->cap ? table->cap * 2 : INITIAL_MEMO_SIZE);
+    }
+
+    size_t slot = findMemoSlot(table, args);
+
+    if (!table->used[slot])
+    {
+        table->used[slot] = true;
+        table->count++;
+    }
+    memcpy(table->keys + slot * table->nargs, args, table->nargs * sizeof(RET_VAL));
+    table->results[slot] = result;
+}
+
+// Releases the caches of the current top level expression along with its lamdas
+void freeMemoTables(INTERP *interp)
+{
+    MEMO_STATE *memo = &interp->memo;
+
+    while (memo->live != NULL)
+    {
+        MEMO_TABLE *next = memo->live->next;
+        memFree(memo->live->keys);
+        memFree(memo->live->results);
+        memFree(memo->live->used);
+        memFree(memo->live);
+        memo->live = next;
+    }
+}
+
+void printMemoStats(INTERP *interp)
+{
+    MEMO_STATE *memo = &interp->memo;
+    size_t lookups = memo->hits + memo->misses;
+
+    fprintf(stderr, "memo: %zu hits, %zu misses (%.1lf%% hit rate), %zu evictions, %zu tables, limit %zu\n",
+        memo->hits, memo->misses, lookups ? 100.0 * memo->hits / lookups : 0.0,
+        memo->evictions, memo->tables, memo->limit);
+}
@@ -0,0 +1,41 @@
+#ifndef __memo_h_
+#define __memo_h_
+
+#include "cilisp.h"
+
+// Default number of cached results per lamda for --memoize
+#define DEFAULT_MEMO_LIMIT 4096
+
+// Results of a pure lamda keyed on its argument values (type and value bits).
+// Tables live for one top level expression, like the lamdas they belong to.
+typedef struct memo_table {
+    size_t nargs;
+    // slots, a power of two kept at least twice the entries
+    size_t cap;
+    size_t count;
+    RET_VAL *keys;
+    RET_VAL *results;
+    bool *used;
+    struct memo_table *next;
+} MEMO_TABLE;
+
+// Memoization state of one interpreter
+typedef struct {
+    // entries a table may hold before it is cleared, 0 when memoization is off
+    size_t limit;
+    // tables created for the current top level expression
+    MEMO_TABLE *live;
+    // counters since startup
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    size_t tables;
+} MEMO_STATE;
+
+MEMO_TABLE *memoTableFor(INTERP *interp, SYMBOL_TABLE_NODE *lamda);
+bool memoLookup(INTERP *interp, MEMO_TABLE *table, const RET_VAL *args, RET_VAL *result);
+void memoStore(INTERP *interp, MEMO_TABLE *table, const RET_VAL *args, RET_VAL result);
+void freeMemoTables(INTERP *interp);
+void printMemoStats(INTERP *interp);
+
+#endif
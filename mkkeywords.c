@@ -0,0 +1,82 @@
+// Build time generator for keyword_table.h.
+// Finds a seed for hashString that maps every name in FUNC_LIST and TYPE_LIST
+// to its own slot, so resolveFunc and resolveType need one probe and one compare.
+#include "cilisp.h"
+
+#define LIST_NAME(value, name) name,
+#define MAX_SEED_TRIES 100000
+
+static const char *funcNames[] = {
+    FUNC_LIST(LIST_NAME)
+};
+
+static const char *typeNames[] = {
+    TYPE_LIST(LIST_NAME)
+};
+
+static bool tryTable(const char **names, int count, uint32_t seed, int size, int *table)
+{
+    for (int i = 0; i < size; i++)
+    {
+        table[i] = -1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t slot = hashString(names[i], strlen(names[i]), seed) & (size - 1);
+        if (table[slot] != -1)
+        {
+            return false;
+        }
+        table[slot] = i;
+    }
+
+    return true;
+}
+
+static void printTable(const char *prefix, const char *table, const char **names, int count)
+{
+    // start at the smallest power of two with room for every name
+    int size = 1;
+    while (size < count)
+    {
+        size *= 2;
+    }
+
+    for (;;)
+    {
+        int slots[size];
+
+        for (uint32_t seed = 0; seed < MAX_SEED_TRIES; seed++)
+        {
+            if (!tryTable(names, count, seed, size, slots))
+            {
+                continue;
+            }
+
+            printf("#define %s_HASH_SEED %uu\n", prefix, seed);
+            printf("#define %s_HASH_SIZE %d\n\n", prefix, size);
+            printf("static const signed char %s[%s_HASH_SIZE] = {", table, prefix);
+            for (int i = 0; i < size; i++)
+            {
+                printf("%s%d", i == 0 ? "\n    " : i % 16 ? ", " : ",\n    ", slots[i]);
+            }
+            printf("\n};\n\n");
+            return;
+        }
+
+        size *= 2;
+    }
+}
+
+int main(void)
+{
+    printf("// Generated by mkkeywords from FUNC_LIST and TYPE_LIST in cilisp.h, do not edit.\n\n");
+    printf("#ifndef __keyword_table_h_\n#define __keyword_table_h_\n\n");
+
+    printTable("FUNC", "funcHashTable", funcNames, sizeof(funcNames) / sizeof(funcNames[0]));
+    printTable("TYPE", "typeHashTable", typeNames, sizeof(typeNames) / sizeof(typeNames[0]));
+
+    printf("#endif\n");
+    return 0;
+}
@@ -0,0 +1,152 @@
+// Build time generator for pow5_table.h.
+// Computes the 128 bit multipliers Ryu needs (see formatDouble in output.c):
+// powers of 5 and their inverses scaled to POW5_BITCOUNT and POW5_INV_BITCOUNT
+// significant bits, with a small bignum so no float math is involved.
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define POW5_BITCOUNT 125
+#define POW5_INV_BITCOUNT 125
+// enough for every decimal exponent a double can produce
+#define POW5_TABLE_SIZE 326
+#define POW5_INV_TABLE_SIZE 342
+
+// 2^(POW5_INV_BITCOUNT + bits of 5^341) fits with room to spare
+#define BIG_LIMBS 40
+
+typedef struct {
+    uint32_t limb[BIG_LIMBS];
+} BIG;
+
+static void bigMul5(BIG *big)
+{
+    uint64_t carry = 0;
+    for (int i = 0; i < BIG_LIMBS; i++)
+    {
+        uint64_t product = (uint64_t) big->limb[i] * 5 + carry;
+        big->limb[i] = (uint32_t) product;
+        carry = product >> 32;
+    }
+}
+
+static int bigBitLength(const BIG *big)
+{
+    for (int i = BIG_LIMBS - 1; i >= 0; i--)
+    {
+        if (big->limb[i] != 0)
+        {
+            return i * 32 + 32 - __builtin_clz(big->limb[i]);
+        }
+    }
+    return 0;
+}
+
+static int bigBit(const BIG *big, int bit)
+{
+    return bit >= 0 && bit < BIG_LIMBS * 32 ? (big->limb[bit / 32] >> (bit % 32)) & 1 : 0;
+}
+
+static void bigShiftLeft1(BIG *big, int low)
+{
+    for (int i = BIG_LIMBS - 1; i > 0; i--)
+    {
+        big->limb[i] = (big->limb[i] << 1) | (big->limb[i - 1] >> 31);
+    }
+    big->limb[0] = (big->limb[0] << 1) | low;
+}
+
+static int bigCompare(const BIG *a, const BIG *b)
+{
+    for (int i = BIG_LIMBS - 1; i >= 0; i--)
+    {
+        if (a->limb[i] != b->limb[i])
+        {
+            return a->limb[i] < b->limb[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void bigSubtract(BIG *a, const BIG *b)
+{
+    int64_t borrow = 0;
+    for (int i = 0; i < BIG_LIMBS; i++)
+    {
+        int64_t difference = (int64_t) a->limb[i] - b->limb[i] - borrow;
+        borrow = difference < 0;
+        a->limb[i] = (uint32_t) (difference + (borrow << 32));
+    }
+}
+
+// The count bits of big starting at bit from (which may be negative), as 128 bits
+static unsigned __int128 bigBits(const BIG *big, int from, int count)
+{
+    unsigned __int128 bits = 0;
+    for (int i = count - 1; i >= 0; i--)
+    {
+        bits = (bits << 1) | bigBit(big, from + i);
+    }
+    return bits;
+}
+
+// floor(2^shift / divisor) by binary long division, the quotient fits in 128 bits
+static unsigned __int128 bigDividePow2(const BIG *divisor, int shift)
+{
+    BIG remainder;
+    unsigned __int128 quotient = 0;
+
+    memset(&remainder, 0, sizeof(remainder));
+    for (int bit = shift; bit >= 0; bit--)
+    {
+        bigShiftLeft1(&remainder, bit == shift);
+        quotient <<= 1;
+        if (bigCompare(&remainder, divisor) >= 0)
+        {
+            bigSubtract(&remainder, divisor);
+            quotient |= 1;
+        }
+    }
+    return quotient;
+}
+
+static void printEntry(unsigned __int128 value, int i)
+{
+    printf("%s{ %lluu, %lluu }", i == 0 ? "\n    " : ",\n    ",
+        (unsigned long long) (uint64_t) value, (unsigned long long) (uint64_t) (value >> 64));
+}
+
+int main(void)
+{
+    BIG pow5;
+
+    printf("// Generated by mkpow5, do not edit.\n\n");
+    printf("#ifndef __pow5_table_h_\n#define __pow5_table_h_\n\n");
+    printf("#define POW5_BITCOUNT %d\n", POW5_BITCOUNT);
+    printf("#define POW5_INV_BITCOUNT %d\n\n", POW5_INV_BITCOUNT);
+
+    // 5^i with its top POW5_BITCOUNT bits, low word first
+    printf("static const uint64_t POW5_SPLIT[%d][2] = {", POW5_TABLE_SIZE);
+    memset(&pow5, 0, sizeof(pow5));
+    pow5.limb[0] = 1;
+    for (int i = 0; i < POW5_TABLE_SIZE; i++)
+    {
+        printEntry(bigBits(&pow5, bigBitLength(&pow5) - POW5_BITCOUNT, POW5_BITCOUNT), i);
+        bigMul5(&pow5);
+    }
+    printf("\n};\n\n");
+
+    // floor(2^(bits of 5^i - 1 + POW5_INV_BITCOUNT) / 5^i) + 1
+    printf("static const uint64_t POW5_INV_SPLIT[%d][2] = {", POW5_INV_TABLE_SIZE);
+    memset(&pow5, 0, sizeof(pow5));
+    pow5.limb[0] = 1;
+    for (int i = 0; i < POW5_INV_TABLE_SIZE; i++)
+    {
+        printEntry(bigDividePow2(&pow5, bigBitLength(&pow5) - 1 + POW5_INV_BITCOUNT) + 1, i);
+        bigMul5(&pow5);
+    }
+    printf("\n};\n\n");
+
+    printf("#endif\n");
+    return 0;
+}
@@ -0,0 +1,387 @@
+#ifndef __number_h_
+#define __number_h_
+
+#include "cilisp.h"
+#include "vector.h"
+
+// Arithmetic on RET_VALs shared by the tree walker, the VM and constant folding.
+// An INT_TYPE result comes out only when every operand is an INT_TYPE; those are
+// computed exactly on int64_t and an overflow warns and gives the double result.
+// Vectors only get checked for once an operand turns out not to be an int, and
+// the operation is then done elementwise by vector.c. The int* and double*
+// kernels skip the checks for operands inferTypes knows are both ints or both
+// doubles.
+
+// Whether a double can be converted to int64_t, false for NaN and infinities
+static inline bool fitsInt64(double value)
+{
+    return value >= -9223372036854775808.0 && value < 9223372036854775808.0;
+}
+
+static inline double numValue(RET_VAL number)
+{
+    return number.type == INT_TYPE ? (double) number.integer : number.value;
+}
+
+// cond and JUMP_FALSE only treat 0 as false, NaN and vectors are true
+static inline bool numIsTrue(RET_VAL number)
+{
+    if (number.type == INT_TYPE)
+    {
+        return number.integer != 0;
+    }
+    return number.type == VECTOR_TYPE || number.value != 0;
+}
+
+static inline RET_VAL intOverflow(INTERP *interp, const char *name, double value)
+{
+    warning(interp, "Integer overflow in %s, result is a double!", name);
+    return DOUBLE_RET_VAL(value);
+}
+
+static inline RET_VAL numNeg(INTERP *interp, RET_VAL a)
+{
+    if (a.type != INT_TYPE)
+    {
+        return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_NEG, a) : DOUBLE_RET_VAL(a.value * -1.0);
+    }
+    if (a.integer == INT64_MIN)
+    {
+        return intOverflow(interp, "neg", -(double) a.integer);
+    }
+    return INT_RET_VAL(-a.integer);
+}
+
+static inline RET_VAL numAbs(INTERP *interp, RET_VAL a)
+{
+    if (a.type != INT_TYPE)
+    {
+        return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_ABS, a) : DOUBLE_RET_VAL(fabs(a.value));
+    }
+    if (a.integer == INT64_MIN)
+    {
+        return intOverflow(interp, "abs", -(double) a.integer);
+    }
+    return INT_RET_VAL(a.integer < 0 ? -a.integer : a.integer);
+}
+
+static inline RET_VAL intAdd(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    int64_t result;
+
+    if (__builtin_add_overflow(a.integer, b.integer, &result))
+    {
+        return intOverflow(interp, "add", (double) a.integer + (double) b.integer);
+    }
+    return INT_RET_VAL(result);
+}
+
+static inline RET_VAL doubleAdd(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    return DOUBLE_RET_VAL(a.value + b.value);
+}
+
+static inline RET_VAL numAdd(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != INT_TYPE || b.type != INT_TYPE)
+    {
+        if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+        {
+            return vecBinary(interp, VEC_ADD, a, b);
+        }
+        return DOUBLE_RET_VAL(numValue(a) + numValue(b));
+    }
+    return intAdd(interp, a, b);
+}
+
+static inline RET_VAL intSub(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    int64_t result;
+
+    if (__builtin_sub_overflow(a.integer, b.integer, &result))
+    {
+        return intOverflow(interp, "sub", (double) a.integer - (double) b.integer);
+    }
+    return INT_RET_VAL(result);
+}
+
+static inline RET_VAL doubleSub(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    return DOUBLE_RET_VAL(a.value - b.value);
+}
+
+static inline RET_VAL numSub(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != INT_TYPE || b.type != INT_TYPE)
+    {
+        if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+        {
+            return vecBinary(interp, VEC_SUB, a, b);
+        }
+        return DOUBLE_RET_VAL(numValue(a) - numValue(b));
+    }
+    return intSub(interp, a, b);
+}
+
+static inline RET_VAL intMult(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    int64_t result;
+
+    if (__builtin_mul_overflow(a.integer, b.integer, &result))
+    {
+        return intOverflow(interp, "mult", (double) a.integer * (double) b.integer);
+    }
+    return INT_RET_VAL(result);
+}
+
+static inline RET_VAL doubleMult(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    return DOUBLE_RET_VAL(a.value * b.value);
+}
+
+static inline RET_VAL numMult(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != INT_TYPE || b.type != INT_TYPE)
+    {
+        if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+        {
+            return vecBinary(interp, VEC_MULT, a, b);
+        }
+        return DOUBLE_RET_VAL(numValue(a) * numValue(b));
+    }
+    return intMult(interp, a, b);
+}
+
+// Integer division rounds toward negative infinity. Dividing by 0 has no int
+// result, so it gives the double inf or nan.
+static inline RET_VAL intDiv(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (b.integer == 0)
+    {
+        return DOUBLE_RET_VAL((double) a.integer / 0.0);
+    }
+    // INT64_MIN / -1 would trap
+    if (b.integer == -1)
+    {
+        if (a.integer == INT64_MIN)
+        {
+            return intOverflow(interp, "div", -(double) a.integer);
+        }
+        return INT_RET_VAL(-a.integer);
+    }
+
+    int64_t quotient = a.integer / b.integer;
+    if (a.integer % b.integer != 0 && (a.integer < 0) != (b.integer < 0))
+    {
+        quotient--;
+    }
+    return INT_RET_VAL(quotient);
+}
+
+static inline RET_VAL doubleDiv(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    return DOUBLE_RET_VAL(a.value / b.value);
+}
+
+static inline RET_VAL numDiv(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != INT_TYPE || b.type != INT_TYPE)
+    {
+        if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+        {
+            return vecBinary(interp, VEC_DIV, a, b);
+        }
+        return DOUBLE_RET_VAL(numValue(a) / numValue(b));
+    }
+    return intDiv(interp, a, b);
+}
+
+// Takes the sign of the dividend like fmod
+static inline RET_VAL numRem(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != INT_TYPE || b.type != INT_TYPE)
+    {
+        if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+        {
+            return vecBinary(interp, VEC_REM, a, b);
+        }
+        return DOUBLE_RET_VAL(fmod(numValue(a), numValue(b)));
+    }
+    if (b.integer == 0)
+    {
+        return NAN_RET_VAL;
+    }
+    if (b.integer == -1)
+    {
+        return ZERO_RET_VAL;
+    }
+    return INT_RET_VAL(a.integer % b.integer);
+}
+
+// Exact by squaring for non negative int exponents, a negative one rounds
+// toward negative infinity like div
+static inline RET_VAL numPow(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != INT_TYPE || b.type != INT_TYPE)
+    {
+        if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+        {
+            return vecBinary(interp, VEC_POW, a, b);
+        }
+        return DOUBLE_RET_VAL(pow(numValue(a), numValue(b)));
+    }
+
+    if (b.integer < 0)
+    {
+        double result = floor(pow((double) a.integer, (double) b.integer));
+        return fitsInt64(result) ? INT_RET_VAL((int64_t) result) : DOUBLE_RET_VAL(result);
+    }
+
+    int64_t base = a.integer;
+    int64_t exponent = b.integer;
+    int64_t result = 1;
+
+    while (exponent > 0)
+    {
+        if ((exponent & 1) && __builtin_mul_overflow(result, base, &result))
+        {
+            return intOverflow(interp, "pow", pow((double) a.integer, (double) b.integer));
+        }
+        exponent >>= 1;
+        if (exponent > 0 && __builtin_mul_overflow(base, base, &base))
+        {
+            return intOverflow(interp, "pow", pow((double) a.integer, (double) b.integer));
+        }
+    }
+    return INT_RET_VAL(result);
+}
+
+// A negative operand always gives a double
+static inline RET_VAL numExp2(INTERP *interp, RET_VAL a)
+{
+    if (a.type != INT_TYPE || a.integer < 0)
+    {
+        return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_EXP2, a) : DOUBLE_RET_VAL(exp2f(numValue(a)));
+    }
+    if (a.integer >= 63)
+    {
+        return intOverflow(interp, "exp2", exp2f(a.integer));
+    }
+    return INT_RET_VAL((int64_t) 1 << a.integer);
+}
+
+// exp, log, sqrt and cbrt always give doubles, exp through float
+static inline RET_VAL numExp(INTERP *interp, RET_VAL a)
+{
+    return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_EXP, a) : DOUBLE_RET_VAL(expf(numValue(a)));
+}
+
+static inline RET_VAL numLog(INTERP *interp, RET_VAL a)
+{
+    return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_LOG, a) : DOUBLE_RET_VAL(log(numValue(a)));
+}
+
+static inline RET_VAL numSqrt(INTERP *interp, RET_VAL a)
+{
+    return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_SQRT, a) : DOUBLE_RET_VAL(sqrt(numValue(a)));
+}
+
+static inline RET_VAL numCbrt(INTERP *interp, RET_VAL a)
+{
+    return a.type == VECTOR_TYPE ? vecUnary(interp, VEC_CBRT, a) : DOUBLE_RET_VAL(cbrt(numValue(a)));
+}
+
+// Square root of the sum of squares of all the operands
+static inline RET_VAL numHypot(INTERP *interp, const RET_VAL *args, size_t n)
+{
+    double sum = 0.0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (args[i].type == VECTOR_TYPE)
+        {
+            return vecHypot(interp, args, n);
+        }
+        sum += pow(numValue(args[i]), 2.0);
+    }
+    return DOUBLE_RET_VAL(sqrt(sum));
+}
+
+// Comparisons are exact between ints and go through doubles otherwise,
+// where anything compared with NaN is false. Vectors compare like NaN.
+static inline bool numEqual(RET_VAL a, RET_VAL b)
+{
+    if (a.type == INT_TYPE && b.type == INT_TYPE)
+    {
+        return a.integer == b.integer;
+    }
+    if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+    {
+        return false;
+    }
+    return numValue(a) == numValue(b);
+}
+
+static inline bool numLess(RET_VAL a, RET_VAL b)
+{
+    if (a.type == INT_TYPE && b.type == INT_TYPE)
+    {
+        return a.integer < b.integer;
+    }
+    if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+    {
+        return false;
+    }
+    return numValue(a) < numValue(b);
+}
+
+static inline bool numLessEqual(RET_VAL a, RET_VAL b)
+{
+    if (a.type == INT_TYPE && b.type == INT_TYPE)
+    {
+        return a.integer <= b.integer;
+    }
+    if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+    {
+        return false;
+    }
+    return numValue(a) <= numValue(b);
+}
+
+// max and min keep the earlier operand unless the later one is strictly
+// greater (less), elementwise when either is a vector
+static inline RET_VAL numMax(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+    {
+        return vecBinary(interp, VEC_MAX, a, b);
+    }
+    return numLess(a, b) ? b : a;
+}
+
+static inline RET_VAL numMin(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type == VECTOR_TYPE || b.type == VECTOR_TYPE)
+    {
+        return vecBinary(interp, VEC_MIN, a, b);
+    }
+    return numLess(b, a) ? b : a;
+}
+
+// dot of two numbers is their product
+static inline RET_VAL numDot(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != VECTOR_TYPE && b.type != VECTOR_TYPE)
+    {
+        return numMult(interp, a, b);
+    }
+    return vecDot(interp, a, b);
+}
+
+// A number counts as one element
+static inline RET_VAL numLen(RET_VAL a)
+{
+    return INT_RET_VAL(a.type == VECTOR_TYPE ? (int64_t) a.vector->len : 1);
+}
+
+#endif
@@ -0,0 +1,503 @@
+#include "output.h"
+#include "pow5_table.h"
+
+#define INITIAL_OUTPUT_SIZE 4096
+
+#define DOUBLE_MANTISSA_BITS 52
+#define DOUBLE_EXPONENT_BITS 11
+#define DOUBLE_BIAS 1023
+
+static const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// A double as mantissa * 10^exponent with the fewest mantissa digits
+typedef struct {
+    uint64_t mantissa;
+    int32_t exponent;
+} DECIMAL;
+
+// Bits of 5^e, exact for 0 <= e <= 3528
+static inline int32_t pow5Bits(int32_t e)
+{
+    return (int32_t) (((uint32_t) e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)) for 0 <= e <= 1650
+static inline uint32_t log10Pow2(int32_t e)
+{
+    return ((uint32_t) e * 78913) >> 18;
+}
+
+// floor(log10(5^e)) for 0 <= e <= 2620
+static inline uint32_t log10Pow5(int32_t e)
+{
+    return ((uint32_t) e * 732923) >> 20;
+}
+
+static inline uint32_t pow5Factor(uint64_t value)
+{
+    uint32_t count = 0;
+    while (value % 5 == 0)
+    {
+        value /= 5;
+        count++;
+    }
+    return count;
+}
+
+static inline bool multipleOfPowerOf5(uint64_t value, uint32_t p)
+{
+    return pow5Factor(value) >= p;
+}
+
+static inline bool multipleOfPowerOf2(uint64_t value, uint32_t p)
+{
+    return (value & ((1ull << p) - 1)) == 0;
+}
+
+// (m * mul) >> j with mul a 128 bit table entry, j >= 64
+static inline uint64_t mulShift64(uint64_t m, const uint64_t *mul, int32_t j)
+{
+    unsigned __int128 low = (unsigned __int128) m * mul[0];
+    unsigned __int128 high = (unsigned __int128) m * mul[1];
+    return (uint64_t) (((low >> 64) + high) >> (j - 64));
+}
+
+static inline uint32_t decimalLength(uint64_t value)
+{
+    uint32_t length = 1;
+    while (value >= 10)
+    {
+        value /= 10;
+        length++;
+    }
+    return length;
+}
+
+// Ryu (Ulf Adams, PLDI 2018): finds the shortest decimal in the interval of
+// numbers that round to the double, working on the scaled bounds
+// mm < mv < mp with 128 bit multiplies by the tables from mkpow5.
+static DECIMAL shortestDecimal(uint64_t ieeeMantissa, uint32_t ieeeExponent)
+{
+    int32_t e2;
+    uint64_t m2;
+
+    if (ieeeExponent == 0)
+    {
+        e2 = 1 - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = ieeeMantissa;
+    }
+    else
+    {
+        e2 = (int32_t) ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS - 2;
+        m2 = (1ull << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+    }
+
+    // the halfway points round to even, so they belong to the interval when m2 is even
+    bool acceptBounds = (m2 & 1) == 0;
+
+    uint64_t mv = 4 * m2;
+    // the gap below is half as wide at a power of two
+    uint32_t mmShift = ieeeMantissa != 0 || ieeeExponent <= 1;
+
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    bool vmIsTrailingZeros = false;
+    bool vrIsTrailingZeros = false;
+
+    if (e2 >= 0)
+    {
+        uint32_t q = log10Pow2(e2) - (e2 > 3);
+        int32_t k = POW5_INV_BITCOUNT + pow5Bits((int32_t) q) - 1;
+        int32_t i = -e2 + (int32_t) q + k;
+
+        e10 = (int32_t) q;
+        vr = mulShift64(4 * m2, POW5_INV_SPLIT[q], i);
+        vp = mulShift64(4 * m2 + 2, POW5_INV_SPLIT[q], i);
+        vm = mulShift64(4 * m2 - 1 - mmShift, POW5_INV_SPLIT[q], i);
+
+        if (q <= 21)
+        {
+            // only one of mp, mv and mm can be a multiple of 5
+            if (mv % 5 == 0)
+            {
+                vrIsTrailingZeros = multipleOfPowerOf5(mv, q);
+            }
+            else if (acceptBounds)
+            {
+                vmIsTrailingZeros = multipleOfPowerOf5(mv - 1 - mmShift, q);
+            }
+            else
+            {
+                vp -= multipleOfPowerOf5(mv + 2, q);
+            }
+        }
+    }
+    else
+    {
+        uint32_t q = log10Pow5(-e2) - (-e2 > 1);
+        int32_t i = -e2 - (int32_t) q;
+        int32_t k = pow5Bits(i) - POW5_BITCOUNT;
+        int32_t j = (int32_t) q - k;
+
+        e10 = (int32_t) q + e2;
+        vr = mulShift64(4 * m2, POW5_SPLIT[i], j);
+        vp = mulShift64(4 * m2 + 2, POW5_SPLIT[i], j);
+        vm = mulShift64(4 * m2 - 1 - mmShift, POW5_SPLIT[i], j);
+
+        if (q <= 1)
+        {
+            // mv = 4 * m2 always has at least two trailing zero bits
+            vrIsTrailingZeros = true;
+            if (acceptBounds)
+            {
+                vmIsTrailingZeros = mmShift == 1;
+            }
+            else
+            {
+                vp--;
+            }
+        }
+        else if (q < 63)
+        {
+            vrIsTrailingZeros = multipleOfPowerOf2(mv, q);
+        }
+    }
+
+    // drop digits while the bounds still differ
+    int32_t removed = 0;
+    uint8_t lastRemovedDigit = 0;
+    uint64_t output;
+
+    if (vmIsTrailingZeros || vrIsTrailingZeros)
+    {
+        // rare: exact ties and bounds that are exactly representable
+        while (vp / 10 > vm / 10)
+        {
+            vmIsTrailingZeros &= vm % 10 == 0;
+            vrIsTrailingZeros &= lastRemovedDigit == 0;
+            lastRemovedDigit = (uint8_t) (vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+
+        if (vmIsTrailingZeros)
+        {
+            while (vm % 10 == 0)
+            {
+                vrIsTrailingZeros &= lastRemovedDigit == 0;
+                lastRemovedDigit = (uint8_t) (vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+
+        if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+        {
+            // round half to even
+            lastRemovedDigit = 4;
+        }
+
+        output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+    }
+    else
+    {
+        bool roundUp = false;
+
+        if (vp / 100 > vm / 100)
+        {
+            roundUp = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+
+        while (vp / 10 > vm / 10)
+        {
+            roundUp = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+
+        output = vr + (vr == vm || roundUp);
+    }
+
+    return (DECIMAL){output, e10 + removed};
+}
+
+// Integers below 2^53 are their own shortest representation
+static bool smallIntDecimal(uint64_t ieeeMantissa, uint32_t ieeeExponent, DECIMAL *decimal)
+{
+    uint64_t m2 = (1ull << DOUBLE_MANTISSA_BITS) | ieeeMantissa;
+    int32_t e2 = (int32_t) ieeeExponent - DOUBLE_BIAS - DOUBLE_MANTISSA_BITS;
+
+    if (e2 > 0 || e2 < -DOUBLE_MANTISSA_BITS || (m2 & ((1ull << -e2) - 1)) != 0)
+    {
+        return false;
+    }
+
+    decimal->mantissa = m2 >> -e2;
+    decimal->exponent = 0;
+
+    while (decimal->mantissa % 10 == 0)
+    {
+        decimal->mantissa /= 10;
+        decimal->exponent++;
+    }
+
+    return true;
+}
+
+// Writes the length decimal digits of value ending at end, two at a time
+static void writeDigits(uint64_t value, char *end)
+{
+    while (value >= 100)
+    {
+        const char *pair = DIGIT_PAIRS + (value % 100) * 2;
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+
+    if (value >= 10)
+    {
+        *--end = DIGIT_PAIRS[value * 2 + 1];
+        *--end = DIGIT_PAIRS[value * 2];
+    }
+    else
+    {
+        *--end = (char) ('0' + value);
+    }
+}
+
+size_t formatInt(int64_t value, char *buffer)
+{
+    char *p = buffer;
+    // INT64_MIN has no positive int64_t
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t) value : (uint64_t) value;
+
+    if (value < 0)
+    {
+        *p++ = '-';
+    }
+
+    uint32_t length = decimalLength(magnitude);
+    writeDigits(magnitude, p + length);
+
+    return (p - buffer) + length;
+}
+
+size_t formatDouble(double value, char *buffer)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool sign = (bits >> (DOUBLE_MANTISSA_BITS + DOUBLE_EXPONENT_BITS)) != 0;
+    uint64_t ieeeMantissa = bits & ((1ull << DOUBLE_MANTISSA_BITS) - 1);
+    uint32_t ieeeExponent = (uint32_t) ((bits >> DOUBLE_MANTISSA_BITS) & ((1u << DOUBLE_EXPONENT_BITS) - 1));
+    char *p = buffer;
+
+    if (sign)
+    {
+        *p++ = '-';
+    }
+
+    if (ieeeExponent == (1u << DOUBLE_EXPONENT_BITS) - 1)
+    {
+        memcpy(p, ieeeMantissa ? "nan" : "inf", 3);
+        return (p - buffer) + 3;
+    }
+
+    if (ieeeExponent == 0 && ieeeMantissa == 0)
+    {
+        memcpy(p, "0.0", 3);
+        return (p - buffer) + 3;
+    }
+
+    DECIMAL decimal;
+    if (!smallIntDecimal(ieeeMantissa, ieeeExponent, &decimal))
+    {
+        decimal = shortestDecimal(ieeeMantissa, ieeeExponent);
+    }
+
+    int32_t length = (int32_t) decimalLength(decimal.mantissa);
+    // exponent of the first digit in scientific notation
+    int32_t scientific = decimal.exponent + length - 1;
+
+    if (scientific >= 16 || scientific < -4)
+    {
+        // d.ddde+XX, the point is left out for a single digit
+        writeDigits(decimal.mantissa, p + length + 1);
+        p[0] = p[1];
+        if (length > 1)
+        {
+            p[1] = '.';
+            p += length + 1;
+        }
+        else
+        {
+            p++;
+        }
+
+        *p++ = 'e';
+        *p++ = scientific < 0 ? '-' : '+';
+        int32_t magnitude = scientific < 0 ? -scientific : scientific;
+        if (magnitude >= 100)
+        {
+            *p++ = (char) ('0' + magnitude / 100);
+            magnitude %= 100;
+        }
+        *p++ = DIGIT_PAIRS[magnitude * 2];
+        *p++ = DIGIT_PAIRS[magnitude * 2 + 1];
+    }
+    else if (decimal.exponent >= 0)
+    {
+        // ddd000.0
+        writeDigits(decimal.mantissa, p + length);
+        p += length;
+        memset(p, '0', decimal.exponent);
+        p += decimal.exponent;
+        memcpy(p, ".0", 2);
+        p += 2;
+    }
+    else if (scientific >= 0)
+    {
+        // dd.ddd
+        writeDigits(decimal.mantissa, p + length + 1);
+        memmove(p, p + 1, scientific + 1);
+        p[scientific + 1] = '.';
+        p += length + 1;
+    }
+    else
+    {
+        // 0.000ddd
+        int32_t zeros = -scientific - 1;
+        memcpy(p, "0.", 2);
+        memset(p + 2, '0', zeros);
+        p += 2 + zeros;
+        writeDigits(decimal.mantissa, p + length);
+        p += length;
+    }
+
+    return p - buffer;
+}
+
+// Makes room for len more bytes
+static void reserveOutput(OUTPUT *out, size_t len)
+{
+    if (out->len + len <= out->cap)
+    {
+        return;
+    }
+
+    size_t cap = out->cap ? out->cap : INITIAL_OUTPUT_SIZE;
+    while (cap < out->len + len)
+    {
+        cap *= 2;
+    }
+
+    if ((out->data = memRealloc(MEM_IO, out->data, cap)) == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+    out->cap = cap;
+}
+
+// Hands a full buffer over, output without a stream is kept until flushOutput
+static inline void checkOutputSize(OUTPUT *out)
+{
+    if (out->len >= OUTPUT_FLUSH_SIZE && out->stream != NULL)
+    {
+        flushOutput(out);
+    }
+}
+
+void outputText(OUTPUT *out, const char *text, size_t len)
+{
+    // a job or tail that printed nothing has no buffer at all
+    if (len == 0)
+        return;
+
+    reserveOutput(out, len);
+    memcpy(out->data + out->len, text, len);
+    out->len += len;
+    checkOutputSize(out);
+}
+
+void outputString(OUTPUT *out, const char *text)
+{
+    outputText(out, text, strlen(text));
+}
+
+void outputFormat(OUTPUT *out, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (len < 0)
+    {
+        return;
+    }
+
+    // vsnprintf writes a terminator past the text
+    reserveOutput(out, len + 1);
+    va_start(args, format);
+    vsnprintf(out->data + out->len, len + 1, format, args);
+    va_end(args);
+
+    out->len += len;
+    checkOutputSize(out);
+}
+
+void outputInt(OUTPUT *out, int64_t value)
+{
+    reserveOutput(out, MAX_NUMBER_CHARS);
+    out->len += formatInt(value, out->data + out->len);
+    checkOutputSize(out);
+}
+
+void outputDouble(OUTPUT *out, double value)
+{
+    reserveOutput(out, MAX_NUMBER_CHARS);
+    out->len += formatDouble(value, out->data + out->len);
+    checkOutputSize(out);
+}
+
+void flushOutput(OUTPUT *out)
+{
+    if (out->len > 0 && out->stream != NULL)
+    {
+        fwrite(out->data, 1, out->len, out->stream);
+    }
+    out->len = 0;
+}
+
+void moveOutput(OUTPUT *out, OUTPUT *into)
+{
+    into->data = out->data;
+    into->len = out->len;
+    into->cap = out->cap;
+
+    out->data = NULL;
+    out->len = 0;
+    out->cap = 0;
+}
+
+void freeOutput(OUTPUT *out)
+{
+    memFree(out->data);
+    out->data = NULL;
+    out->len = 0;
+    out->cap = 0;
+}
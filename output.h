@@ -0,0 +1,37 @@
+#ifndef __output_h_
+#define __output_h_
+
+#include "cilisp.h"
+
+// Longest text formatInt or formatDouble write, they add no terminator
+#define MAX_NUMBER_CHARS 32
+
+// A full buffer is written out once it reaches this size
+#define OUTPUT_FLUSH_SIZE (64 * 1024)
+
+// Everything an interpreter prints to stdout is appended here and handed to
+// the stream in one fwrite by flushOutput, so nothing is formatted by stdio.
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    FILE *stream;
+} OUTPUT;
+
+// Shortest decimal text that reads back as the same double (Ryu), printed
+// like Python's repr: 0.1, 3.0, 1e+16, 1.5e-07, inf, nan
+size_t formatDouble(double value, char *buffer);
+size_t formatInt(int64_t value, char *buffer);
+
+void outputText(OUTPUT *out, const char *text, size_t len);
+void outputString(OUTPUT *out, const char *text);
+// printf for the rare messages that need it, like warnings
+void outputFormat(OUTPUT *out, const char *format, ...);
+void outputInt(OUTPUT *out, int64_t value);
+void outputDouble(OUTPUT *out, double value);
+void flushOutput(OUTPUT *out);
+// Hands the buffered text of out over to the empty into, both keep their streams
+void moveOutput(OUTPUT *out, OUTPUT *into);
+void freeOutput(OUTPUT *out);
+
+#endif
@@ -0,0 +1,248 @@
+#include "profile.h"
+#include <time.h>
+
+#define INITIAL_PROFILE_SIZE 16
+
+static uint64_t profileNow(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + now.tv_nsec;
+}
+
+static size_t hashName(const char *name, size_t cap)
+{
+    uint64_t bits = (uintptr_t) name;
+    return (size_t) ((bits * 0x9e3779b97f4a7c15ULL) >> 32) & (cap - 1);
+}
+
+static void growProfileTable(PROFILE_TABLE *table)
+{
+    size_t cap = table->cap ? table->cap * 2 : INITIAL_PROFILE_SIZE;
+    PROFILE_ENTRY **entries = memCalloc(MEM_PROFILE, cap, sizeof(PROFILE_ENTRY *));
+
+    if (entries == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < table->cap; i++)
+    {
+        PROFILE_ENTRY *entry = table->entries[i];
+        if (entry == NULL)
+        {
+            continue;
+        }
+
+        size_t slot = hashName(entry->name, cap);
+        while (entries[slot] != NULL)
+        {
+            slot = (slot + 1) & (cap - 1);
+        }
+        entries[slot] = entry;
+    }
+
+    memFree(table->entries);
+    table->entries = entries;
+    table->cap = cap;
+}
+
+// Returns the row of an interned name, adding it on first use
+PROFILE_ENTRY *profileEntry(PROFILE_TABLE *table, const char *name)
+{
+    if (table->count * 2 >= table->cap)
+    {
+        growProfileTable(table);
+    }
+
+    size_t slot = hashName(name, table->cap);
+    while (table->entries[slot] != NULL)
+    {
+        if (table->entries[slot]->name == name)
+        {
+            return table->entries[slot];
+        }
+        slot = (slot + 1) & (table->cap - 1);
+    }
+
+    PROFILE_ENTRY *entry = memCalloc(MEM_PROFILE, 1, sizeof(PROFILE_ENTRY));
+    if (entry == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    entry->name = name;
+    table->entries[slot] = entry;
+    table->count++;
+
+    return entry;
+}
+
+void profileEnter(PROFILE_STATE *profile, PROFILE_ENTRY *entry, PROFILE_MARK *mark)
+{
+    mark->entry = entry;
+    mark->childNs = profile->childNs;
+    profile->childNs = 0;
+    entry->active++;
+    mark->start = profileNow();
+}
+
+void profileLeave(PROFILE_STATE *profile, PROFILE_MARK *mark)
+{
+    PROFILE_ENTRY *entry = mark->entry;
+    uint64_t elapsed = profileNow() - mark->start;
+
+    entry->calls++;
+    entry->exclusiveNs += elapsed - profile->childNs;
+    if (--entry->active == 0)
+    {
+        entry->inclusiveNs += elapsed;
+    }
+
+    // the caller sees this whole call as time spent in a child
+    profile->childNs = mark->childNs + elapsed;
+}
+
+static void mergeEntry(PROFILE_ENTRY *into, PROFILE_ENTRY *from)
+{
+    into->calls += from->calls;
+    into->inclusiveNs += from->inclusiveNs;
+    into->exclusiveNs += from->exclusiveNs;
+    into->hops += from->hops;
+    if (from->maxHops > into->maxHops)
+    {
+        into->maxHops = from->maxHops;
+    }
+}
+
+static void mergeProfileTable(PROFILE_TABLE *into, PROFILE_TABLE *from)
+{
+    for (size_t i = 0; i < from->cap; i++)
+    {
+        if (from->entries[i] != NULL)
+        {
+            mergeEntry(profileEntry(into, from->entries[i]->name), from->entries[i]);
+        }
+    }
+}
+
+// Workers evaluate ASTs parsed by the main interpreter, so their names were
+// interned in its symbol pool and still match by pointer
+void mergeProfile(PROFILE_STATE *into, PROFILE_STATE *from)
+{
+    for (int i = 0; i <= CUSTOM_FUNC; i++)
+    {
+        mergeEntry(&into->funcs[i], &from->funcs[i]);
+    }
+
+    mergeProfileTable(&into->lamdas, &from->lamdas);
+    mergeProfileTable(&into->symbols, &from->symbols);
+}
+
+// Most exclusive time first
+static int compareEntries(const void *a, const void *b)
+{
+    const PROFILE_ENTRY *x = *(PROFILE_ENTRY * const *) a;
+    const PROFILE_ENTRY *y = *(PROFILE_ENTRY * const *) b;
+
+    if (x->exclusiveNs != y->exclusiveNs)
+    {
+        return x->exclusiveNs < y->exclusiveNs ? 1 : -1;
+    }
+    if (x->calls != y->calls)
+    {
+        return x->calls < y->calls ? 1 : -1;
+    }
+    return strcmp(x->name, y->name);
+}
+
+static void printEntries(const char *kind, PROFILE_ENTRY **rows, size_t count, bool hops)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    qsort(rows, count, sizeof(PROFILE_ENTRY *), compareEntries);
+
+    fprintf(stderr, "%-16s %12s %12s %12s", kind, "calls", "incl_ms", "excl_ms");
+    fprintf(stderr, hops ? " %9s %9s\n" : "\n", "avg_hops", "max_hops");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        PROFILE_ENTRY *row = rows[i];
+        fprintf(stderr, "%-16s %12llu %12.3lf %12.3lf", row->name, (unsigned long long) row->calls,
+            row->inclusiveNs / 1e6, row->exclusiveNs / 1e6);
+
+        if (hops)
+        {
+            fprintf(stderr, " %9.2lf %9llu", (double) row->hops / row->calls, (unsigned long long) row->maxHops);
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+static size_t collectTable(PROFILE_TABLE *table, PROFILE_ENTRY **rows)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < table->cap; i++)
+    {
+        if (table->entries[i] != NULL && table->entries[i]->calls > 0)
+        {
+            rows[count++] = table->entries[i];
+        }
+    }
+
+    return count;
+}
+
+// One table per kind of row, each sorted by exclusive time
+void printProfile(PROFILE_STATE *profile)
+{
+    size_t most = CUSTOM_FUNC + 1;
+    most = profile->lamdas.count > most ? profile->lamdas.count : most;
+    most = profile->symbols.count > most ? profile->symbols.count : most;
+
+    PROFILE_ENTRY **rows = memAlloc(MEM_PROFILE, most * sizeof(PROFILE_ENTRY *));
+    if (rows == NULL)
+    {
+        yyerror("Memory allocation failed!");
+        exit(1);
+    }
+
+    size_t count = 0;
+    for (int i = 0; i <= CUSTOM_FUNC; i++)
+    {
+        profile->funcs[i].name = i == CUSTOM_FUNC ? "lamda calls" : nameOfFunc(i);
+        if (profile->funcs[i].calls > 0)
+        {
+            rows[count++] = &profile->funcs[i];
+        }
+    }
+
+    fprintf(stderr, "profile:\n");
+    printEntries("builtin", rows, count, false);
+    printEntries("lamda", rows, collectTable(&profile->lamdas, rows), false);
+    printEntries("symbol", rows, collectTable(&profile->symbols, rows), true);
+
+    memFree(rows);
+}
+
+static void freeProfileTable(PROFILE_TABLE *table)
+{
+    for (size_t i = 0; i < table->cap; i++)
+    {
+        memFree(table->entries[i]);
+    }
+    memFree(table->entries);
+    *table = (PROFILE_TABLE){0};
+}
+
+void freeProfile(PROFILE_STATE *profile)
+{
+    freeProfileTable(&profile->lamdas);
+    freeProfileTable(&profile->symbols);
+}
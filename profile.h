@@ -0,0 +1,55 @@
+#ifndef __profile_h_
+#define __profile_h_
+
+#include "cilisp.h"
+
+// One row of the --profile table: a builtin, a lamda or a symbol
+typedef struct {
+    const char *name;
+    uint64_t calls;
+    // wall time of its calls, with (inclusive) and without (exclusive) the
+    // profiled calls made inside them. A recursive call adds to the inclusive
+    // time only through its outermost call.
+    uint64_t inclusiveNs;
+    uint64_t exclusiveNs;
+    // symbols: lamda frames followed out to reach the frame holding it
+    uint64_t hops;
+    uint64_t maxHops;
+    // calls in progress
+    uint32_t active;
+} PROFILE_ENTRY;
+
+// Rows keyed on interned names, so lamdas and symbols compare by pointer.
+// Rows are allocated one by one so marks can hold on to them while the table grows.
+typedef struct {
+    PROFILE_ENTRY **entries;
+    size_t cap;
+    size_t count;
+} PROFILE_TABLE;
+
+// --profile counters of one interpreter since startup
+typedef struct {
+    bool enabled;
+    PROFILE_ENTRY funcs[CUSTOM_FUNC + 1];
+    PROFILE_TABLE lamdas;
+    PROFILE_TABLE symbols;
+    // time spent in profiled calls made by the innermost call in progress
+    uint64_t childNs;
+} PROFILE_STATE;
+
+// A profiled call in progress, kept on the C stack of the eval function
+typedef struct {
+    PROFILE_ENTRY *entry;
+    uint64_t start;
+    uint64_t childNs;
+} PROFILE_MARK;
+
+PROFILE_ENTRY *profileEntry(PROFILE_TABLE *table, const char *name);
+void profileEnter(PROFILE_STATE *profile, PROFILE_ENTRY *entry, PROFILE_MARK *mark);
+void profileLeave(PROFILE_STATE *profile, PROFILE_MARK *mark);
+// Adds the counters of a worker interpreter to the main one's
+void mergeProfile(PROFILE_STATE *into, PROFILE_STATE *from);
+void printProfile(PROFILE_STATE *profile);
+void freeProfile(PROFILE_STATE *profile);
+
+#endif
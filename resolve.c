@@ -0,0 +1,500 @@
+#include "resolve.h"
+#include "interp.h"
+
+// Symbols visible at a point of the tree, one per let section or lamda argument list
+typedef struct resolve_scope {
+    SYMBOL_TABLE_NODE *symbols;
+    // lamda nesting level of the frame owning the slots
+    int level;
+    struct resolve_scope *parent;
+} RESOLVE_SCOPE;
+
+typedef struct {
+    INTERP *interp;
+    RESOLVE_INFO *info;
+    int level;
+    // slot counter of the frame being laid out
+    int *frameSize;
+} RESOLVER;
+
+static void resolveNode(RESOLVER *r, RESOLVE_SCOPE *scope, AST_NODE *node);
+
+// Finds the closest definition of id, lamdas and values live in separate namespaces
+static SYMBOL_TABLE_NODE *findBinding(RESOLVE_SCOPE *scope, const char *id, bool lamda, int *level)
+{
+    while (scope != NULL)
+    {
+        SYMBOL_TABLE_NODE *symbol = scope->symbols;
+        while (symbol != NULL)
+        {
+            // ids come from internSymbol so pointer equality is enough
+            if ((symbol->symbolType == LAMBDA_TYPE) == lamda && symbol->id == id)
+            {
+                *level = scope->level;
+                return symbol;
+            }
+            symbol = symbol->next;
+        }
+        scope = scope->parent;
+    }
+
+    return NULL;
+}
+
+// Marks the lamda calls in tail position of a lamda body (through cond branches
+// and scopes) that can replace the caller's frame instead of pushing a new one.
+static void markTailCalls(SYMBOL_TABLE_NODE *lamda, AST_NODE *node)
+{
+    while (node != NULL)
+    {
+        switch (node->type)
+        {
+        case SCOPE_NODE_TYPE:
+            node = node->data.scope.child;
+            break;
+        case COND_NODE_TYPE:
+            markTailCalls(lamda, node->data.cond.true_node);
+            node = node->data.cond.false_node;
+            break;
+        case FUNC_NODE_TYPE:
+        {
+            SYMBOL_TABLE_NODE *callee = node->data.function.binding;
+            int nargs = 0;
+            int nops = 0;
+
+            if (node->data.function.func != CUSTOM_FUNC || callee == NULL)
+            {
+                return;
+            }
+
+            for (SYMBOL_TABLE_NODE *arg = callee->arg_list; arg != NULL; arg = arg->next)
+            {
+                nargs++;
+            }
+            for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+            {
+                nops++;
+            }
+
+            // A lamda defined in the caller's own frame needs that frame as its link,
+            // a short call returns NAN without calling, and the caller's cast has to
+            // be the callee's (or none) since it is never applied after the jump.
+            node->data.function.tail = node->data.function.depth > 0 && nops >= nargs
+                && (lamda->type == NO_TYPE || lamda->type == callee->type);
+            return;
+        }
+        default:
+            return;
+        }
+    }
+}
+
+// Lays out a lamda's frame: args take the first slots, lets in the body follow
+static void resolveLamda(RESOLVER *r, RESOLVE_SCOPE *scope, SYMBOL_TABLE_NODE *lamda)
+{
+    RESOLVER saved = *r;
+    RESOLVE_SCOPE args = {lamda->arg_list, scope->level + 1, scope};
+    int frameSize = 0;
+
+    for (SYMBOL_TABLE_NODE *arg = lamda->arg_list; arg != NULL; arg = arg->next)
+    {
+        arg->slot = frameSize++;
+    }
+
+    r->level = args.level;
+    r->frameSize = &frameSize;
+
+    resolveNode(r, &args, lamda->value);
+    markTailCalls(lamda, lamda->value);
+
+    lamda->frameSize = frameSize;
+    *r = saved;
+}
+
+// Binds an operand naming the lamda a range builtin calls, the symbol node
+// gets the lamda as its binding
+static void resolveLamdaOperand(RESOLVER *r, RESOLVE_SCOPE *scope, AST_NODE *node, AST_NODE *op, int i)
+{
+    int level;
+
+    if (op->type != SYM_NODE_TYPE)
+    {
+        warning(r->interp, "Operand %d of %s must be a lamda name!", i + 1, nameOfFunc(node->data.function.func));
+        resolveNode(r, scope, op);
+        return;
+    }
+
+    char *id = op->data.symbol.id;
+
+    // the binding takes the place of the name
+    op->data.symbol.binding = findBinding(scope, id, true, &level);
+    if (op->data.symbol.binding == NULL)
+    {
+        warning(r->interp, "Undefined lamda: %s", id);
+        return;
+    }
+    op->data.symbol.depth = r->level - level;
+}
+
+// The let section of a scope is visible to the expression it applies to, its
+// own values (in any order) and the bodies of its lamdas.
+static void resolveScope(RESOLVER *r, RESOLVE_SCOPE *parent, AST_NODE *node)
+{
+    RESOLVE_SCOPE scope = {node->data.scope.symbols, r->level, parent};
+
+    for (SYMBOL_TABLE_NODE *symbol = scope.symbols; symbol != NULL; symbol = symbol->next)
+    {
+        symbol->level = r->level;
+        if (symbol->symbolType == LAMBDA_TYPE)
+        {
+            symbol->index = ++r->info->lamdas;
+            // assumed until findImpureLamdas shows otherwise
+            symbol->pure = true;
+        }
+        else
+        {
+            symbol->slot = (*r->frameSize)++;
+            symbol->index = r->info->vars++;
+        }
+    }
+
+    for (SYMBOL_TABLE_NODE *symbol = scope.symbols; symbol != NULL; symbol = symbol->next)
+    {
+        if (symbol->symbolType == LAMBDA_TYPE)
+        {
+            resolveLamda(r, &scope, symbol);
+        }
+        else
+        {
+            resolveNode(r, &scope, symbol->value);
+        }
+    }
+
+    resolveNode(r, &scope, node->data.scope.child);
+}
+
+static void resolveExpression(RESOLVER *r, RESOLVE_SCOPE *scope, AST_NODE *node)
+{
+    int level;
+    char *id;
+
+    switch (node->type)
+    {
+    case NUM_NODE_TYPE:
+        break;
+    case SYM_NODE_TYPE:
+        id = node->data.symbol.id;
+        node->data.symbol.binding = findBinding(scope, id, false, &level);
+        if (node->data.symbol.binding == NULL)
+        {
+            warning(r->interp, "Undefined symbol: %s", id);
+            break;
+        }
+        node->data.symbol.depth = r->level - level;
+        break;
+    case FUNC_NODE_TYPE:
+        if (node->data.function.func == CUSTOM_FUNC)
+        {
+            id = node->data.function.id;
+            node->data.function.binding = findBinding(scope, id, true, &level);
+            if (node->data.function.binding == NULL)
+            {
+                warning(r->interp, "Undefined lamda: %s", id);
+            }
+            else
+            {
+                node->data.function.depth = r->level - level;
+            }
+        }
+        int i = 0;
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next, i++)
+        {
+            if (i < lamdaOperandCount(node->data.function.func))
+            {
+                resolveLamdaOperand(r, scope, node, op, i);
+            }
+            else
+            {
+                resolveNode(r, scope, op);
+            }
+        }
+        break;
+    case SCOPE_NODE_TYPE:
+        resolveScope(r, scope, node);
+        break;
+    case COND_NODE_TYPE:
+        resolveNode(r, scope, node->data.cond.contiditonal);
+        resolveNode(r, scope, node->data.cond.true_node);
+        resolveNode(r, scope, node->data.cond.false_node);
+        break;
+    default:
+        yyerror("Incorrect ast node passed into resolveExpression!");
+    }
+}
+
+static void resolveNode(RESOLVER *r, RESOLVE_SCOPE *scope, AST_NODE *node)
+{
+    if (!node)
+    {
+        yyerror("NULL ast node passed into resolveNode!");
+        return;
+    }
+
+    resolveExpression(r, scope, node);
+}
+
+// Whether evaluating a node has no side effects and only reads frames at
+// minLevel or deeper (the lamda being checked and the ones it defines) or the
+// top level frame, which stays put for the whole expression.
+static bool isPureNode(AST_NODE *node, int level, int minLevel)
+{
+    if (node == NULL)
+    {
+        return true;
+    }
+
+    switch (node->type)
+    {
+    case SYM_NODE_TYPE:
+    {
+        SYMBOL_TABLE_NODE *binding = node->data.symbol.binding;
+        int target = level - node->data.symbol.depth;
+
+        // a lamda a range builtin calls counts like a call to it
+        if (binding != NULL && binding->symbolType == LAMBDA_TYPE)
+        {
+            return binding->level >= minLevel || binding->pure;
+        }
+        return binding == NULL || target == 0 || target >= minLevel;
+    }
+    case FUNC_NODE_TYPE:
+    {
+        FUNC_TYPE func = node->data.function.func;
+        SYMBOL_TABLE_NODE *callee = node->data.function.binding;
+
+        if (func == RAND_FUNC || func == READ_FUNC || func == MEMSTATS_FUNC || func == PRINT_FUNC)
+        {
+            return false;
+        }
+
+        // lamdas defined inside the one being checked were scanned with its let sections
+        if (func == CUSTOM_FUNC && callee != NULL && callee->level < minLevel && !callee->pure)
+        {
+            return false;
+        }
+
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            if (!isPureNode(op, level, minLevel))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            int valueLevel = symbol->symbolType == LAMBDA_TYPE ? level + 1 : level;
+            if (!isPureNode(symbol->value, valueLevel, minLevel))
+            {
+                return false;
+            }
+        }
+        return isPureNode(node->data.scope.child, level, minLevel);
+    case COND_NODE_TYPE:
+        return isPureNode(node->data.cond.contiditonal, level, minLevel)
+            && isPureNode(node->data.cond.true_node, level, minLevel)
+            && isPureNode(node->data.cond.false_node, level, minLevel);
+    default:
+        return true;
+    }
+}
+
+// Clears the pure flag of every lamda that is impure on its own or calls a
+// lamda cleared so far, returns whether anything changed
+static bool findImpureLamdas(AST_NODE *node)
+{
+    bool changed = false;
+
+    if (node == NULL)
+    {
+        return false;
+    }
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            changed |= findImpureLamdas(op);
+        }
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (symbol->symbolType == LAMBDA_TYPE && symbol->pure
+                && !isPureNode(symbol->value, symbol->level + 1, symbol->level + 1))
+            {
+                symbol->pure = false;
+                changed = true;
+            }
+            changed |= findImpureLamdas(symbol->value);
+        }
+        changed |= findImpureLamdas(node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        changed |= findImpureLamdas(node->data.cond.contiditonal);
+        changed |= findImpureLamdas(node->data.cond.true_node);
+        changed |= findImpureLamdas(node->data.cond.false_node);
+        break;
+    default:
+        break;
+    }
+
+    return changed;
+}
+
+// Whether an operand can be evaluated on another thread: it calls nothing
+// with side effects (read, print, rand, impure lamdas). Sets *calls when it
+// calls a lamda, the cheap check for it being worth a thread.
+static bool isForkable(AST_NODE *node, bool *calls)
+{
+    if (node == NULL)
+    {
+        return true;
+    }
+
+    switch (node->type)
+    {
+    case SYM_NODE_TYPE:
+    {
+        SYMBOL_TABLE_NODE *binding = node->data.symbol.binding;
+
+        // the lamda a range builtin calls
+        if (binding != NULL && binding->symbolType == LAMBDA_TYPE)
+        {
+            *calls = true;
+            return binding->pure;
+        }
+        return true;
+    }
+    case FUNC_NODE_TYPE:
+    {
+        FUNC_TYPE func = node->data.function.func;
+        SYMBOL_TABLE_NODE *callee = node->data.function.binding;
+
+        if (func == RAND_FUNC || func == READ_FUNC || func == MEMSTATS_FUNC || func == PRINT_FUNC)
+        {
+            return false;
+        }
+
+        if (func == CUSTOM_FUNC && callee != NULL)
+        {
+            if (!callee->pure)
+            {
+                return false;
+            }
+            *calls = true;
+        }
+
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            if (!isForkable(op, calls))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (!isForkable(symbol->value, calls))
+            {
+                return false;
+            }
+        }
+        return isForkable(node->data.scope.child, calls);
+    case COND_NODE_TYPE:
+        return isForkable(node->data.cond.contiditonal, calls)
+            && isForkable(node->data.cond.true_node, calls)
+            && isForkable(node->data.cond.false_node, calls);
+    default:
+        return true;
+    }
+}
+
+// Sets the forkable operands of every add, mult, max and min with at least two
+static void markForkableOperands(AST_NODE *node)
+{
+    if (node == NULL)
+    {
+        return;
+    }
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+    {
+        FUNC_TYPE func = node->data.function.func;
+        bool variadic = func == ADD_FUNC || func == MULT_FUNC || func == MAX_FUNC || func == MIN_FUNC;
+        uint64_t forkable = 0;
+        int i = 0;
+
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next, i++)
+        {
+            bool calls = false;
+            if (variadic && i < 64 && isForkable(op, &calls) && calls)
+            {
+                forkable |= (uint64_t) 1 << i;
+            }
+            markForkableOperands(op);
+        }
+
+        // a lamda call keeps its binding there
+        if (func != CUSTOM_FUNC)
+        {
+            node->data.function.forkable = __builtin_popcountll(forkable) >= 2 ? forkable : 0;
+        }
+        break;
+    }
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            markForkableOperands(symbol->value);
+        }
+        markForkableOperands(node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        markForkableOperands(node->data.cond.contiditonal);
+        markForkableOperands(node->data.cond.true_node);
+        markForkableOperands(node->data.cond.false_node);
+        break;
+    default:
+        break;
+    }
+}
+
+// Binds every symbol reference and lamda call in a top level expression to its
+// definition and frame address, reporting undefined names once up front.
+void resolveSymbols(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info)
+{
+    *info = (RESOLVE_INFO){0, 0, 0};
+
+    RESOLVER r = {interp, info, 0, &info->frameSize};
+    resolveNode(&r, NULL, node);
+
+    // every lamda starts out pure, drop the impure ones until (mutually)
+    // recursive lamdas settle
+    bool changed;
+    do
+    {
+        changed = findImpureLamdas(node);
+    } while (changed);
+
+    if (interp->fork != NULL)
+    {
+        markForkableOperands(node);
+    }
+}
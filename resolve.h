@@ -0,0 +1,18 @@
+#ifndef __resolve_h_
+#define __resolve_h_
+
+#include "cilisp.h"
+
+// What resolveSymbols found in a top level expression
+typedef struct {
+    // slots in the top level frame
+    int frameSize;
+    // lamdas are numbered 1..lamdas, the top level expression is function 0
+    int lamdas;
+    // let vars are numbered 0..vars-1
+    int vars;
+} RESOLVE_INFO;
+
+void resolveSymbols(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info);
+
+#endif
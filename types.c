@@ -0,0 +1,663 @@
+#include "types.h"
+#include "interp.h"
+#include "number.h"
+
+// inferTypes goes over the expression until nothing changes. A number has
+// its own type, a builtin what number.h and vector.c can make of its
+// operands, a call what the lamda's body gives after its cast, a let read what
+// its value gives after the cast and an arg what any call passes for it. The
+// sets of the symbols only grow, so a few rounds do. Lamdas that are never
+// called keep empty sets, their nodes get no kernels.
+
+typedef struct {
+    INTERP *interp;
+    // a symbol's set grew this round
+    bool changed;
+} INFERENCE;
+
+// Lets that can be read while they are being forced, which gives NaN, found
+// as the lets on a cycle of references between let values and lamda bodies
+// (Tarjan's algorithm). Vars are numbered first, then lamdas.
+typedef struct {
+    int vars;
+    int visited;
+    // visiting order from 1, 0 before the symbol is visited
+    int *order;
+    int *low;
+    bool *onStack;
+    SYMBOL_TABLE_NODE **stack;
+    int depth;
+} CYCLES;
+
+static TYPE_SET typeNode(INFERENCE *inf, AST_NODE *node);
+
+static int countLamdaArgs(SYMBOL_TABLE_NODE *lamda)
+{
+    int count = 0;
+
+    for (SYMBOL_TABLE_NODE *arg = lamda->arg_list; arg != NULL; arg = arg->next)
+    {
+        count++;
+    }
+
+    return count;
+}
+
+static void addTypes(INFERENCE *inf, SYMBOL_TABLE_NODE *symbol, TYPE_SET types)
+{
+    if ((symbol->types | types) != symbol->types)
+    {
+        symbol->types |= types;
+        inf->changed = true;
+    }
+}
+
+// What castRetVal can make of a value: an int cast keeps a double too big for
+// an int, neither cast touches vectors
+static TYPE_SET castTypes(NUM_TYPE type, TYPE_SET types)
+{
+    switch (type)
+    {
+    case INT_TYPE:
+        return types & DOUBLE_TYPES ? types | INT_TYPES : types;
+    case DOUBLE_TYPE:
+        return types & INT_TYPES ? (types & ~INT_TYPES) | DOUBLE_TYPES : types;
+    default:
+        return types;
+    }
+}
+
+// add, sub, mult, div, remainder, pow and dot of two operands: ints give an
+// int unless it overflows (or they divide by 0), a double makes a double and a
+// vector a vector, or NaN when the lengths differ
+static TYPE_SET arithmeticTypes(TYPE_SET left, TYPE_SET right)
+{
+    TYPE_SET types = 0;
+
+    if (left == 0 || right == 0)
+    {
+        return 0;
+    }
+
+    if ((left & INT_TYPES) && (right & INT_TYPES))
+    {
+        types |= NUMBER_TYPES;
+    }
+    if (((left & DOUBLE_TYPES) && (right & NUMBER_TYPES)) || ((right & DOUBLE_TYPES) && (left & NUMBER_TYPES)))
+    {
+        types |= DOUBLE_TYPES;
+    }
+    if ((left | right) & VECTOR_TYPES)
+    {
+        types |= VECTOR_TYPES | DOUBLE_TYPES;
+    }
+
+    return types;
+}
+
+// max and min of two numbers give one of them
+static TYPE_SET extremeTypes(TYPE_SET left, TYPE_SET right)
+{
+    TYPE_SET types = 0;
+
+    if (left == 0 || right == 0)
+    {
+        return 0;
+    }
+
+    if ((left & NUMBER_TYPES) && (right & NUMBER_TYPES))
+    {
+        types |= (left | right) & NUMBER_TYPES;
+    }
+    if ((left | right) & VECTOR_TYPES)
+    {
+        types |= VECTOR_TYPES | DOUBLE_TYPES;
+    }
+
+    return types;
+}
+
+// neg, abs and exp2 keep the type, but an int can overflow into a double
+static TYPE_SET signTypes(TYPE_SET types)
+{
+    return types & INT_TYPES ? types | DOUBLE_TYPES : types;
+}
+
+// exp, log, sqrt and cbrt give doubles, elementwise on a vector
+static TYPE_SET doubleTypes(TYPE_SET types)
+{
+    return (types & NUMBER_TYPES ? DOUBLE_TYPES : 0) | (types & VECTOR_TYPES);
+}
+
+// sum, and max or min of one operand, keep a number and reduce a vector to a double
+static TYPE_SET reduceTypes(TYPE_SET types)
+{
+    return (types & NUMBER_TYPES) | (types & VECTOR_TYPES ? DOUBLE_TYPES : 0);
+}
+
+// What a builtin gives without operands, see the eval*FuncNode functions
+static TYPE_SET emptyTypes(FUNC_TYPE func)
+{
+    switch (func)
+    {
+    case ADD_FUNC:
+    case MULT_FUNC:
+    case HYPOT_FUNC:
+    case EQUAL_FUNC:
+    case LESS_FUNC:
+    case GREATER_FUNC:
+    case SUM_FUNC:
+    case LEN_FUNC:
+        return INT_TYPES;
+    case VECTOR_FUNC:
+        return VECTOR_TYPES;
+    default:
+        return DOUBLE_TYPES;
+    }
+}
+
+// sum_range, prod_range, count_range and fold_range, which call their lamdas
+// only when evalRangeLoopFuncNode's checks pass. Bounds that aren't ints give NaN.
+static TYPE_SET inferRangeLoop(INFERENCE *inf, AST_NODE *node)
+{
+    FUNC_TYPE func = node->data.function.func;
+    AST_NODE *current = node->data.function.opList;
+    size_t needed = func == FOLD_RANGE_FUNC ? 5 : 3;
+
+    if (countOperands(current) < needed)
+    {
+        return DOUBLE_TYPES;
+    }
+
+    AST_NODE *fold = NULL;
+    if (func == FOLD_RANGE_FUNC)
+    {
+        fold = current;
+        current = current->next;
+    }
+
+    SYMBOL_TABLE_NODE *lamda = rangeLoopLamda(current);
+    SYMBOL_TABLE_NODE *op = rangeLoopLamda(fold);
+
+    if (lamda == NULL || countLamdaArgs(lamda) != 1 || (fold != NULL && (op == NULL || countLamdaArgs(op) != 2)))
+    {
+        return DOUBLE_TYPES;
+    }
+
+    // the loop variable
+    addTypes(inf, lamda->arg_list, INT_TYPES);
+    TYPE_SET value = castTypes(lamda->type, lamda->types);
+    TYPE_SET acc;
+
+    switch (func)
+    {
+    case COUNT_RANGE_FUNC:
+        return NUMBER_TYPES;
+    case FOLD_RANGE_FUNC:
+        // the initial value or what the fold lamda made of the last one
+        acc = current->next->types | castTypes(op->type, op->types);
+        addTypes(inf, op->arg_list, acc);
+        addTypes(inf, op->arg_list->next, value);
+        break;
+    default:
+        // the sum (or product) so far, from 0 (or 1) on
+        acc = INT_TYPES;
+        for (TYPE_SET last = 0; acc != last; )
+        {
+            last = acc;
+            acc |= arithmeticTypes(acc, value);
+        }
+    }
+
+    return acc | DOUBLE_TYPES;
+}
+
+static TYPE_SET inferBuiltin(INFERENCE *inf, AST_NODE *node)
+{
+    FUNC_TYPE func = node->data.function.func;
+    AST_NODE *opList = node->data.function.opList;
+    size_t count = countOperands(opList);
+    TYPE_SET types;
+
+    if (lamdaOperandCount(func) > 0)
+    {
+        return inferRangeLoop(inf, node);
+    }
+
+    switch (func)
+    {
+    case RAND_FUNC:
+        return DOUBLE_TYPES;
+    case READ_FUNC:
+        return ANY_TYPES;
+    case MEMSTATS_FUNC:
+        return INT_TYPES;
+    default:
+        break;
+    }
+
+    if (count == 0)
+    {
+        return emptyTypes(func);
+    }
+
+    TYPE_SET first = opList->types;
+
+    switch (func)
+    {
+    case NEG_FUNC:
+    case ABS_FUNC:
+    case EXP2_FUNC:
+        return signTypes(first);
+    case EXP_FUNC:
+    case LOG_FUNC:
+    case SQRT_FUNC:
+    case CBRT_FUNC:
+        return doubleTypes(first);
+    case SUB_FUNC:
+    case DIV_FUNC:
+    case REM_FUNC:
+    case POW_FUNC:
+    case DOT_FUNC:
+        // NaN with a warning when the second operand is missing
+        return count == 1 ? DOUBLE_TYPES : arithmeticTypes(first, opList->next->types);
+    case ADD_FUNC:
+    case MULT_FUNC:
+        types = first;
+        for (AST_NODE *op = opList->next; op != NULL; op = op->next)
+        {
+            types = arithmeticTypes(types, op->types);
+        }
+        return types;
+    case MAX_FUNC:
+    case MIN_FUNC:
+        if (count == 1)
+        {
+            return reduceTypes(first);
+        }
+        types = first;
+        for (AST_NODE *op = opList->next; op != NULL; op = op->next)
+        {
+            types = extremeTypes(types, op->types);
+        }
+        return types;
+    case HYPOT_FUNC:
+        types = DOUBLE_TYPES;
+        for (AST_NODE *op = opList; op != NULL; op = op->next)
+        {
+            types |= op->types & VECTOR_TYPES;
+        }
+        return types;
+    case EQUAL_FUNC:
+    case LESS_FUNC:
+    case GREATER_FUNC:
+    case LEN_FUNC:
+        return INT_TYPES;
+    case PRINT_FUNC:
+        return first;
+    case VECTOR_FUNC:
+        return VECTOR_TYPES;
+    case RANGE_FUNC:
+        return VECTOR_TYPES | DOUBLE_TYPES;
+    case SUM_FUNC:
+        return reduceTypes(first);
+    default:
+        return ANY_TYPES;
+    }
+}
+
+// A call passes its args only when there are enough of them, the result is
+// NaN otherwise
+static TYPE_SET inferLamdaCall(INFERENCE *inf, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *lamda = node->data.function.binding;
+    AST_NODE *op = node->data.function.opList;
+
+    // undefined lamdas were reported by resolveSymbols
+    if (lamda == NULL || countOperands(op) < (size_t) countLamdaArgs(lamda))
+    {
+        return DOUBLE_TYPES;
+    }
+
+    for (SYMBOL_TABLE_NODE *arg = lamda->arg_list; arg != NULL; arg = arg->next, op = op->next)
+    {
+        addTypes(inf, arg, op->types);
+    }
+
+    return castTypes(lamda->type, lamda->types);
+}
+
+static TYPE_SET inferSymbol(AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *symbol = node->data.symbol.binding;
+
+    // undefined symbols were reported by resolveSymbols
+    if (symbol == NULL)
+    {
+        return DOUBLE_TYPES;
+    }
+
+    switch (symbol->symbolType)
+    {
+    case ARG_TYPE:
+        return symbol->types;
+    case VAR_TYPE:
+        return castTypes(symbol->type, symbol->types);
+    default:
+        // the lamda operands of range builtins aren't evaluated
+        return ANY_TYPES;
+    }
+}
+
+static TYPE_SET typeNode(INFERENCE *inf, AST_NODE *node)
+{
+    TYPE_SET types = 0;
+
+    switch (node->type)
+    {
+    case NUM_NODE_TYPE:
+        types = TYPE_BIT(node->data.number.type);
+        break;
+    case FUNC_NODE_TYPE:
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            typeNode(inf, op);
+        }
+        if (node->data.function.func == CUSTOM_FUNC)
+        {
+            types = inferLamdaCall(inf, node);
+        }
+        else
+        {
+            types = inferBuiltin(inf, node);
+        }
+        break;
+    case SYM_NODE_TYPE:
+        types = inferSymbol(node);
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (symbol->value != NULL)
+            {
+                addTypes(inf, symbol, typeNode(inf, symbol->value));
+            }
+        }
+        types = typeNode(inf, node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        typeNode(inf, node->data.cond.contiditonal);
+        types = typeNode(inf, node->data.cond.true_node) | typeNode(inf, node->data.cond.false_node);
+        break;
+    }
+
+    node->types = types;
+    return types;
+}
+
+// Empties the sets of every symbol and lists the lets and lamdas. A double
+// let with a constant value is cast here, which never warns. An int cast can,
+// so it waits until the let is forced: a let that is never read doesn't warn.
+static void prepareNode(INFERENCE *inf, AST_NODE *node, SYMBOL_TABLE_NODE **symbols, int *count)
+{
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            prepareNode(inf, op, symbols, count);
+        }
+        break;
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            symbol->types = 0;
+            for (SYMBOL_TABLE_NODE *arg = symbol->arg_list; arg != NULL; arg = arg->next)
+            {
+                arg->types = 0;
+            }
+            symbols[(*count)++] = symbol;
+
+            if (symbol->value == NULL)
+            {
+                continue;
+            }
+
+            if (symbol->symbolType == VAR_TYPE && symbol->type == DOUBLE_TYPE && symbol->value->type == NUM_NODE_TYPE)
+            {
+                symbol->value->data.number = castRetVal(inf->interp, symbol->value->data.number, symbol->type);
+                symbol->type = NO_TYPE;
+            }
+            prepareNode(inf, symbol->value, symbols, count);
+        }
+        prepareNode(inf, node->data.scope.child, symbols, count);
+        break;
+    case COND_NODE_TYPE:
+        prepareNode(inf, node->data.cond.contiditonal, symbols, count);
+        prepareNode(inf, node->data.cond.true_node, symbols, count);
+        prepareNode(inf, node->data.cond.false_node, symbols, count);
+        break;
+    default:
+        break;
+    }
+}
+
+static int symbolId(CYCLES *c, SYMBOL_TABLE_NODE *symbol)
+{
+    return symbol->symbolType == LAMBDA_TYPE ? c->vars + symbol->index - 1 : symbol->index;
+}
+
+static void visitSymbol(CYCLES *c, SYMBOL_TABLE_NODE *symbol);
+
+// Follows the reads and calls in the code of from, the let values and lamda
+// bodies defined in it are visited as symbols of their own
+static void visitRefs(CYCLES *c, SYMBOL_TABLE_NODE *from, AST_NODE *node)
+{
+    SYMBOL_TABLE_NODE *to = NULL;
+
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+        for (AST_NODE *op = node->data.function.opList; op != NULL; op = op->next)
+        {
+            visitRefs(c, from, op);
+        }
+        if (node->data.function.func == CUSTOM_FUNC)
+        {
+            to = node->data.function.binding;
+        }
+        break;
+    case SYM_NODE_TYPE:
+        to = node->data.symbol.binding;
+        break;
+    case SCOPE_NODE_TYPE:
+        visitRefs(c, from, node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        visitRefs(c, from, node->data.cond.contiditonal);
+        visitRefs(c, from, node->data.cond.true_node);
+        visitRefs(c, from, node->data.cond.false_node);
+        break;
+    default:
+        break;
+    }
+
+    if (to == NULL || to->symbolType == ARG_TYPE)
+    {
+        return;
+    }
+
+    int fromId = symbolId(c, from);
+    int toId = symbolId(c, to);
+
+    if (to == from && from->symbolType == VAR_TYPE)
+    {
+        from->types |= DOUBLE_TYPES;
+    }
+
+    if (c->order[toId] == 0)
+    {
+        visitSymbol(c, to);
+        if (c->low[toId] < c->low[fromId])
+        {
+            c->low[fromId] = c->low[toId];
+        }
+    }
+    else if (c->onStack[toId] && c->order[toId] < c->low[fromId])
+    {
+        c->low[fromId] = c->order[toId];
+    }
+}
+
+static void visitSymbol(CYCLES *c, SYMBOL_TABLE_NODE *symbol)
+{
+    int id = symbolId(c, symbol);
+
+    c->order[id] = c->low[id] = ++c->visited;
+    c->stack[c->depth++] = symbol;
+    c->onStack[id] = true;
+
+    if (symbol->value != NULL)
+    {
+        visitRefs(c, symbol, symbol->value);
+    }
+
+    if (c->low[id] != c->order[id])
+    {
+        return;
+    }
+
+    // symbol is the first of its component, which is on the stack above it
+    int first = c->depth - 1;
+    while (c->stack[first] != symbol)
+    {
+        first--;
+    }
+
+    bool cycle = c->depth - first > 1;
+    while (c->depth > first)
+    {
+        SYMBOL_TABLE_NODE *member = c->stack[--c->depth];
+
+        c->onStack[symbolId(c, member)] = false;
+        if (cycle && member->symbolType == VAR_TYPE)
+        {
+            member->types |= DOUBLE_TYPES;
+        }
+    }
+}
+
+// Adds the NaN of a recursive read to the lets that can have one
+static void findRecursiveLets(INTERP *interp, RESOLVE_INFO *info, SYMBOL_TABLE_NODE **symbols, int count)
+{
+    int size = info->vars + info->lamdas;
+    CYCLES c = {
+        .vars = info->vars,
+        .order = allocFromArena(&interp->parseArena, size * sizeof(int)),
+        .low = allocFromArena(&interp->parseArena, size * sizeof(int)),
+        .onStack = allocFromArena(&interp->parseArena, size * sizeof(bool)),
+        .stack = allocFromArena(&interp->parseArena, size * sizeof(SYMBOL_TABLE_NODE *))
+    };
+
+    memset(c.order, 0, size * sizeof(int));
+    memset(c.onStack, 0, size * sizeof(bool));
+
+    for (int i = 0; i < count; i++)
+    {
+        if (c.order[symbolId(&c, symbols[i])] == 0)
+        {
+            visitSymbol(&c, symbols[i]);
+        }
+    }
+}
+
+// Drops the casts that can't change a value and makes an int constant
+// compared with or combined with a double a double, so the builtin can take
+// the double kernel. Neither changes a result.
+static void finishNode(AST_NODE *node)
+{
+    switch (node->type)
+    {
+    case FUNC_NODE_TYPE:
+    {
+        AST_NODE *left = node->data.function.opList;
+
+        for (AST_NODE *op = left; op != NULL; op = op->next)
+        {
+            finishNode(op);
+        }
+
+        switch (node->data.function.func)
+        {
+        case ADD_FUNC:
+        case SUB_FUNC:
+        case MULT_FUNC:
+        case DIV_FUNC:
+        case EQUAL_FUNC:
+        case LESS_FUNC:
+        case GREATER_FUNC:
+            break;
+        default:
+            return;
+        }
+
+        if (countOperands(left) != 2)
+        {
+            return;
+        }
+
+        AST_NODE *right = left->next;
+        AST_NODE *constant = left->types == DOUBLE_TYPES ? right : right->types == DOUBLE_TYPES ? left : NULL;
+
+        if (constant != NULL && constant->type == NUM_NODE_TYPE && constant->data.number.type == INT_TYPE)
+        {
+            constant->data.number = DOUBLE_RET_VAL((double) constant->data.number.integer);
+            constant->types = DOUBLE_TYPES;
+        }
+        break;
+    }
+    case SCOPE_NODE_TYPE:
+        for (SYMBOL_TABLE_NODE *symbol = node->data.scope.symbols; symbol != NULL; symbol = symbol->next)
+        {
+            if (symbol->type != NO_TYPE && symbol->types == TYPE_BIT(symbol->type))
+            {
+                symbol->type = NO_TYPE;
+            }
+            if (symbol->value != NULL)
+            {
+                finishNode(symbol->value);
+            }
+        }
+        finishNode(node->data.scope.child);
+        break;
+    case COND_NODE_TYPE:
+        finishNode(node->data.cond.contiditonal);
+        finishNode(node->data.cond.true_node);
+        finishNode(node->data.cond.false_node);
+        break;
+    default:
+        break;
+    }
+}
+
+void inferTypes(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info)
+{
+    INFERENCE inf = {interp, true};
+    int size = info->vars + info->lamdas;
+    SYMBOL_TABLE_NODE **symbols = allocFromArena(&interp->parseArena, (size + 1) * sizeof(SYMBOL_TABLE_NODE *));
+    int count = 0;
+
+    prepareNode(&inf, node, symbols, &count);
+    if (count > 0)
+    {
+        findRecursiveLets(interp, info, symbols, count);
+    }
+
+    while (inf.changed)
+    {
+        inf.changed = false;
+        typeNode(&inf, node);
+    }
+
+    finishNode(node);
+}
@@ -0,0 +1,41 @@
+#ifndef __types_h_
+#define __types_h_
+
+#include "cilisp.h"
+#include "resolve.h"
+
+// Sets of the types a node or symbol can evaluate to. An empty set means it
+// is never evaluated, or never returns.
+#define INT_TYPES TYPE_BIT(INT_TYPE)
+#define DOUBLE_TYPES TYPE_BIT(DOUBLE_TYPE)
+#define VECTOR_TYPES TYPE_BIT(VECTOR_TYPE)
+#define NUMBER_TYPES (INT_TYPES | DOUBLE_TYPES)
+#define ANY_TYPES (NUMBER_TYPES | VECTOR_TYPES)
+
+// Works out what every node and symbol of a resolved and folded expression
+// can evaluate to. Double lets with a constant value are cast right away, and
+// casts that can't change a value are dropped. The engines then run builtins whose operands have one known
+// type on the int or double kernels of number.h.
+void inferTypes(INTERP *interp, AST_NODE *node, RESOLVE_INFO *info);
+
+// The one type both operands of a builtin always have, INT_TYPE or
+// DOUBLE_TYPE, NO_TYPE when either may be something else
+static inline NUM_TYPE kernelType(TYPE_SET left, TYPE_SET right)
+{
+    if (left != right)
+    {
+        return NO_TYPE;
+    }
+
+    switch (left)
+    {
+    case INT_TYPES:
+        return INT_TYPE;
+    case DOUBLE_TYPES:
+        return DOUBLE_TYPE;
+    default:
+        return NO_TYPE;
+    }
+}
+
+#endif
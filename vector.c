@@ -0,0 +1,623 @@
+#include "vector.h"
+#include "interp.h"
+#include "number.h"
+
+// The kernels have AVX2 and SSE2 versions on x86-64, picked for the CPU at run
+// time, and plain C loops everywhere else. Build with -DCILISP_NO_SIMD to only
+// use the plain loops, e.g. to diff results against them.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(CILISP_NO_SIMD)
+#define VEC_X86 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define VEC_X86 0
+#endif
+
+// A number operand of a binary kernel is read through a stride of 0 from this
+// many copies of it, enough for the widest load
+#define VEC_LANES 4
+
+typedef void (*BINARY_KERNEL)(double *out, const double *a, size_t as, const double *b, size_t bs, size_t n);
+typedef void (*UNARY_KERNEL)(double *out, const double *a, size_t n);
+
+typedef enum {
+    SCALAR_KERNELS,
+    SSE2_KERNELS,
+    AVX2_KERNELS
+} KERNEL_LEVEL;
+
+static const char *vecOpNames[] = {
+    [VEC_ADD] = "add", [VEC_SUB] = "sub", [VEC_MULT] = "mult", [VEC_DIV] = "div",
+    [VEC_REM] = "remainder", [VEC_POW] = "pow", [VEC_MAX] = "max", [VEC_MIN] = "min"
+};
+
+static KERNEL_LEVEL kernelLevel(void)
+{
+#if VEC_X86
+    return __builtin_cpu_supports("avx2") ? AVX2_KERNELS : SSE2_KERNELS;
+#else
+    return SCALAR_KERNELS;
+#endif
+}
+
+// Elementwise kernels. Each SIMD loop leaves the last few elements to the
+// plain one. max and min keep the left element unless the right one is
+// strictly greater (less), like the builtins do, which is what MAXPD and
+// MINPD give with the operands swapped.
+
+#define SCALAR_BINARY(name, expr) \
+    static void name##Scalar(double *out, const double *a, size_t as, const double *b, size_t bs, size_t n) \
+    { \
+        for (size_t i = 0; i < n; i++) \
+        { \
+            double x = a[i * as]; \
+            double y = b[i * bs]; \
+            out[i] = (expr); \
+        } \
+    }
+
+#define SCALAR_UNARY(name, expr) \
+    static void name##Scalar(double *out, const double *a, size_t n) \
+    { \
+        for (size_t i = 0; i < n; i++) \
+        { \
+            double x = a[i]; \
+            out[i] = (expr); \
+        } \
+    }
+
+#if VEC_X86
+#define SIMD_BINARY(name, expr, avx2, sse2) \
+    SCALAR_BINARY(name, expr) \
+    AVX2_TARGET static void name##Avx2(double *out, const double *a, size_t as, const double *b, size_t bs, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 4 <= n; i += 4) \
+        { \
+            __m256d x = _mm256_loadu_pd(a + i * as); \
+            __m256d y = _mm256_loadu_pd(b + i * bs); \
+            _mm256_storeu_pd(out + i, (avx2)); \
+        } \
+        name##Scalar(out + i, a + i * as, as, b + i * bs, bs, n - i); \
+    } \
+    static void name##Sse2(double *out, const double *a, size_t as, const double *b, size_t bs, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 2 <= n; i += 2) \
+        { \
+            __m128d x = _mm_loadu_pd(a + i * as); \
+            __m128d y = _mm_loadu_pd(b + i * bs); \
+            _mm_storeu_pd(out + i, (sse2)); \
+        } \
+        name##Scalar(out + i, a + i * as, as, b + i * bs, bs, n - i); \
+    }
+
+#define SIMD_UNARY(name, expr, avx2, sse2) \
+    SCALAR_UNARY(name, expr) \
+    AVX2_TARGET static void name##Avx2(double *out, const double *a, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 4 <= n; i += 4) \
+        { \
+            __m256d x = _mm256_loadu_pd(a + i); \
+            _mm256_storeu_pd(out + i, (avx2)); \
+        } \
+        name##Scalar(out + i, a + i, n - i); \
+    } \
+    static void name##Sse2(double *out, const double *a, size_t n) \
+    { \
+        size_t i = 0; \
+        for (; i + 2 <= n; i += 2) \
+        { \
+            __m128d x = _mm_loadu_pd(a + i); \
+            _mm_storeu_pd(out + i, (sse2)); \
+        } \
+        name##Scalar(out + i, a + i, n - i); \
+    }
+
+#define PICK_KERNEL(name) \
+    (kernelLevel() == AVX2_KERNELS ? name##Avx2 : kernelLevel() == SSE2_KERNELS ? name##Sse2 : name##Scalar)
+#else
+#define SIMD_BINARY(name, expr, avx2, sse2) SCALAR_BINARY(name, expr)
+#define SIMD_UNARY(name, expr, avx2, sse2) SCALAR_UNARY(name, expr)
+#define PICK_KERNEL(name) name##Scalar
+#endif
+
+SIMD_BINARY(vecAdd, x + y, _mm256_add_pd(x, y), _mm_add_pd(x, y))
+SIMD_BINARY(vecSub, x - y, _mm256_sub_pd(x, y), _mm_sub_pd(x, y))
+SIMD_BINARY(vecMult, x * y, _mm256_mul_pd(x, y), _mm_mul_pd(x, y))
+SIMD_BINARY(vecDiv, x / y, _mm256_div_pd(x, y), _mm_div_pd(x, y))
+SIMD_BINARY(vecMax, x < y ? y : x, _mm256_max_pd(y, x), _mm_max_pd(y, x))
+SIMD_BINARY(vecMin, y < x ? y : x, _mm256_min_pd(y, x), _mm_min_pd(y, x))
+SCALAR_BINARY(vecRem, fmod(x, y))
+SCALAR_BINARY(vecPow, pow(x, y))
+
+SIMD_UNARY(vecNeg, x * -1.0, _mm256_mul_pd(x, _mm256_set1_pd(-1.0)), _mm_mul_pd(x, _mm_set1_pd(-1.0)))
+SIMD_UNARY(vecAbs, fabs(x), _mm256_andnot_pd(_mm256_set1_pd(-0.0), x), _mm_andnot_pd(_mm_set1_pd(-0.0), x))
+SIMD_UNARY(vecSqrt, sqrt(x), _mm256_sqrt_pd(x), _mm_sqrt_pd(x))
+// exp and exp2 go through float like the number versions
+SCALAR_UNARY(vecExp, expf(x))
+SCALAR_UNARY(vecExp2, exp2f(x))
+SCALAR_UNARY(vecLog, log(x))
+SCALAR_UNARY(vecCbrt, cbrt(x))
+
+static BINARY_KERNEL binaryKernel(VEC_OP op)
+{
+    switch (op)
+    {
+    case VEC_ADD:
+        return PICK_KERNEL(vecAdd);
+    case VEC_SUB:
+        return PICK_KERNEL(vecSub);
+    case VEC_MULT:
+        return PICK_KERNEL(vecMult);
+    case VEC_DIV:
+        return PICK_KERNEL(vecDiv);
+    case VEC_MAX:
+        return PICK_KERNEL(vecMax);
+    case VEC_MIN:
+        return PICK_KERNEL(vecMin);
+    case VEC_REM:
+        return vecRemScalar;
+    case VEC_POW:
+        return vecPowScalar;
+    default:
+        yyerror("Invalid binary vector operation!");
+        return vecAddScalar;
+    }
+}
+
+static UNARY_KERNEL unaryKernel(VEC_OP op)
+{
+    switch (op)
+    {
+    case VEC_NEG:
+        return PICK_KERNEL(vecNeg);
+    case VEC_ABS:
+        return PICK_KERNEL(vecAbs);
+    case VEC_SQRT:
+        return PICK_KERNEL(vecSqrt);
+    case VEC_EXP:
+        return vecExpScalar;
+    case VEC_EXP2:
+        return vecExp2Scalar;
+    case VEC_LOG:
+        return vecLogScalar;
+    case VEC_CBRT:
+        return vecCbrtScalar;
+    default:
+        yyerror("Invalid unary vector operation!");
+        return vecAbsScalar;
+    }
+}
+
+// Reductions. The SIMD sums keep a partial sum per lane (and two registers of
+// them) that are added up at the end, so they round differently from adding
+// the elements left to right.
+
+static double vecSumScalar(const double *a, const double *b, size_t n)
+{
+    double sum = 0.0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        sum += b == NULL ? a[i] : a[i] * b[i];
+    }
+    return sum;
+}
+
+static double vecMaxOfScalar(const double *a, size_t n)
+{
+    double result = a[0];
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (result < a[i])
+        {
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+static double vecMinOfScalar(const double *a, size_t n)
+{
+    double result = a[0];
+
+    for (size_t i = 1; i < n; i++)
+    {
+        if (a[i] < result)
+        {
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+#if VEC_X86
+// b is NULL for a plain sum, otherwise the sum is a dot product
+AVX2_TARGET static double vecSumAvx2(const double *a, const double *b, size_t n)
+{
+    __m256d sum0 = _mm256_setzero_pd();
+    __m256d sum1 = _mm256_setzero_pd();
+    double lanes[4];
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256d x0 = _mm256_loadu_pd(a + i);
+        __m256d x1 = _mm256_loadu_pd(a + i + 4);
+        if (b != NULL)
+        {
+            x0 = _mm256_mul_pd(x0, _mm256_loadu_pd(b + i));
+            x1 = _mm256_mul_pd(x1, _mm256_loadu_pd(b + i + 4));
+        }
+        sum0 = _mm256_add_pd(sum0, x0);
+        sum1 = _mm256_add_pd(sum1, x1);
+    }
+
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + vecSumScalar(a + i, b == NULL ? NULL : b + i, n - i);
+}
+
+static double vecSumSse2(const double *a, const double *b, size_t n)
+{
+    __m128d sum0 = _mm_setzero_pd();
+    __m128d sum1 = _mm_setzero_pd();
+    double lanes[2];
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128d x0 = _mm_loadu_pd(a + i);
+        __m128d x1 = _mm_loadu_pd(a + i + 2);
+        if (b != NULL)
+        {
+            x0 = _mm_mul_pd(x0, _mm_loadu_pd(b + i));
+            x1 = _mm_mul_pd(x1, _mm_loadu_pd(b + i + 2));
+        }
+        sum0 = _mm_add_pd(sum0, x0);
+        sum1 = _mm_add_pd(sum1, x1);
+    }
+
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    return lanes[0] + lanes[1] + vecSumScalar(a + i, b == NULL ? NULL : b + i, n - i);
+}
+
+// Every lane starts out as the first element, so a NaN only wins when it is
+// the first element like in max and min
+AVX2_TARGET static double vecMaxOfAvx2(const double *a, size_t n)
+{
+    __m256d acc = _mm256_set1_pd(a[0]);
+    double lanes[4];
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        acc = _mm256_max_pd(_mm256_loadu_pd(a + i), acc);
+    }
+
+    _mm256_storeu_pd(lanes, acc);
+    double result = vecMaxOfScalar(lanes, 4);
+
+    for (; i < n; i++)
+    {
+        if (result < a[i])
+        {
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+AVX2_TARGET static double vecMinOfAvx2(const double *a, size_t n)
+{
+    __m256d acc = _mm256_set1_pd(a[0]);
+    double lanes[4];
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        acc = _mm256_min_pd(_mm256_loadu_pd(a + i), acc);
+    }
+
+    _mm256_storeu_pd(lanes, acc);
+    double result = vecMinOfScalar(lanes, 4);
+
+    for (; i < n; i++)
+    {
+        if (a[i] < result)
+        {
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+static double vecMaxOfSse2(const double *a, size_t n)
+{
+    __m128d acc = _mm_set1_pd(a[0]);
+    double lanes[2];
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2)
+    {
+        acc = _mm_max_pd(_mm_loadu_pd(a + i), acc);
+    }
+
+    _mm_storeu_pd(lanes, acc);
+    double result = vecMaxOfScalar(lanes, 2);
+
+    for (; i < n; i++)
+    {
+        if (result < a[i])
+        {
+            result = a[i];
+        }
+    }
+    return result;
+}
+
+static double vecMinOfSse2(const double *a, size_t n)
+{
+    __m128d acc = _mm_set1_pd(a[0]);
+    double lanes[2];
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2)
+    {
+        acc = _mm_min_pd(_mm_loadu_pd(a + i), acc);
+    }
+
+    _mm_storeu_pd(lanes, acc);
+    double result = vecMinOfScalar(lanes, 2);
+
+    for (; i < n; i++)
+    {
+        if (a[i] < result)
+        {
+            result = a[i];
+        }
+    }
+    return result;
+}
+#endif
+
+VECTOR *createVector(INTERP *interp, size_t len)
+{
+    VECTOR *vector = allocFromArena(&interp->parseArena, sizeof(VECTOR) + len * sizeof(double));
+    vector->len = len;
+    return vector;
+}
+
+// Points at the elements of a vector operand, or at copies of a number read
+// with a stride of 0. Returns the vector's length, or 0 for a number.
+static size_t vecOperand(RET_VAL value, double copies[VEC_LANES], const double **data, size_t *stride)
+{
+    if (value.type == VECTOR_TYPE)
+    {
+        *data = value.vector->data;
+        *stride = 1;
+        return value.vector->len;
+    }
+
+    for (int i = 0; i < VEC_LANES; i++)
+    {
+        copies[i] = numValue(value);
+    }
+    *data = copies;
+    *stride = 0;
+    return 0;
+}
+
+static bool vecLengthsMatch(INTERP *interp, const char *name, size_t a, size_t b)
+{
+    if (a != b)
+    {
+        warning(interp, "Vector lengths %zu and %zu don't match in %s!", a, b, name);
+        return false;
+    }
+    return true;
+}
+
+RET_VAL vecBinary(INTERP *interp, VEC_OP op, RET_VAL a, RET_VAL b)
+{
+    double aCopies[VEC_LANES], bCopies[VEC_LANES];
+    const double *x, *y;
+    size_t xs, ys;
+    size_t len = vecOperand(a, aCopies, &x, &xs);
+    size_t bLen = vecOperand(b, bCopies, &y, &ys);
+
+    if (a.type == VECTOR_TYPE && b.type == VECTOR_TYPE)
+    {
+        if (!vecLengthsMatch(interp, vecOpNames[op], len, bLen))
+        {
+            return NAN_RET_VAL;
+        }
+    }
+    else if (b.type == VECTOR_TYPE)
+    {
+        len = bLen;
+    }
+
+    VECTOR *result = createVector(interp, len);
+    binaryKernel(op)(result->data, x, xs, y, ys, len);
+    return VECTOR_RET_VAL(result);
+}
+
+RET_VAL vecUnary(INTERP *interp, VEC_OP op, RET_VAL a)
+{
+    VECTOR *result = createVector(interp, a.vector->len);
+    unaryKernel(op)(result->data, a.vector->data, a.vector->len);
+    return VECTOR_RET_VAL(result);
+}
+
+static double vecSum(const double *a, const double *b, size_t n)
+{
+    return PICK_KERNEL(vecSum)(a, b, n);
+}
+
+RET_VAL vecReduce(INTERP *interp, VEC_OP op, RET_VAL a)
+{
+    if (a.type != VECTOR_TYPE)
+    {
+        return a;
+    }
+
+    size_t len = a.vector->len;
+
+    if (op == VEC_ADD)
+    {
+        return DOUBLE_RET_VAL(vecSum(a.vector->data, NULL, len));
+    }
+
+    if (len == 0)
+    {
+        warning(interp, "%s of an empty vector!", vecOpNames[op]);
+        return NAN_RET_VAL;
+    }
+
+    if (op == VEC_MAX)
+    {
+        return DOUBLE_RET_VAL(PICK_KERNEL(vecMaxOf)(a.vector->data, len));
+    }
+    return DOUBLE_RET_VAL(PICK_KERNEL(vecMinOf)(a.vector->data, len));
+}
+
+RET_VAL vecDot(INTERP *interp, RET_VAL a, RET_VAL b)
+{
+    if (a.type != VECTOR_TYPE)
+    {
+        return DOUBLE_RET_VAL(numValue(a) * vecSum(b.vector->data, NULL, b.vector->len));
+    }
+    if (b.type != VECTOR_TYPE)
+    {
+        return DOUBLE_RET_VAL(vecSum(a.vector->data, NULL, a.vector->len) * numValue(b));
+    }
+    if (!vecLengthsMatch(interp, "dot", a.vector->len, b.vector->len))
+    {
+        return NAN_RET_VAL;
+    }
+    return DOUBLE_RET_VAL(vecSum(a.vector->data, b.vector->data, a.vector->len));
+}
+
+// One operand is the norm of a vector, more are the elementwise
+// sqrt of the sum of squares like the number version
+RET_VAL vecHypot(INTERP *interp, const RET_VAL *args, size_t n)
+{
+    if (n == 1)
+    {
+        return DOUBLE_RET_VAL(sqrt(vecSum(args[0].vector->data, args[0].vector->data, args[0].vector->len)));
+    }
+
+    size_t len = 0;
+    bool sized = false;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (args[i].type != VECTOR_TYPE)
+        {
+            continue;
+        }
+        if (sized && !vecLengthsMatch(interp, "hypot", len, args[i].vector->len))
+        {
+            return NAN_RET_VAL;
+        }
+        len = args[i].vector->len;
+        sized = true;
+    }
+
+    VECTOR *result = createVector(interp, len);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        double copies[VEC_LANES];
+        const double *x;
+        size_t xs;
+
+        vecOperand(args[i], copies, &x, &xs);
+        for (size_t j = 0; j < len; j++)
+        {
+            result->data[j] += x[j * xs] * x[j * xs];
+        }
+    }
+
+    unaryKernel(VEC_SQRT)(result->data, result->data, len);
+    return VECTOR_RET_VAL(result);
+}
+
+RET_VAL vecConcat(INTERP *interp, const RET_VAL *args, size_t n)
+{
+    size_t len = 0;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        len += args[i].type == VECTOR_TYPE ? args[i].vector->len : 1;
+    }
+
+    VECTOR *result = createVector(interp, len);
+    double *next = result->data;
+
+    for (size_t i = 0; i < n; i++)
+    {
+        if (args[i].type == VECTOR_TYPE)
+        {
+            memcpy(next, args[i].vector->data, args[i].vector->len * sizeof(double));
+            next += args[i].vector->len;
+        }
+        else
+        {
+            *next++ = numValue(args[i]);
+        }
+    }
+
+    return VECTOR_RET_VAL(result);
+}
+
+// Counts from start up to (or down to) end, not including it. Each element is
+// start + i * step so long ranges don't pile up rounding errors.
+RET_VAL vecRange(INTERP *interp, const RET_VAL *args, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        if (args[i].type == VECTOR_TYPE)
+        {
+            warning(interp, "range takes numbers, not vectors!");
+            return NAN_RET_VAL;
+        }
+    }
+
+    double start = n > 1 ? numValue(args[0]) : 0.0;
+    double end = n > 1 ? numValue(args[1]) : numValue(args[0]);
+    double step = n > 2 ? numValue(args[2]) : 1.0;
+
+    if (!isfinite(start) || !isfinite(end) || !isfinite(step))
+    {
+        warning(interp, "range bounds and step must be finite!");
+        return NAN_RET_VAL;
+    }
+
+    if (step == 0)
+    {
+        warning(interp, "range step can't be 0!");
+        return NAN_RET_VAL;
+    }
+
+    double count = ceil((end - start) / step);
+
+    if (count > (double) MAX_VECTOR_LEN)
+    {
+        warning(interp, "range of %.0f elements is too long!", count);
+        return NAN_RET_VAL;
+    }
+
+    size_t len = count > 0 ? (size_t) count : 0;
+    VECTOR *result = createVector(interp, len);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        result->data[i] = start + (double) i * step;
+    }
+
+    return VECTOR_RET_VAL(result);
+}
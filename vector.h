@@ -0,0 +1,52 @@
+#ifndef __vector_h_
+#define __vector_h_
+
+#include "cilisp.h"
+
+// Longest vector range will build, 16GB of doubles
+#define MAX_VECTOR_LEN ((size_t) 1 << 31)
+
+// A vector value: doubles allocated from the parse arena of the interpreter
+// that made it, so it lives as long as the top level expression. Vectors are
+// never changed once built, RET_VALs share them freely.
+typedef struct vector {
+    size_t len;
+    double data[];
+} VECTOR;
+
+// Elementwise operations, binary ones first. A number operand of a binary
+// operation is used with every element of the other one.
+typedef enum {
+    VEC_ADD,
+    VEC_SUB,
+    VEC_MULT,
+    VEC_DIV,
+    VEC_REM,
+    VEC_POW,
+    VEC_MAX,
+    VEC_MIN,
+    VEC_NEG,
+    VEC_ABS,
+    VEC_EXP,
+    VEC_EXP2,
+    VEC_LOG,
+    VEC_SQRT,
+    VEC_CBRT
+} VEC_OP;
+
+VECTOR *createVector(INTERP *interp, size_t len);
+
+RET_VAL vecBinary(INTERP *interp, VEC_OP op, RET_VAL a, RET_VAL b);
+RET_VAL vecUnary(INTERP *interp, VEC_OP op, RET_VAL a);
+// VEC_ADD, VEC_MAX or VEC_MIN over the elements of a vector, a number is returned as is
+RET_VAL vecReduce(INTERP *interp, VEC_OP op, RET_VAL a);
+RET_VAL vecDot(INTERP *interp, RET_VAL a, RET_VAL b);
+// hypot of operands where at least one is a vector, see numHypot
+RET_VAL vecHypot(INTERP *interp, const RET_VAL *args, size_t n);
+
+// (vector ...) joins numbers and vectors into one vector
+RET_VAL vecConcat(INTERP *interp, const RET_VAL *args, size_t n);
+// (range end), (range start end) or (range start end step)
+RET_VAL vecRange(INTERP *interp, const RET_VAL *args, size_t n);
+
+#endif
@@ -1,5 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "cilisp.h"
 
 #define INITIAL_BUFFER_SIZE 128
@@ -31,7 +35,7 @@ size_t yyreadline(char **lineptr, size_t *n, FILE *stream, size_t n_terminate)
     c = 0;
     if (bufptr == NULL)
     {
-        bufptr = malloc(INITIAL_BUFFER_SIZE);
+        bufptr = memAlloc(MEM_IO, INITIAL_BUFFER_SIZE);
         if (bufptr == NULL)
         {
             return (size_t) -1;
@@ -46,7 +50,7 @@ size_t yyreadline(char **lineptr, size_t *n, FILE *stream, size_t n_terminate)
         {
             unsigned long offset = p - bufptr;
             size = 2 * size;
-            bufptr = realloc(bufptr, size);
+            bufptr = memRealloc(MEM_IO, bufptr, size);
             if (bufptr == NULL)
             {
                 return (size_t) -1;
@@ -67,7 +71,7 @@ size_t yyreadline(char **lineptr, size_t *n, FILE *stream, size_t n_terminate)
     }
 
     *n = p - bufptr;
-    bufptr = realloc(bufptr, *n);
+    bufptr = memRealloc(MEM_IO, bufptr, *n);
     *lineptr = bufptr;
 
     return (p - bufptr);
@@ -91,3 +95,50 @@ void yyprintline(char *line, size_t len, size_t n_extra_terminates)
         printf("%s", line);
     }
 }
+
+// Maps a whole file for --batch, followed by the two NULs yy_scan_buffer
+// needs. The mapping is private and writable since flex writes its hold
+// char into the text it scans, which never reaches the file.
+char *yymapfile(const char *path, size_t *len)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t total = (size + 2 + page - 1) / page * page;
+
+    // zeroed anonymous pages first so the bytes past the end of the file read
+    // as NUL even when the file fills its last page
+    char *text = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (text == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    if (size > 0 && mmap(text, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(text, total);
+        close(fd);
+        return NULL;
+    }
+
+    close(fd);
+    madvise(text, size, MADV_SEQUENTIAL);
+
+    *len = size;
+    return text;
+}